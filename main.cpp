@@ -45,7 +45,146 @@
 #include "error.hpp"
 #include "mainwindow.hpp"
 #include "style.hpp"
+#include "settings.hpp"
+#include "parallel.hpp"
+#include "snapshotrenderer.hpp"
+#include <DataStorage/io_application.hpp>
 
+namespace
+{
+
+void addParameters( isis::util::ParameterMap &parameters )
+{
+	using namespace isis;
+	parameters["in"] = util::slist();
+	parameters["in"].needed() = false;
+	parameters["in"].setDescription( "The input image file list." );
+	parameters["zmap"] = util::slist();
+	parameters["zmap"].needed() = false;
+	parameters["zmap"].setDescription( "The input image file list is interpreted as statistical maps. " );
+	//alias to zmap
+	parameters["stats"] = util::slist();
+	parameters["stats"].needed() = false;
+	parameters["stats"].setDescription( "The input image file list is interpreted as statistical maps. " );
+	parameters["rf"] = std::string();
+	parameters["rf"].needed() = false;
+	parameters["rf"].setDescription( "Override automatic detection of file suffix for reading with given value" );
+	parameters["rf"].hidden() = true;
+	parameters["rdialect"] = std::string();
+	parameters["rdialect"].needed() = false;
+	parameters["rdialect"].hidden() = true;
+	parameters["rdialect"].setDescription( "Dialect for reading" );
+	parameters["split"] = false;
+	parameters["split"].needed() = false;
+	parameters["split"].setDescription( "Show each image in a separate view" );
+	parameters["widget"] = std::string();
+	parameters["widget"].needed() = false;
+	parameters["widget"].setDescription( "Use specific widget" );
+}
+
+bool isSnapshotMode( int argc, char *argv[] )
+{
+	for( int i = 1; i < argc; i++ ) {
+		if( !strcmp( argv[i], "-snapshot" ) || !strcmp( argv[i], "--snapshot" ) ) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * The headless mode renders snapshots of all given images to png files and quits.
+ * No QApplication is created, so it runs without any display.
+ */
+int renderSnapshots( const std::string &appName, int argc, char *argv[] )
+{
+	using namespace isis;
+	using namespace viewer;
+
+	data::IOApplication app( appName.c_str(), false, false );
+	addParameters( app.parameters );
+	app.parameters["snapshot"] = util::slist();
+	app.parameters["snapshot"].setDescription( "Render snapshots without any window and quit. Each view is \"axial\", \"sagittal\" or \"coronal\", "
+											   "optionally followed by \":x,y,z\" in mm. Otherwise the slices go through the center of the first image of each subject. "
+											   "Every input image is a subject, the statistical maps are assigned by position if their number matches, else shown on every subject." );
+	app.parameters["snapshotdir"] = std::string( "." );
+	app.parameters["snapshotdir"].needed() = false;
+	app.parameters["snapshotdir"].setDescription( "Directory the snapshots are saved to as <subject>_<view>.png" );
+	app.parameters["snapshotsize"] = uint16_t( 512 );
+	app.parameters["snapshotsize"].needed() = false;
+	app.parameters["snapshotsize"].setDescription( "Length of the longer side of the snapshots in pixels" );
+	app.parameters["lut"] = std::string();
+	app.parameters["lut"].needed() = false;
+	app.parameters["lut"].setDescription( "Colormap of the input images (default from the settings)" );
+	app.parameters["zmaplut"] = std::string();
+	app.parameters["zmaplut"].needed() = false;
+	app.parameters["zmaplut"].setDescription( "Colormap of the statistical maps (default from the settings)" );
+	app.parameters["lowerthreshold"] = 0.;
+	app.parameters["lowerthreshold"].needed() = false;
+	app.parameters["lowerthreshold"].setDescription( "Lower threshold of the statistical maps" );
+	app.parameters["upperthreshold"] = 0.;
+	app.parameters["upperthreshold"].needed() = false;
+	app.parameters["upperthreshold"].setDescription( "Upper threshold of the statistical maps" );
+	app.parameters["opacity"] = 1.;
+	app.parameters["opacity"].needed() = false;
+	app.parameters["opacity"].setDescription( "Opacity of the statistical maps" );
+
+	if( !app.init( argc, argv, false ) ) {
+		return EXIT_FAILURE;
+	}
+
+	Settings settings;
+	settings.load();
+	util::Singletons::get<color::Color, 10>().initStandardColormaps();
+
+	if( app.parameters["widget"].isSet() ) {
+		LOG( Runtime, info ) << "The snapshots are composited like the slices of the 2D image widgets, the widget "
+							 << app.parameters["widget"].as<std::string>() << " is not used.";
+	}
+
+	std::vector<SnapshotRenderer::View> views;
+	BOOST_FOREACH( util::slist::const_reference spec, app.parameters["snapshot"].as<util::slist>() ) {
+		SnapshotRenderer::View view;
+
+		if( !SnapshotRenderer::parseView( spec, view ) ) {
+			std::cerr << "Invalid snapshot view \"" << spec << "\"." << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		views.push_back( view );
+	}
+
+	SnapshotBatch::Options options;
+	options.readFormat = app.parameters["rf"].as<std::string>().c_str();
+	options.dialect = app.parameters["rdialect"].as<std::string>().c_str();
+	options.outputDirectory = app.parameters["snapshotdir"].as<std::string>();
+	options.size = app.parameters["snapshotsize"].as<uint16_t>();
+	options.lutStructural = app.parameters["lut"].as<std::string>().empty() ? settings.getPropertyAs<std::string>( "lutStructural" ) : app.parameters["lut"].as<std::string>();
+	options.lutStatistical = app.parameters["zmaplut"].as<std::string>().empty() ? settings.getPropertyAs<std::string>( "lutZMap" ) : app.parameters["zmaplut"].as<std::string>();
+	options.lowerThreshold = app.parameters["lowerthreshold"].as<double>();
+	options.upperThreshold = app.parameters["upperthreshold"].as<double>();
+	options.opacity = app.parameters["opacity"].as<double>();
+	options.trueZeroStructural = settings.getPropertyAs<bool>( "setZeroToBlackStructural" );
+	options.trueZeroStatistical = settings.getPropertyAs<bool>( "setZeroToBlackStatistical" );
+
+	if( !util::Singletons::get<color::Color, 10>().hasColormap( options.lutStructural ) || !util::Singletons::get<color::Color, 10>().hasColormap( options.lutStatistical ) ) {
+		std::cerr << "Unknown colormap." << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	util::slist zmapFileList = app.parameters["zmap"];
+
+	if( !zmapFileList.size() ) {
+		zmapFileList = app.parameters["stats"];
+	}
+
+	const std::vector<SnapshotBatch::Subject> subjects = SnapshotBatch::createSubjects( app.parameters["in"].as<util::slist>(), zmapFileList );
+	SnapshotBatch batch( options, views );
+	return batch.run( subjects, parallel::getNumberOfThreads( settings ) ) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+}
 
 int main( int argc, char *argv[] )
 {
@@ -60,6 +199,11 @@ int main( int argc, char *argv[] )
 	std::string orgName = "cbs.mpg.de";
 	QCoreApplication::setApplicationName( appName.c_str() );
 	QCoreApplication::setOrganizationName( orgName.c_str() );
+
+	if( isSnapshotMode( argc, argv ) ) {
+		return renderSnapshots( appName, argc, argv );
+	}
+
 	//setting up vast graphics_system
 #if QT_VERSION >= 0x040500
 	const char *graphics_system = getenv( "VAST_GRAPHICS_SYSTEM" );
@@ -79,30 +223,7 @@ int main( int argc, char *argv[] )
 #endif
 
 	qt4::IOQtApplication app( appName.c_str(), false, false );
-	app.parameters["in"] = util::slist();
-	app.parameters["in"].needed() = false;
-	app.parameters["in"].setDescription( "The input image file list." );
-	app.parameters["zmap"] = util::slist();
-	app.parameters["zmap"].needed() = false;
-	app.parameters["zmap"].setDescription( "The input image file list is interpreted as statistical maps. " );
-	//alias to zmap
-	app.parameters["stats"] = util::slist();
-	app.parameters["stats"].needed() = false;
-	app.parameters["stats"].setDescription( "The input image file list is interpreted as statistical maps. " );
-	app.parameters["rf"] = std::string();
-	app.parameters["rf"].needed() = false;
-	app.parameters["rf"].setDescription( "Override automatic detection of file suffix for reading with given value" );
-	app.parameters["rf"].hidden() = true;
-	app.parameters["rdialect"] = std::string();
-	app.parameters["rdialect"].needed() = false;
-	app.parameters["rdialect"].hidden() = true;
-	app.parameters["rdialect"].setDescription( "Dialect for reading" );
-	app.parameters["split"] = false;
-	app.parameters["split"].needed() = false;
-	app.parameters["split"].setDescription( "Show each image in a separate view" );
-	app.parameters["widget"] = std::string();
-	app.parameters["widget"].needed() = false;
-	app.parameters["widget"].setDescription( "Use specific widget" );
+	addParameters( app.parameters );
 	app.init( argc, argv, false );
 	QViewerCore *core = new QViewerCore;
 	boost::shared_ptr<qt4::QDefaultMessagePrint> logging_hanlder_runtime ( new qt4::QDefaultMessagePrint( verbose_info ) );
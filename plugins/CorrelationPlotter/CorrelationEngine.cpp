@@ -0,0 +1,116 @@
+/****************************************************************
+ *
+ * <Copyright information>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *
+ * CorrelationEngine.cpp
+ *
+ * Description:
+ *
+ *  Created on: Oct 19, 2026
+ ******************************************************************/
+#include "CorrelationEngine.hpp"
+#include <QTime>
+
+namespace isis
+{
+namespace viewer
+{
+namespace plugin
+{
+
+const size_t CorrelationEngine::blockSize;
+
+CorrelationEngine::CorrelationEngine ( const size_t &numberOfVoxels, const unsigned short &numberOfThreads )
+	: m_Matrix( 0 ),
+	  m_NumberOfThreads( numberOfThreads ),
+	  m_NumberOfBlocks( ( numberOfVoxels + blockSize - 1 ) / blockSize ),
+	  m_Seed( 0 ),
+	  m_PublishedBlocks( 0 ),
+	  m_Result( numberOfVoxels, 0 ),
+	  m_BlockFinished( m_NumberOfBlocks, QAtomicInt( 0 ) ),
+	  m_NextBlock( 0 ),
+	  m_Cancel( 0 )
+{}
+
+CorrelationEngine::~CorrelationEngine()
+{
+	cancel();
+}
+
+void CorrelationEngine::cancel()
+{
+	m_Cancel = 1;
+	wait();
+	m_Cancel = 0;
+}
+
+void CorrelationEngine::calculate ( const CorrelationMatrix &matrix, const size_t &seed )
+{
+	cancel();
+	m_Matrix = &matrix;
+	m_Seed = seed;
+	m_PublishedBlocks = 0;
+	m_NextBlock = 0;
+
+	for( size_t block = 0; block < m_NumberOfBlocks; block++ ) {
+		m_BlockFinished[block] = 0;
+	}
+
+	start();
+}
+
+std::pair< size_t, size_t > CorrelationEngine::takeFinishedVoxels()
+{
+	const size_t first = m_PublishedBlocks;
+
+	//only a contiguous range is returned, blocks finished out of order are taken by the next call
+	while( m_PublishedBlocks < m_NumberOfBlocks && m_BlockFinished[m_PublishedBlocks].fetchAndAddAcquire( 0 ) ) {
+		m_PublishedBlocks++;
+	}
+
+	return std::make_pair( first * blockSize, std::min( m_PublishedBlocks * blockSize, m_Result.size() ) );
+}
+
+void CorrelationEngine::CorrelateOp::operator() ( const size_t &, const size_t &, const unsigned short & )
+{
+	size_t block;
+
+	while( !engine->m_Cancel && ( block = engine->m_NextBlock.fetchAndAddRelaxed( 1 ) ) < engine->m_NumberOfBlocks ) {
+		const size_t first = block * blockSize;
+		const size_t last = std::min( first + blockSize, engine->m_Result.size() );
+		engine->m_Matrix->correlate( engine->m_Seed, &engine->m_Result[first], first, last );
+		engine->m_BlockFinished[block].fetchAndStoreRelease( 1 );
+	}
+}
+
+void CorrelationEngine::run()
+{
+	QTime timer;
+	timer.start();
+	//every thread takes the next free block until all are done
+	CorrelateOp op = { this };
+	parallel::forEachRange( 0, m_NumberOfThreads, op, m_NumberOfThreads );
+
+	if( !m_Cancel ) {
+		LOG( Dev, verbose_info ) << "Calculated the correlation map in " << timer.elapsed() << " ms.";
+	}
+}
+
+}
+}
+}
@@ -0,0 +1,89 @@
+/****************************************************************
+ *
+ * <Copyright information>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *
+ * CorrelationEngine.hpp
+ *
+ * Description:
+ *
+ *  Created on: Oct 19, 2026
+ ******************************************************************/
+#ifndef CORRELATIONENGINE_HPP
+#define CORRELATIONENGINE_HPP
+
+#include "CorrelationMatrix.hpp"
+
+namespace isis
+{
+namespace viewer
+{
+namespace plugin
+{
+
+/**
+ * Calculates correlation maps from a CorrelationMatrix in a background thread.
+ * The volume is split into blocks which the worker threads take in memory order,
+ * so the map fills up slab by slab and finished blocks can be shown while the rest is still calculated.
+ * Requesting a new seed cancels the running calculation.
+ */
+class CorrelationEngine : public QThread
+{
+public:
+	CorrelationEngine( const size_t &numberOfVoxels, const unsigned short &numberOfThreads );
+	~CorrelationEngine();
+
+	///cancels the running calculation and starts the one for the voxel seed using the ready matrix
+	void calculate( const CorrelationMatrix &matrix, const size_t &seed );
+	///stops the running calculation, the finished voxels stay valid
+	void cancel();
+
+	/**
+	 * Returns the voxels [first, last) that were finished since the last call.
+	 * Their correlations are stored in getResult() and stay valid until the next call of calculate().
+	 */
+	std::pair<size_t, size_t> takeFinishedVoxels();
+
+	const std::vector<double> &getResult() const { return m_Result; }
+
+protected:
+	void run();
+
+private:
+	static const size_t blockSize = 4096;
+
+	struct CorrelateOp {
+		CorrelationEngine *engine;
+		void operator()( const size_t &, const size_t &, const unsigned short & );
+	};
+
+	const CorrelationMatrix *m_Matrix;
+	const unsigned short m_NumberOfThreads;
+	const size_t m_NumberOfBlocks;
+	size_t m_Seed;
+	size_t m_PublishedBlocks;
+	std::vector<double> m_Result;
+	std::vector<QAtomicInt> m_BlockFinished;
+	QAtomicInt m_NextBlock;
+	QAtomicInt m_Cancel;
+};
+
+}
+}
+}
+
+#endif // CORRELATIONENGINE_HPP
@@ -0,0 +1,262 @@
+/****************************************************************
+ *
+ * <Copyright information>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *
+ * CorrelationMatrix.cpp
+ *
+ * Description:
+ *
+ *  Created on: Oct 19, 2026
+ ******************************************************************/
+#include "CorrelationMatrix.hpp"
+#include <QTime>
+
+namespace isis
+{
+namespace viewer
+{
+namespace plugin
+{
+
+const size_t CorrelationMatrix::blockSize;
+
+CorrelationMatrix::CorrelationMatrix ( const ImageHolder::Pointer image, const unsigned short &numberOfThreads )
+	: m_Image( image ),
+	  m_Source( 0 ),
+	  m_NumberOfThreads( numberOfThreads ),
+	  m_RowLength( image->getImageSize()[3] ),
+	  m_RowOfVoxel( image->getImageSize()[0] * image->getImageSize()[1] * image->getImageSize()[2], -1 ),
+	  m_Ready( 0 ),
+	  m_Cancel( 0 )
+{}
+
+CorrelationMatrix::CorrelationMatrix ( const CorrelationMatrix &source, const size_t &numberOfComponents, const unsigned short &numberOfThreads )
+	: m_Image( source.m_Image ),
+	  m_Source( &source ),
+	  m_NumberOfThreads( numberOfThreads ),
+	  m_RowLength( std::max<size_t>( 1, std::min( numberOfComponents, std::min( source.getRowLength(), source.getNumberOfRows() ) ) ) ),
+	  m_RowOfVoxel( source.m_RowOfVoxel ),
+	  m_Ready( 0 ),
+	  m_Cancel( 0 )
+{}
+
+CorrelationMatrix::~CorrelationMatrix()
+{
+	m_Cancel = 1;
+	wait();
+}
+
+void CorrelationMatrix::run()
+{
+	QTime timer;
+	timer.start();
+
+	if( m_Source ) {
+		project();
+
+		if( !m_Cancel ) {
+			LOG( Dev, info ) << "Approximated the time series of " << m_Image->getImageProperties().fileName << " with "
+							 << m_RowLength << " components in " << timer.elapsed() << " ms.";
+			m_Ready = 1;
+		}
+
+		return;
+	}
+
+	switch( m_Image->getImageProperties().majorTypeID ) {
+	case data::ValueArray<bool>::staticID:
+		fill<bool>();
+		break;
+	case data::ValueArray<int8_t>::staticID:
+		fill<int8_t>();
+		break;
+	case data::ValueArray<uint8_t>::staticID:
+		fill<uint8_t>();
+		break;
+	case data::ValueArray<int16_t>::staticID:
+		fill<int16_t>();
+		break;
+	case data::ValueArray<uint16_t>::staticID:
+		fill<uint16_t>();
+		break;
+	case data::ValueArray<int32_t>::staticID:
+		fill<int32_t>();
+		break;
+	case data::ValueArray<uint32_t>::staticID:
+		fill<uint32_t>();
+		break;
+	case data::ValueArray<int64_t>::staticID:
+		fill<int64_t>();
+		break;
+	case data::ValueArray<uint64_t>::staticID:
+		fill<uint64_t>();
+		break;
+	case data::ValueArray<float>::staticID:
+		fill<float>();
+		break;
+	case data::ValueArray<double>::staticID:
+		fill<double>();
+		break;
+	default:
+		LOG( Runtime, error ) << "Can not calculate correlations for images of type " << m_Image->getImageProperties().majorTypeName;
+		return;
+	}
+
+	if( !m_Cancel ) {
+		LOG( Dev, info ) << "Prepared the time series of " << m_Image->getImageProperties().fileName << " in " << timer.elapsed() << " ms.";
+		m_Ready = 1;
+	}
+}
+
+void CorrelationMatrix::correlate ( const size_t &seed, double *map, const size_t &first, const size_t &last ) const
+{
+	const ValueType *seedRow = getRow( seed );
+
+	for( size_t voxel = first; voxel < last; voxel++ ) {
+		const ValueType *row = getRow( voxel );
+		map[voxel - first] = seedRow && row ? dot( seedRow, row, m_RowLength ) : 0;
+	}
+}
+
+void CorrelationMatrix::project()
+{
+	//subspace iteration: the basis converges to the right singular vectors of the largest singular values of the source
+	const size_t rows = m_Source->getNumberOfRows();
+	const size_t n = m_Source->getRowLength();
+	const size_t k = m_RowLength;
+	const unsigned short numberOfIterations = 3;
+	std::vector<double> basis( k * n );
+	//a fixed start makes the approximation reproducible
+	uint32_t state = 1;
+
+	for( size_t i = 0; i < basis.size(); i++ ) {
+		state = state * 1664525u + 1013904223u;
+		basis[i] = state / 4294967296. - 0.5;
+	}
+
+	orthonormalize( basis );
+	std::vector<ValueType> projection( rows * k );
+	std::vector<ValueType> floatBasis( basis.begin(), basis.end() );
+	std::vector< std::vector<double> > partialBases( m_NumberOfThreads, std::vector<double>( k * n ) );
+
+	for( unsigned short iteration = 0; iteration < numberOfIterations && !m_Cancel; iteration++ ) {
+		ProjectOp projectOp = { *m_Source, floatBasis, k, false, projection };
+		parallel::forEachRange( 0, rows, projectOp, m_NumberOfThreads, blockSize );
+		BackProjectOp backProjectOp = { *m_Source, projection, k, partialBases };
+		const unsigned short parts = parallel::forEachRange( 0, rows, backProjectOp, m_NumberOfThreads, blockSize );
+		std::fill( basis.begin(), basis.end(), 0 );
+
+		for( unsigned short part = 0; part < parts; part++ ) {
+			for( size_t i = 0; i < basis.size(); i++ ) {
+				basis[i] += partialBases[part][i];
+			}
+		}
+
+		orthonormalize( basis );
+		std::copy( basis.begin(), basis.end(), floatBasis.begin() );
+	}
+
+	if( !m_Cancel ) {
+		//the projected rows are shorter than the unit length source rows, so they are normalized again
+		ProjectOp projectOp = { *m_Source, floatBasis, k, true, m_Matrix };
+		m_Matrix.resize( rows * k );
+		parallel::forEachRange( 0, rows, projectOp, m_NumberOfThreads, blockSize );
+	}
+}
+
+void CorrelationMatrix::orthonormalize ( std::vector< double > &basis ) const
+{
+	const size_t n = m_Source->getRowLength();
+
+	//modified Gram-Schmidt
+	for( size_t j = 0; j < m_RowLength; j++ ) {
+		double *vector = &basis[j * n];
+
+		for( size_t i = 0; i < j; i++ ) {
+			const double *other = &basis[i * n];
+			double projection = 0;
+
+			for( size_t t = 0; t < n; t++ ) {
+				projection += vector[t] * other[t];
+			}
+
+			for( size_t t = 0; t < n; t++ ) {
+				vector[t] -= projection * other[t];
+			}
+		}
+
+		double length = 0;
+
+		for( size_t t = 0; t < n; t++ ) {
+			length += vector[t] * vector[t];
+		}
+
+		//a vector depending on the previous ones does not contribute to the approximation
+		const double inverseLength = length > 1e-24 ? 1. / std::sqrt( length ) : 0;
+
+		for( size_t t = 0; t < n; t++ ) {
+			vector[t] *= inverseLength;
+		}
+	}
+}
+
+void CorrelationMatrix::ProjectOp::operator() ( const size_t &firstRow, const size_t &lastRow, const unsigned short & )
+{
+	const size_t n = source.m_RowLength;
+
+	for( size_t r = firstRow; r < lastRow; r++ ) {
+		ValueType *row = &projection[r * numberOfComponents];
+
+		for( size_t j = 0; j < numberOfComponents; j++ ) {
+			row[j] = dot( &source.m_Matrix[r * n], &basis[j * n], n );
+		}
+
+		const double length = normalize ? std::sqrt( dot( row, row, numberOfComponents ) ) : 0;
+
+		//a row orthogonal to the subspace stays 0 and correlates with nothing
+		if( length > 0 ) {
+			for( size_t j = 0; j < numberOfComponents; j++ ) {
+				row[j] /= length;
+			}
+		}
+	}
+}
+
+void CorrelationMatrix::BackProjectOp::operator() ( const size_t &firstRow, const size_t &lastRow, const unsigned short &threadIndex )
+{
+	const size_t n = source.m_RowLength;
+	std::vector<double> &basis = partialBases[threadIndex];
+	std::fill( basis.begin(), basis.end(), 0 );
+
+	for( size_t r = firstRow; r < lastRow; r++ ) {
+		const ValueType *row = &source.m_Matrix[r * n];
+
+		for( size_t j = 0; j < numberOfComponents; j++ ) {
+			const double weight = projection[r * numberOfComponents + j];
+			double *vector = &basis[j * n];
+
+			for( size_t t = 0; t < n; t++ ) {
+				vector[t] += weight * row[t];
+			}
+		}
+	}
+}
+
+}
+}
+}
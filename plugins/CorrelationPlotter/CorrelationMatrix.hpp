@@ -0,0 +1,229 @@
+/****************************************************************
+ *
+ * <Copyright information>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *
+ * CorrelationMatrix.hpp
+ *
+ * Description:
+ *
+ *  Created on: Oct 19, 2026
+ ******************************************************************/
+#ifndef CORRELATIONMATRIX_HPP
+#define CORRELATIONMATRIX_HPP
+
+#include <QThread>
+#include <QAtomicInt>
+#include <cmath>
+#include "imageholder.hpp"
+
+namespace isis
+{
+namespace viewer
+{
+namespace plugin
+{
+
+/**
+ * The time series of all voxels of a functional image, z-normalized and stored voxel by voxel with contiguous time.
+ * Every row has zero mean and unit length, so the correlation of two voxels is the dot product of their rows.
+ * Voxels without variance (e.g. background) get no row.
+ *
+ * A matrix constructed from another matrix holds the projection of its rows onto their first principal components instead,
+ * normalized to unit length again. The dot product of two projected rows approximates the correlation with rows of only as many values as components.
+ *
+ * The matrix is filled in a background thread by calling start().
+ */
+class CorrelationMatrix : public QThread
+{
+public:
+	typedef float ValueType;
+
+	CorrelationMatrix( const ImageHolder::Pointer image, const unsigned short &numberOfThreads );
+	///creates the low rank approximation of the ready matrix source with the given number of components
+	CorrelationMatrix( const CorrelationMatrix &source, const size_t &numberOfComponents, const unsigned short &numberOfThreads );
+	~CorrelationMatrix();
+
+	bool isReady() const { return m_Ready; }
+
+	size_t getNumberOfVoxels() const { return m_RowOfVoxel.size(); }
+	///the number of timesteps or the number of components of an approximation
+	size_t getRowLength() const { return m_RowLength; }
+	size_t getNumberOfRows() const { return m_RowLength ? m_Matrix.size() / m_RowLength : 0; }
+
+	///returns the row of voxel or NULL if the voxel has no variance
+	const ValueType *getRow( const size_t &voxel ) const {
+		return m_RowOfVoxel[voxel] < 0 ? 0 : &m_Matrix[m_RowOfVoxel[voxel] * m_RowLength];
+	}
+
+	///writes the correlation of the voxels [first, last) with the voxel seed to map[0 .. last - first). Voxels without variance get 0.
+	void correlate( const size_t &seed, double *map, const size_t &first, const size_t &last ) const;
+
+	/**
+	 * Dot product of two rows.
+	 * Eight independent partial sums break the dependency chain of the accumulation,
+	 * so the compiler can keep them in vector registers.
+	 */
+	static double dot( const ValueType *a, const ValueType *b, const size_t &length ) {
+		ValueType sums[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+		const size_t vectorLength = length - length % 8;
+		size_t t = 0;
+
+		for( ; t < vectorLength; t += 8 ) {
+			for( unsigned short i = 0; i < 8; i++ ) {
+				sums[i] += a[t + i] * b[t + i];
+			}
+		}
+
+		double r = 0;
+
+		for( ; t < length; t++ ) {
+			r += a[t] * b[t];
+		}
+
+		for( unsigned short i = 0; i < 8; i++ ) {
+			r += sums[i];
+		}
+
+		return r;
+	}
+
+protected:
+	void run();
+
+private:
+	void project();
+	void orthonormalize( std::vector<double> &basis ) const;
+
+	struct ProjectOp {
+		const CorrelationMatrix &source;
+		const std::vector<ValueType> &basis;
+		const size_t numberOfComponents;
+		///scales every projected row to unit length
+		const bool normalize;
+		std::vector<ValueType> &projection;
+		void operator()( const size_t &firstRow, const size_t &lastRow, const unsigned short & );
+	};
+
+	struct BackProjectOp {
+		const CorrelationMatrix &source;
+		const std::vector<ValueType> &projection;
+		const size_t numberOfComponents;
+		std::vector< std::vector<double> > &partialBases;
+		void operator()( const size_t &firstRow, const size_t &lastRow, const unsigned short &threadIndex );
+	};
+
+	template<typename TYPE>
+	void fill() {
+		const size_t volume = getNumberOfVoxels();
+		const size_t n = m_RowLength;
+		std::vector< std::vector< TypedSegment<TYPE> > > segments;
+
+		for( size_t t = 0; t < n; t++ ) {
+			segments.push_back( m_Image->getTypedSegments<TYPE>( t ) );
+		}
+
+		//first pass: mean and standard deviation of every voxel
+		std::vector<double> sums( volume, 0 );
+		std::vector<double> squareSums( volume, 0 );
+
+		for( size_t t = 0; t < n && !m_Cancel; t++ ) {
+			size_t voxel = 0;
+			BOOST_FOREACH( typename std::vector< TypedSegment<TYPE> >::const_reference segment, segments[t] ) {
+				for( size_t i = 0; i < segment.length; i++, voxel++ ) {
+					const double value = segment.begin[i];
+					sums[voxel] += value;
+					squareSums[voxel] += value * value;
+				}
+			}
+		}
+
+		std::vector<double> means( volume );
+		std::vector<double> norms( volume );
+		int32_t rows = 0;
+
+		for( size_t voxel = 0; voxel < volume; voxel++ ) {
+			means[voxel] = sums[voxel] / n;
+			const double sumOfSquares = squareSums[voxel] - n * means[voxel] * means[voxel];
+
+			//scaling by the length instead of the standard deviation makes the dot product the correlation coefficient
+			if( sumOfSquares > 1e-12 * squareSums[voxel] && sumOfSquares > 0 ) {
+				norms[voxel] = 1. / std::sqrt( sumOfSquares );
+				m_RowOfVoxel[voxel] = rows++;
+			} else {
+				m_RowOfVoxel[voxel] = -1;
+			}
+		}
+
+		LOG( Dev, info ) << rows << " of " << volume << " voxels have a variance. Allocating "
+						 << rows * n * sizeof( ValueType ) / ( 1024. * 1024. ) << " mb for the correlation matrix.";
+		m_Matrix.resize( rows * n );
+		//second pass: transpose blockwise, so the rows of a block stay in the cache
+		FillOp<TYPE> op = { this, segments, means, norms };
+		parallel::forEachRange( 0, ( volume + blockSize - 1 ) / blockSize, op, m_NumberOfThreads );
+	}
+
+	static const size_t blockSize = 256;
+
+	template<typename TYPE>
+	struct FillOp {
+		CorrelationMatrix *matrix;
+		const std::vector< std::vector< TypedSegment<TYPE> > > &segments;
+		const std::vector<double> &means;
+		const std::vector<double> &norms;
+		void operator()( const size_t &firstBlock, const size_t &lastBlock, const unsigned short & ) {
+			const size_t volume = matrix->getNumberOfVoxels();
+
+			for( size_t block = firstBlock; block < lastBlock && !matrix->m_Cancel; block++ ) {
+				for( size_t t = 0; t < matrix->m_RowLength; t++ ) {
+					RunOp runOp = { this, block * blockSize, t };
+					forEachRun( segments[t], block * blockSize, std::min( ( block + 1 ) * blockSize, volume ), runOp );
+				}
+			}
+		}
+		struct RunOp {
+			FillOp *parent;
+			size_t voxel;
+			size_t timestep;
+			void operator()( const TYPE *begin, const size_t &length ) {
+				CorrelationMatrix &matrix = *parent->matrix;
+
+				for( size_t i = 0; i < length; i++, voxel++ ) {
+					if( matrix.m_RowOfVoxel[voxel] >= 0 ) {
+						matrix.m_Matrix[matrix.m_RowOfVoxel[voxel] * matrix.m_RowLength + timestep]
+						= ( begin[i] - parent->means[voxel] ) * parent->norms[voxel];
+					}
+				}
+			}
+		};
+	};
+
+	const ImageHolder::Pointer m_Image;
+	const CorrelationMatrix *m_Source;
+	const unsigned short m_NumberOfThreads;
+	const size_t m_RowLength;
+	std::vector<ValueType> m_Matrix;
+	std::vector<int32_t> m_RowOfVoxel;
+	QAtomicInt m_Ready;
+	QAtomicInt m_Cancel;
+};
+
+}
+}
+}
+
+#endif // CORRELATIONMATRIX_HPP
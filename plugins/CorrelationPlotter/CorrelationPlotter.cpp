@@ -31,7 +31,8 @@
 isis::viewer::plugin::CorrelationPlotterDialog::CorrelationPlotterDialog( QWidget *parent, isis::viewer::QViewerCore *core )
 	: QDialog( parent ),
 	  m_OrigMode( core->getMode() ),
-	  m_ViewerCore( core )
+	  m_ViewerCore( core ),
+	  m_ApproximationComponents( 0 )
 
 {
 	m_Interface.setupUi( this );
@@ -39,14 +40,27 @@ isis::viewer::plugin::CorrelationPlotterDialog::CorrelationPlotterDialog( QWidge
 	m_Interface.correlationType->setCurrentIndex( 0 );
 	m_Interface.lock->setChecked( false );
 	connect( m_Interface.lock, SIGNAL( clicked( bool ) ), this, SLOT( lockClicked() ) );
+	//partial maps are shown while the calculation is running
+	m_PublishTimer.setInterval( 40 );
+	connect( &m_PublishTimer, SIGNAL( timeout() ), this, SLOT( publishCorrelation() ) );
+	//approximated maps are replaced by the exact one when the crosshair rests
+	m_RestTimer.setSingleShot( true );
+	m_RestTimer.setInterval( 300 );
+	connect( &m_RestTimer, SIGNAL( timeout() ), this, SLOT( calculateExactCorrelation() ) );
+	m_Interface.approximate->setChecked( false );
+	m_Interface.components->setEnabled( false );
+	connect( m_Interface.approximate, SIGNAL( clicked( bool ) ), this, SLOT( approximationChanged() ) );
+	connect( m_Interface.components, SIGNAL( editingFinished() ), this, SLOT( approximationChanged() ) );
 
 
 }
 
 void isis::viewer::plugin::CorrelationPlotterDialog::lockClicked()
 {
-	if( m_Interface.lock->isChecked() )  {
-		calculateCorrelation( true );
+	if( !m_Interface.lock->isChecked() )  {
+		m_CurrentVoxelPos = m_CurrentFunctionalImage->getImageProperties().voxelCoords;
+		calculateCorrelation();
+		m_ViewerCore->updateScene();
 	}
 }
 
@@ -66,10 +80,6 @@ void isis::viewer::plugin::CorrelationPlotterDialog::closeEvent( QCloseEvent * )
 {
 	disconnect( m_ViewerCore, SIGNAL( emitPhysicalCoordsChanged( util::fvector3 ) ), this, SLOT( physicalCoordsChanged( util::fvector3 ) ) );
 
-	if( m_CurrentFunctionalImage ) {
-		calculateCorrelation( true );
-	}
-
 	m_ViewerCore->setMode( m_OrigMode );
 	m_ViewerCore->getUICore()->refreshUI();
 
@@ -153,10 +163,11 @@ bool isis::viewer::plugin::CorrelationPlotterDialog::createCorrelationMap()
 			m_CurrentCorrelationMap->getImageProperties().scalingToInternalType.first = util::Value<MapImageType>( 128 );
 			m_CurrentCorrelationMap->getImageProperties().scalingToInternalType.second = util::Value<MapImageType>( 127 );
 			m_CurrentCorrelationMap->getImageProperties().extent = m_CurrentCorrelationMap->getImageProperties().minMax.second->as<double>() -  m_CurrentCorrelationMap->getImageProperties().minMax.first->as<double>();
-			isis::data::ValueArray<InternalFunctionalImageType> imagePtr( ( InternalFunctionalImageType * )
-					calloc( m_CurrentFunctionalImage->getISISImage()->getVolume(), sizeof( InternalFunctionalImageType ) ), m_CurrentFunctionalImage->getISISImage()->getVolume() );
-			m_CurrentFunctionalImage->getISISImage()->copyToMem<InternalFunctionalImageType>( &imagePtr[0], m_CurrentFunctionalImage->getISISImage()->getVolume() );
-			m_InternalChunk.reset( new isis::data::Chunk( imagePtr, size[0], size[1], size[2], size[3] ) );
+			//the time series are normalized in the background, the map is calculated when this is finished
+			m_CorrelationMatrix.reset( new CorrelationMatrix( m_CurrentFunctionalImage, parallel::getNumberOfThreads( *m_ViewerCore->getSettings() ) ) );
+			connect( m_CorrelationMatrix.get(), SIGNAL( finished() ), this, SLOT( preparationFinished() ) );
+			m_Interface.status->setText( tr( "Preparing time series..." ) );
+			m_CorrelationMatrix->start( QThread::LowPriority );
 			m_CurrentCorrelationMap->updateColorMap();
 			util::ivector4 voxelCoords = m_CurrentFunctionalImage->getImageProperties().voxelCoords;
 			util::fvector3 physicalCoords = m_CurrentFunctionalImage->getImageProperties().physicalCoords;
@@ -173,83 +184,97 @@ bool isis::viewer::plugin::CorrelationPlotterDialog::createCorrelationMap()
 }
 
 
-void isis::viewer::plugin::CorrelationPlotterDialog::calculateCorrelation( bool all )
+void isis::viewer::plugin::CorrelationPlotterDialog::preparationFinished()
 {
-	const size_t vol = m_CurrentFunctionalImage->getImageSize()[0] * m_CurrentFunctionalImage->getImageSize()[1] * m_CurrentFunctionalImage->getImageSize()[2];
-	const size_t n = m_CurrentFunctionalImage->getImageSize()[3];
-	double sum_x = 0;
-	double sum_quad_x = 0;
-	InternalFunctionalImageType *vx = &m_InternalChunk->voxel<InternalFunctionalImageType>( m_CurrentVoxelPos[0], m_CurrentVoxelPos[1], m_CurrentVoxelPos[2] );
-
-	for( size_t t = 0; t < n * vol ; t += vol ) {
-		sum_x += vx[t];
-		sum_quad_x += vx[t] * vx[t];
+	if( m_CorrelationMatrix && m_CorrelationMatrix->isReady() ) {
+		m_Interface.status->clear();
+		m_CorrelationEngine.reset( new CorrelationEngine( m_CorrelationMatrix->getNumberOfVoxels(), parallel::getNumberOfThreads( *m_ViewerCore->getSettings() ) ) );
+		connect( m_CorrelationEngine.get(), SIGNAL( finished() ), this, SLOT( publishCorrelation() ) );
+		approximationChanged();
+		calculateCorrelation();
 	}
+}
 
-	const double _x = sum_x / n;
-
-	const double s_x = std::sqrt( ( 1 / float( n - 1 ) ) * ( sum_quad_x - n * _x * _x ) );
+void isis::viewer::plugin::CorrelationPlotterDialog::approximationChanged()
+{
+	m_Interface.components->setEnabled( m_Interface.approximate->isChecked() );
 
-	if( !all ) {
-		for( unsigned int z = 0; z < m_CurrentFunctionalImage->getImageSize()[2]; z++ ) {
-			for( unsigned int y = 0; y < m_CurrentFunctionalImage->getImageSize()[1]; y++ ) {
-				_internCalculateCorrelation( util::ivector4( m_CurrentVoxelPos[0], y, z ), s_x, _x, vx, n, vol );
-			}
-		}
+	if( m_Approximation && m_Interface.approximate->isChecked() && m_ApproximationComponents == m_Interface.components->value() ) {
+		return;
+	}
 
-		for( unsigned int y = 0; y < m_CurrentFunctionalImage->getImageSize()[1]; y++ ) {
-			for( unsigned int x = 0; x < m_CurrentFunctionalImage->getImageSize()[0]; x++ ) {
-				_internCalculateCorrelation( util::ivector4( x, y, m_CurrentVoxelPos[2] ), s_x, _x, vx, n, vol );
-			}
-		}
+	if( m_Approximation ) {
+		//the engine may still read from the approximation
+		m_CorrelationEngine->cancel();
+		m_Approximation.reset();
+		calculateExactCorrelation();
+	}
 
-		for( unsigned int z = 0; z < m_CurrentFunctionalImage->getImageSize()[2]; z++ ) {
-			for( unsigned int x = 0; x < m_CurrentFunctionalImage->getImageSize()[0]; x++ ) {
-				_internCalculateCorrelation( util::ivector4( x, m_CurrentVoxelPos[1], z ), s_x, _x, vx, n, vol );
-			}
-		}
+	if( m_Interface.approximate->isChecked() && m_CorrelationMatrix && m_CorrelationMatrix->isReady() ) {
+		m_ApproximationComponents = m_Interface.components->value();
+		m_Approximation.reset( new CorrelationMatrix( *m_CorrelationMatrix, m_ApproximationComponents, parallel::getNumberOfThreads( *m_ViewerCore->getSettings() ) ) );
+		connect( m_Approximation.get(), SIGNAL( finished() ), this, SLOT( approximationFinished() ) );
+		m_Interface.status->setText( tr( "Approximating time series..." ) );
+		m_Approximation->start( QThread::LowPriority );
 	} else {
+		m_Interface.status->clear();
+	}
+}
 
+void isis::viewer::plugin::CorrelationPlotterDialog::approximationFinished()
+{
+	if( m_Approximation && m_Approximation->isReady() ) {
+		m_Interface.status->clear();
+	}
+}
 
-		for( unsigned int z = 0; z < m_CurrentFunctionalImage->getImageSize()[2]; z++ ) {
-			for( unsigned int y = 0; y < m_CurrentFunctionalImage->getImageSize()[1]; y++ ) {
-				for( unsigned int x = 0; x < m_CurrentFunctionalImage->getImageSize()[0]; x++ ) {
-					_internCalculateCorrelation( util::ivector4( x, y, z ), s_x, _x, vx, n, vol );
-				}
-			}
-		}
+void isis::viewer::plugin::CorrelationPlotterDialog::calculateCorrelation()
+{
+	if( !m_CorrelationEngine ) {
+		return;
 	}
 
+	if( m_Approximation && m_Approximation->isReady() ) {
+		m_CorrelationEngine->calculate( *m_Approximation, getSeed() );
+		m_RestTimer.start();
+	} else {
+		m_CorrelationEngine->calculate( *m_CorrelationMatrix, getSeed() );
+	}
 
+	m_PublishTimer.start();
 }
 
-void isis::viewer::plugin::CorrelationPlotterDialog::_internCalculateCorrelation( const isis::util::ivector4 &vec, const double &s_x, const double &_x, const InternalFunctionalImageType *vx, const size_t &n, const size_t &vol )
+void isis::viewer::plugin::CorrelationPlotterDialog::calculateExactCorrelation()
 {
-	double sum_quad_y = 0;
-	double sum_y = 0;
-	double sum_xy = 0;
-	InternalFunctionalImageType *vy = &m_InternalChunk->voxel<InternalFunctionalImageType>( vec[0], vec[1], vec[2] );
-
-	for ( size_t t = 0; t < n * vol; t += vol ) {
-		sum_quad_y += vy[t] * vy[t];
-		sum_y += vy[t];
-		sum_xy += vx[t] * vy[t];
+	if( !m_CorrelationEngine ) {
+		return;
 	}
 
-	const double _y = sum_y / n;
-
-	const double s_xy = ( 1 / float( n - 1 ) ) * ( sum_xy - n * _x * _y );
-
-	const double s_y = std::sqrt( ( 1 / float( n - 1 ) ) * ( sum_quad_y - n * _y * _y ) );
+	m_CorrelationEngine->calculate( *m_CorrelationMatrix, getSeed() );
+	m_PublishTimer.start();
+}
 
-	double r_xy = s_xy / ( s_x * s_y );
+size_t isis::viewer::plugin::CorrelationPlotterDialog::getSeed() const
+{
+	const util::ivector4 size = m_CurrentFunctionalImage->getImageSize();
+	return m_CurrentVoxelPos[0] + size[0] * ( m_CurrentVoxelPos[1] + size[1] * m_CurrentVoxelPos[2] );
+}
 
-	if( !std::isnan( r_xy ) ) {
-		m_CurrentCorrelationMap->setTypedVoxel<MapImageType>( vec[0], vec[1], vec[2], 0, r_xy );
-	} else {
-		m_CurrentCorrelationMap->setTypedVoxel<MapImageType>( vec[0], vec[1], vec[2], 0, 0 );
+void isis::viewer::plugin::CorrelationPlotterDialog::publishCorrelation()
+{
+	if( !m_CorrelationEngine ) {
+		return;
 	}
 
-}
+	if( m_CorrelationEngine->isFinished() ) {
+		m_PublishTimer.stop();
+	}
 
+	const std::pair<size_t, size_t> voxels = m_CorrelationEngine->takeFinishedVoxels();
 
+	if( voxels.second > voxels.first ) {
+		//one bulk write and one repaint for all voxels finished since the last call
+		m_CurrentCorrelationMap->setTypedVoxels<MapImageType>( 0, voxels.first, voxels.second, &m_CorrelationEngine->getResult()[voxels.first] );
+		m_ViewerCore->emitImageContentChanged( m_CurrentCorrelationMap );
+	}
+}
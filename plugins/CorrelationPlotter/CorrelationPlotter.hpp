@@ -31,6 +31,8 @@
 #include "ui_correlationPlotter.h"
 #include <QWidget>
 #include "qviewercore.hpp"
+#include "CorrelationEngine.hpp"
+#include <QTimer>
 #include <cmath>
 
 namespace isis
@@ -44,7 +46,6 @@ class CorrelationPlotterDialog : public QDialog
 {
 	Q_OBJECT
 	typedef double MapImageType;
-	typedef uint16_t InternalFunctionalImageType;
 public:
 	CorrelationPlotterDialog( QWidget *parent, QViewerCore *core );
 
@@ -53,21 +54,30 @@ public Q_SLOTS:
 	virtual void closeEvent( QCloseEvent * );
 	void physicalCoordsChanged( util::fvector3 );
 	bool createCorrelationMap();
-	void calculateCorrelation( bool all = false );
+	void calculateCorrelation();
 	void lockClicked();
+	void preparationFinished();
+	void publishCorrelation();
+	void approximationChanged();
+	void approximationFinished();
+	void calculateExactCorrelation();
 
 private:
+	size_t getSeed() const;
+
 	ViewerCoreBase::Mode m_OrigMode;
 	Ui::correlationPlotterDialog m_Interface;
 	QViewerCore *m_ViewerCore;
 	boost::shared_ptr<ImageHolder> m_CurrentCorrelationMap;
 	boost::shared_ptr<ImageHolder> m_CurrentFunctionalImage;
-	boost::scoped_ptr< isis::data::Chunk > m_InternalChunk;
+	boost::scoped_ptr< CorrelationMatrix > m_CorrelationMatrix;
+	boost::scoped_ptr< CorrelationMatrix > m_Approximation;
+	int m_ApproximationComponents;
+	boost::scoped_ptr< CorrelationEngine > m_CorrelationEngine;
+	QTimer m_PublishTimer;
+	QTimer m_RestTimer;
 	util::ivector4 m_CurrentVoxelPos;
 
-
-	void _internCalculateCorrelation( const util::ivector4 &vec, const double &s_x, const double &_x, const InternalFunctionalImageType *vx, const size_t &n, const size_t &vol  );
-
 };
 
 
@@ -46,58 +46,132 @@ isis::viewer::plugin::HistogramDialog::HistogramDialog( QWidget *parent, isis::v
 	QPen pen;
 	pen.setStyle( Qt::DashDotLine );
 	m_Grid->setPen( pen );
-	layout()->addWidget( m_Plotter );
+	m_Interface.gridLayout->addWidget( m_Plotter, 1, 0 );
+	m_Interface.binsSpin->setValue( m_ViewerCore->getSettings()->getPropertyAs<uint16_t>( "histogramBins" ) );
+	m_Interface.logScaleCheck->setChecked( m_ViewerCore->getSettings()->getPropertyAs<bool>( "histogramLogScale" ) );
+	m_Interface.omitZeroCheck->setChecked( m_ViewerCore->getSettings()->getPropertyAs<bool>( "histogramOmitZero" ) );
+	setAxisScaleEngine();
 	connect( m_ViewerCore, SIGNAL( emitUpdateScene() ), this, SLOT( paintHistogram() ) );
+	connect( m_Interface.binsSpin, SIGNAL( editingFinished() ), this, SLOT( optionsChanged() ) );
+	connect( m_Interface.logScaleCheck, SIGNAL( toggled( bool ) ), this, SLOT( optionsChanged() ) );
+	connect( m_Interface.omitZeroCheck, SIGNAL( toggled( bool ) ), this, SLOT( optionsChanged() ) );
 }
 
+void isis::viewer::plugin::HistogramDialog::setAxisScaleEngine()
+{
+	if( m_ViewerCore->getSettings()->getPropertyAs<bool>( "histogramLogScale" ) ) {
+		m_Plotter->setAxisScaleEngine( QwtPlot::yLeft, new QwtLog10ScaleEngine );
+	} else {
+		m_Plotter->setAxisScaleEngine( QwtPlot::yLeft, new QwtLinearScaleEngine );
+	}
+}
+
+void isis::viewer::plugin::HistogramDialog::optionsChanged()
+{
+	m_ViewerCore->getSettings()->setPropertyAs<uint16_t>( "histogramBins", m_Interface.binsSpin->value() );
+	m_ViewerCore->getSettings()->setPropertyAs<bool>( "histogramLogScale", m_Interface.logScaleCheck->isChecked() );
+	m_ViewerCore->getSettings()->setPropertyAs<bool>( "histogramOmitZero", m_Interface.omitZeroCheck->isChecked() );
+	setAxisScaleEngine();
+	m_LastSignature.clear();
+	paintHistogram();
+}
+
+
+std::vector<size_t> isis::viewer::plugin::HistogramDialog::getSignature() const
+{
+	std::vector<size_t> signature;
+	signature.push_back( reinterpret_cast<size_t>( m_ViewerCore->getCurrentImage().get() ) );
+	BOOST_FOREACH( ImageHolder::Vector::const_reference image, m_ViewerCore->getImageVector() ) {
+		signature.push_back( reinterpret_cast<size_t>( image.get() ) );
+		signature.push_back( image->getContentRevision() );
+		signature.push_back( image->getImageProperties().timestep );
+		signature.push_back( image->getImageProperties().isVisible );
+	}
+	return signature;
+}
 
 void isis::viewer::plugin::HistogramDialog::paintHistogram()
 {
-	m_Plotter->clear();
+	if( !isVisible() ) {
+		return;
+	}
 
-	if( m_ViewerCore->hasImage() && isVisible() ) {
-		std::stringstream title;
-		title << "Histogram of " << boost::filesystem::path( m_ViewerCore->getCurrentImage()->getImageProperties().fileName ).leaf();
+	if( !m_ViewerCore->hasImage() ) {
+		m_LastSignature.clear();
+		return;
+	}
 
-		if( m_ViewerCore->getCurrentImage()->getImageSize()[3] > 1 ) {
-			title << " (volume " << m_ViewerCore->getCurrentImage()->getImageProperties().timestep << ")";
-		}
+	//most of the scene updates (e.g. navigating through the image) do not affect the histograms
+	const std::vector<size_t> signature = getSignature();
 
-		m_Plotter->setTitle( title.str().c_str() );
-		double xData[255];
-		BOOST_FOREACH( ImageHolder::Vector::const_reference image, m_ViewerCore->getImageVector() ) {
+	if( signature == m_LastSignature ) {
+		return;
+	}
 
+	m_LastSignature = signature;
+	std::stringstream title;
+	title << "Histogram of " << boost::filesystem::path( m_ViewerCore->getCurrentImage()->getImageProperties().fileName ).leaf();
 
-			if( !image->getImageProperties().isRGB ) {
-				const std::vector<double> histogram = operation::NativeImageOps::getHistogramFromImage( image );
-				const double scaling = image->getImageProperties().scalingToInternalType.first->as<double>();
-				const double offset = image->getImageProperties().scalingToInternalType.second->as<double>();
+	if( m_ViewerCore->getCurrentImage()->getImageSize()[3] > 1 ) {
+		title << " (volume " << m_ViewerCore->getCurrentImage()->getImageProperties().timestep << ")";
+	}
 
-				for( unsigned short i = 0; i < 255; i++ ) {
-					xData[i] = ( double )( i - offset ) / scaling ;
-				}
+	m_Plotter->setTitle( title.str().c_str() );
+	const uint16_t numberOfBins = m_ViewerCore->getSettings()->getPropertyAs<uint16_t>( "histogramBins" );
+	const bool omitZero = m_ViewerCore->getSettings()->getPropertyAs<bool>( "histogramOmitZero" );
+	const bool logScale = m_ViewerCore->getSettings()->getPropertyAs<bool>( "histogramLogScale" );
+	std::map<const ImageHolder *, QwtPlotCurve *> curves;
+	BOOST_FOREACH( ImageHolder::Vector::const_reference image, m_ViewerCore->getImageVector() ) {
+		if( !image->getImageProperties().isRGB ) {
+			const Histogram histogram = operation::NativeImageOps::getHistogramFromImage( image, numberOfBins, omitZero );
+			std::vector<double> xData( histogram.bins.size() );
+			std::vector<double> yData( histogram.bins.size() );
+
+			for( size_t i = 0; i < histogram.bins.size(); i++ ) {
+				xData[i] = histogram.getBinCenter( i );
+				//empty bins can not be shown logarithmically
+				yData[i] = logScale ? std::max( histogram.bins[i], 1. ) : histogram.bins[i];
+			}
 
-				QwtPlotCurve *curve = new QwtPlotCurve();
-				curve->detach();
+			QwtPlotCurve *curve;
+			const std::map<const ImageHolder *, QwtPlotCurve *>::iterator iter = m_Curves.find( image.get() );
 
-				if ( image.get() == m_ViewerCore->getCurrentImage().get() ) {
+			if( iter != m_Curves.end() ) {
+				curve = iter->second;
+				m_Curves.erase( iter );
+			} else {
+				curve = new QwtPlotCurve();
+			}
+
+			curves[image.get()] = curve;
+			curve->detach();
+
+			if ( image.get() == m_ViewerCore->getCurrentImage().get() ) {
+				curve->attach( m_Plotter );
+				curve->setPen( QPen( Qt::red ) );
+			} else {
+				if( image->getImageProperties().isVisible ) {
 					curve->attach( m_Plotter );
-					curve->setPen( QPen( Qt::red ) );
-				} else {
-					if( image->getImageProperties().isVisible ) {
-						curve->attach( m_Plotter );
-					}
-
-					QPen pen;
-					pen.setBrush( QBrush( Qt::gray, Qt::Dense1Pattern ) );
-					curve->setPen( pen );
 				}
 
-				curve->setData( xData, &histogram[0], 255 );
+				QPen pen;
+				pen.setBrush( QBrush( Qt::gray, Qt::Dense1Pattern ) );
+				curve->setPen( pen );
+			}
+
+			if( !xData.empty() ) {
+				curve->setData( &xData[0], &yData[0], xData.size() );
 			}
 		}
-		m_Zoomer->setZoomBase( true );
 	}
+	//curves of images that are gone
+	for( std::map<const ImageHolder *, QwtPlotCurve *>::iterator iter = m_Curves.begin(); iter != m_Curves.end(); iter++ ) {
+		iter->second->detach();
+		delete iter->second;
+	}
+	m_Curves = curves;
+	m_Zoomer->setZoomBase( true );
+	m_Plotter->replot();
 }
 void isis::viewer::plugin::HistogramDialog::showEvent( QShowEvent * )
 {
@@ -35,6 +35,8 @@
 #include "qwt_plot_grid.h"
 #include "qwt_plot_zoomer.h"
 #include "qwt_plot_picker.h"
+#include "qwt_scale_engine.h"
+#include <map>
 
 namespace isis
 {
@@ -53,6 +55,7 @@ public:
 public Q_SLOTS:
 	void paintHistogram();
 	void showEvent( QShowEvent * );
+	void optionsChanged();
 private:
 	Ui::histogramDialog m_Interface;
 	QViewerCore *m_ViewerCore;
@@ -61,6 +64,13 @@ private:
 	QwtPlotZoomer *m_Zoomer;
 	unsigned short m_length;
 
+	///one curve per image, reused as long as the image is loaded
+	std::map<const ImageHolder *, QwtPlotCurve *> m_Curves;
+	///everything the plot depends on. If it is unchanged since the last paint there is nothing to do.
+	std::vector<size_t> m_LastSignature;
+	std::vector<size_t> getSignature() const;
+	void setAxisScaleEngine();
+
 
 
 };
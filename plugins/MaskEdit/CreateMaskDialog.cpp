@@ -57,6 +57,8 @@ void CreateMaskDialog::showEvent( QShowEvent * )
 		BOOST_FOREACH( std::list<std::string>::const_reference type, isis::viewer::getSupportedTypeList() ) {
 			m_Interface.maskType->addItem( type.c_str() );
 		}
+		//only the internal representation of masks is run length encoded, their original data is not. So 8 bit masks need the least memory
+		m_Interface.maskType->setCurrentIndex( m_Interface.maskType->findText( "u8bit" ) );
 
 		if( m_MaskEditDialog->m_ViewerCore->hasImage() ) {
 			const util::fvector3 &voxelSize = m_MaskEditDialog->m_ViewerCore->getCurrentImage()->getISISImage()->getPropertyAs<util::fvector3>( "voxelSize" ) ;
@@ -119,6 +121,7 @@ void CreateMaskDialog::createMask()
 			return;
 		}
 
+		m_MaskEditDialog->finishStroke();
 		m_MaskEditDialog->m_CurrentMask = maskImage;
 		m_MaskEditDialog->m_CurrentMask->getImageProperties().extent = m_MaskEditDialog->m_CurrentMask->getImageProperties().minMax.second->as<double>() -  m_MaskEditDialog->m_CurrentMask->getImageProperties().minMax.first->as<double>();
 		m_MaskEditDialog->m_CurrentMask->getImageProperties().opacity = 0.5;
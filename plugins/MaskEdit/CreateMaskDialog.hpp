@@ -99,6 +99,9 @@ private:
 		}
 
 		retImage = m_MaskEditDialog->m_ViewerCore->addImage( mask, ImageHolder::structural_image );
+		//the internal representation of masks is kept run length encoded
+		retImage->getIngestOptions().isMask = true;
+		retImage->synchronize();
 		retImage->getImageProperties().minMax.first = isis::util::Value<TYPE>( std::numeric_limits<TYPE>::min() );
 		retImage->getImageProperties().minMax.second = isis::util::Value<TYPE>( std::numeric_limits<TYPE>::max() );
 		retImage->getImageProperties().scalingMinMax.first = retImage->getImageProperties().minMax.first->as<double>();
@@ -0,0 +1,227 @@
+/****************************************************************
+ *
+ * <Copyright information>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *
+ * FloodFill.cpp
+ *
+ * Description:
+ *
+ *  Created on: Oct 19, 2026
+ ******************************************************************/
+#include "FloodFill.hpp"
+
+namespace isis
+{
+namespace viewer
+{
+namespace plugin
+{
+
+FloodFill::FloodFill ( const unsigned short &numberOfThreads )
+	: m_NumberOfThreads( numberOfThreads ),
+	  m_Seed( 0 ),
+	  m_Timestep( 0 ),
+	  m_Lower( 0 ),
+	  m_Upper( 0 ),
+	  m_SeedWindow( false ),
+	  m_NumberOfVoxels( 0 ),
+	  m_Progress( 0 ),
+	  m_Cancel( 0 )
+{}
+
+FloodFill::~FloodFill()
+{
+	cancel();
+}
+
+void FloodFill::cancel()
+{
+	m_Cancel = 1;
+	wait();
+	m_Cancel = 0;
+	m_Runs.clear();
+	m_NumberOfVoxels = 0;
+}
+
+bool FloodFill::fill ( const ImageHolder::Pointer image, const util::ivector4 &seed, const size_t &timestep, const double &lower, const double &upper )
+{
+	cancel();
+	m_Lower = lower;
+	m_Upper = upper;
+	m_SeedWindow = false;
+	return start( image, seed, timestep );
+}
+
+bool FloodFill::fill ( const ImageHolder::Pointer image, const util::ivector4 &seed, const size_t &timestep )
+{
+	cancel();
+	m_SeedWindow = true;
+	return start( image, seed, timestep );
+}
+
+bool FloodFill::start ( const ImageHolder::Pointer image, const util::ivector4 &seed, const size_t &timestep )
+{
+	const util::ivector4 size = image->getImageSize();
+
+	for( unsigned short i = 0; i < 3; i++ ) {
+		if( seed[i] < 0 || seed[i] >= size[i] ) {
+			LOG( Runtime, warning ) << "The seed " << seed << " of the fill is outside of the image.";
+			return false;
+		}
+	}
+
+	m_Image = image;
+	m_Size = size;
+	m_Seed = seed[0] + size[0] * ( seed[1] + static_cast<size_t>( size[1] ) * seed[2] );
+	m_Timestep = timestep;
+	m_Progress = 0;
+	QThread::start();
+	return true;
+}
+
+bool FloodFill::markWindow()
+{
+	switch( m_Image->getImageProperties().majorTypeID ) {
+	case data::ValueArray<bool>::staticID:
+		markWindow<bool>();
+		break;
+	case data::ValueArray<int8_t>::staticID:
+		markWindow<int8_t>();
+		break;
+	case data::ValueArray<uint8_t>::staticID:
+		markWindow<uint8_t>();
+		break;
+	case data::ValueArray<int16_t>::staticID:
+		markWindow<int16_t>();
+		break;
+	case data::ValueArray<uint16_t>::staticID:
+		markWindow<uint16_t>();
+		break;
+	case data::ValueArray<int32_t>::staticID:
+		markWindow<int32_t>();
+		break;
+	case data::ValueArray<uint32_t>::staticID:
+		markWindow<uint32_t>();
+		break;
+	case data::ValueArray<int64_t>::staticID:
+		markWindow<int64_t>();
+		break;
+	case data::ValueArray<uint64_t>::staticID:
+		markWindow<uint64_t>();
+		break;
+	case data::ValueArray<float>::staticID:
+		markWindow<float>();
+		break;
+	case data::ValueArray<double>::staticID:
+		markWindow<double>();
+		break;
+	default:
+		LOG( Runtime, error ) << "Filling is not supported for images of type " << m_Image->getImageProperties().majorTypeName;
+		return false;
+	}
+
+	return true;
+}
+
+void FloodFill::run()
+{
+	m_State.resize( m_Size[0] * m_Size[1] * m_Size[2] );
+
+	if( markWindow() ) {
+		m_Progress = 10;
+		grow();
+	}
+
+	m_Progress = 100;
+	//the state is as large as the volume, so it is not kept between fills
+	std::vector<uint8_t>().swap( m_State );
+	m_Image.reset();
+}
+
+void FloodFill::grow()
+{
+	const size_t rowLength = m_Size[0];
+	const size_t sliceLength = rowLength * m_Size[1];
+	size_t numberOfCandidates = 0;
+
+	for( std::vector<uint8_t>::const_iterator iter = m_State.begin(); iter != m_State.end(); ++iter ) {
+		numberOfCandidates += *iter;
+	}
+
+	std::vector<size_t> seeds( 1, m_Seed );
+
+	while( !seeds.empty() ) {
+		const size_t index = seeds.back();
+		seeds.pop_back();
+
+		if( m_State[index] != candidate ) {
+			continue;
+		}
+
+		//extend the seed to the whole span of candidates in its row
+		const size_t rowStart = index - index % rowLength;
+		size_t first = index;
+		size_t last = index + 1;
+
+		while( first > rowStart && m_State[first - 1] == candidate ) {
+			first--;
+		}
+
+		while( last < rowStart + rowLength && m_State[last] == candidate ) {
+			last++;
+		}
+
+		std::fill( m_State.begin() + first, m_State.begin() + last, static_cast<uint8_t>( filled ) );
+		m_Runs.push_back( std::make_pair( first, last ) );
+		m_NumberOfVoxels += last - first;
+
+		//one seed for every run of candidates in the four neighbouring rows
+		const size_t y = ( index / rowLength ) % m_Size[1];
+		const size_t z = index / sliceLength;
+		const bool hasNeighbour[4] = { y > 0, y + 1 < static_cast<size_t>( m_Size[1] ), z > 0, z + 1 < static_cast<size_t>( m_Size[2] ) };
+		const ptrdiff_t offsets[4] = { -static_cast<ptrdiff_t>( rowLength ), static_cast<ptrdiff_t>( rowLength ), -static_cast<ptrdiff_t>( sliceLength ), static_cast<ptrdiff_t>( sliceLength ) };
+
+		for( unsigned short n = 0; n < 4; n++ ) {
+			if( hasNeighbour[n] ) {
+				bool inRun = false;
+
+				for( size_t i = first + offsets[n]; i < last + offsets[n]; i++ ) {
+					const bool isCandidate = m_State[i] == candidate;
+
+					if( isCandidate && !inRun ) {
+						seeds.push_back( i );
+					}
+
+					inRun = isCandidate;
+				}
+			}
+		}
+
+		if( m_Cancel ) {
+			m_Runs.clear();
+			m_NumberOfVoxels = 0;
+			return;
+		}
+
+		m_Progress = 10 + static_cast<int>( 90. * m_NumberOfVoxels / numberOfCandidates );
+	}
+}
+
+}
+}
+}
@@ -0,0 +1,146 @@
+/****************************************************************
+ *
+ * <Copyright information>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *
+ * FloodFill.hpp
+ *
+ * Description:
+ *
+ *  Created on: Oct 19, 2026
+ ******************************************************************/
+#ifndef FLOODFILL_HPP
+#define FLOODFILL_HPP
+
+#include <QThread>
+#include <QAtomicInt>
+#include "imageholder.hpp"
+
+namespace isis
+{
+namespace viewer
+{
+namespace plugin
+{
+
+/**
+ * Finds all voxels of a volume that are connected to a seed voxel (6-neighbourhood)
+ * and whose value lies in an intensity window, in a background thread.
+ * The window is evaluated for the whole volume in parallel first, then the region is grown
+ * with a scanline algorithm that takes whole rows from a span stack, so the result is a list of runs
+ * which can be written to the mask at once.
+ */
+class FloodFill : public QThread
+{
+public:
+	typedef std::vector< std::pair<size_t, size_t> > RunList;
+
+	FloodFill( const unsigned short &numberOfThreads );
+	~FloodFill();
+
+	/**
+	 * Cancels the running fill and starts growing the region of the volume timestep of image from seed.
+	 * Returns false if the seed is outside of the image or the image type is not supported.
+	 */
+	bool fill( const ImageHolder::Pointer image, const util::ivector4 &seed, const size_t &timestep, const double &lower, const double &upper );
+	///grows the region over the voxels that have the value of the seed voxel, see fill()
+	bool fill( const ImageHolder::Pointer image, const util::ivector4 &seed, const size_t &timestep );
+	///stops the running fill, the result is empty afterwards
+	void cancel();
+
+	///returns the progress of the running fill in percent
+	int getProgress() const { return m_Progress; }
+	///returns the filled voxels as runs [first, last) in memory order of the volume, only valid when the thread has finished
+	const RunList &getRuns() const { return m_Runs; }
+	size_t getNumberOfVoxels() const { return m_NumberOfVoxels; }
+
+protected:
+	void run();
+
+private:
+	enum { outside = 0, candidate = 1, filled = 2 };
+
+	template<typename TYPE>
+	struct WindowOp {
+		const std::vector< TypedSegment<TYPE> > &segments;
+		uint8_t *state;
+		double lower;
+		double upper;
+		struct RunOp {
+			uint8_t *state;
+			double lower;
+			double upper;
+			void operator()( const TYPE *begin, const size_t &length ) {
+				for( size_t i = 0; i < length; i++ ) {
+					const double value = static_cast<double>( begin[i] );
+					state[i] = value >= lower && value <= upper ? candidate : outside;
+				}
+
+				state += length;
+			}
+		};
+		void operator()( const size_t &first, const size_t &last, const unsigned short & ) {
+			RunOp runOp = { state + first, lower, upper };
+			forEachRun( segments, first, last, runOp );
+		}
+	};
+
+	template<typename TYPE>
+	struct SeedOp {
+		double value;
+		void operator()( const TYPE *begin, const size_t & ) { value = static_cast<double>( *begin ); }
+	};
+
+	template<typename TYPE>
+	void markWindow() {
+		const std::vector< TypedSegment<TYPE> > segments = m_Image->getTypedSegments<TYPE>( m_Timestep );
+
+		if( m_SeedWindow ) {
+			SeedOp<TYPE> seedOp = { 0 };
+			forEachRun( segments, m_Seed, m_Seed + 1, seedOp );
+			m_Lower = m_Upper = seedOp.value;
+		}
+
+		WindowOp<TYPE> op = { segments, &m_State[0], m_Lower, m_Upper };
+		parallel::forEachRange( 0, m_State.size(), op, m_NumberOfThreads, 1 << 16 );
+	}
+
+	bool start( const ImageHolder::Pointer image, const util::ivector4 &seed, const size_t &timestep );
+	bool markWindow();
+	void grow();
+
+	const unsigned short m_NumberOfThreads;
+	ImageHolder::Pointer m_Image;
+	util::ivector4 m_Size;
+	size_t m_Seed;
+	size_t m_Timestep;
+	double m_Lower;
+	double m_Upper;
+	//the window is the value of the seed voxel
+	bool m_SeedWindow;
+	std::vector<uint8_t> m_State;
+	RunList m_Runs;
+	size_t m_NumberOfVoxels;
+	QAtomicInt m_Progress;
+	QAtomicInt m_Cancel;
+};
+
+}
+}
+}
+
+#endif // FLOODFILL_HPP
@@ -29,6 +29,9 @@
 #include <DataStorage/image.hpp>
 #include "uicore.hpp"
 #include "common.hpp"
+#include "memoryhandler.hpp"
+#include "parallel.hpp"
+#include <cmath>
 #include <CoreUtils/vector.hpp>
 
 
@@ -43,7 +46,11 @@ MaskEditDialog::MaskEditDialog( QWidget *parent, QViewerCore *core )
 	: QDialog( parent ),
 	  m_ViewerCore( core ),
 	  m_Radius( 2 ),
-	  m_CreateMaskDialog( new CreateMaskDialog( parent, this ) )
+	  m_CreateMaskDialog( new CreateMaskDialog( parent, this ) ),
+	  m_RangeChanged( false ),
+	  m_FloodFill( parallel::getNumberOfThreads( *core->getSettings() ) ),
+	  m_ReportedFillProgress( 0 ),
+	  m_FillTimestep( 0 )
 {
 	m_Interface.setupUi( this );
 	m_Interface.pickColor->setEnabled( false );
@@ -63,6 +70,24 @@ MaskEditDialog::MaskEditDialog( QWidget *parent, QViewerCore *core )
 	connect( m_Interface.paint, SIGNAL( clicked( bool ) ), this, SLOT( paintClicked() ) );
 	connect( m_Interface.cut, SIGNAL( clicked( bool ) ), this, SLOT( cutClicked() ) );
 
+	m_StrokeTimer.setSingleShot( true );
+	m_StrokeTimer.setInterval( 200 );
+	connect( &m_StrokeTimer, SIGNAL( timeout() ), this, SLOT( strokeFinished() ) );
+
+	m_Interface.lowerThreshold->setMinimum( -std::numeric_limits<double>::max() );
+	m_Interface.lowerThreshold->setMaximum( std::numeric_limits<double>::max() );
+	m_Interface.upperThreshold->setMinimum( -std::numeric_limits<double>::max() );
+	m_Interface.upperThreshold->setMaximum( std::numeric_limits<double>::max() );
+	m_FillProgressTimer.setInterval( 100 );
+	connect( m_Interface.useWindow, SIGNAL( toggled( bool ) ), this, SLOT( windowToggled( bool ) ) );
+	connect( &m_FillProgressTimer, SIGNAL( timeout() ), this, SLOT( updateFillProgress() ) );
+	connect( &m_FloodFill, SIGNAL( finished() ), this, SLOT( fillFinished() ) );
+
+	m_Interface.morphRadius->setMinimum( 0 );
+	m_Interface.morphRadius->setMaximum( 500 );
+	m_Interface.morphRadius->setValue( 2 );
+	connect( m_Interface.morphApply, SIGNAL( clicked() ), this, SLOT( morphologyClicked() ) );
+
 }
 
 void MaskEditDialog::cutClicked()
@@ -113,7 +138,7 @@ void MaskEditDialog::radiusChange( int r )
 void MaskEditDialog::showEvent( QShowEvent * )
 {
 	connect( m_ViewerCore, SIGNAL ( emitOnWidgetMoved( util::fvector3, Qt::MouseButton ) ), this, SLOT( physicalCoordChanged( util::fvector3, Qt::MouseButton ) ) );
-	connect( m_ViewerCore, SIGNAL ( emitOnWidgetClicked( util::fvector3, Qt::MouseButton ) ), this, SLOT( physicalCoordChanged( util::fvector3, Qt::MouseButton ) ) );
+	connect( m_ViewerCore, SIGNAL ( emitOnWidgetClicked( util::fvector3, Qt::MouseButton ) ), this, SLOT( widgetClicked( util::fvector3, Qt::MouseButton ) ) );
 
 	if( !m_CurrentMask ) {
 		m_Interface.radius->setEnabled( false );
@@ -128,48 +153,14 @@ void MaskEditDialog::physicalCoordChanged( util::fvector3 physCoord, Qt::MouseBu
 {
 	if( mouseButton == Qt::LeftButton && m_ViewerCore->hasImage() ) {
 		if( !m_Interface.pickColor->isChecked() ) {
-			if( m_CurrentMask ) {
-				switch( m_CurrentMask->getImageProperties().majorTypeID ) {
-				case isis::data::ValueArray<bool>::staticID:
-					manipulateVoxel<bool>( physCoord, m_CurrentMask );
-					break;
-				case isis::data::ValueArray<int8_t>::staticID:
-					manipulateVoxel<int8_t>( physCoord, m_CurrentMask );
-					break;
-				case isis::data::ValueArray<uint8_t>::staticID:
-					manipulateVoxel<uint8_t>( physCoord, m_CurrentMask );
-					break;
-				case isis::data::ValueArray<int16_t>::staticID:
-					manipulateVoxel<int16_t>( physCoord, m_CurrentMask );
-					break;
-				case isis::data::ValueArray<uint16_t>::staticID:
-					manipulateVoxel<uint16_t>( physCoord, m_CurrentMask );
-					break;
-				case isis::data::ValueArray<int32_t>::staticID:
-					manipulateVoxel<int32_t>( physCoord, m_CurrentMask );
-					break;
-				case isis::data::ValueArray<uint32_t>::staticID:
-					manipulateVoxel<uint32_t>( physCoord, m_CurrentMask );
-					break;
-				case isis::data::ValueArray<int64_t>::staticID:
-					manipulateVoxel<int64_t>( physCoord, m_CurrentMask );
-					break;
-				case isis::data::ValueArray<uint64_t>::staticID:
-					manipulateVoxel<uint64_t>( physCoord, m_CurrentMask );
-					break;
-				case isis::data::ValueArray<double>::staticID:
-					manipulateVoxel<double>( physCoord, m_CurrentMask );
-					break;
-				case isis::data::ValueArray<float>::staticID:
-					manipulateVoxel<float>( physCoord, m_CurrentMask );
-					break;
-				default:
-					LOG( Runtime, error ) << "Unknown type ID " << m_CurrentMask->getImageProperties().majorTypeID << " when trying to paint mask";
-					break;
-				}
+			//fills are only started by widgetClicked
+			if( m_CurrentMask && !m_Interface.fill->isChecked() ) {
+				util::ivector4 start, end;
 
-				m_ViewerCore->emitImageContentChanged( m_CurrentMask );
-				m_ViewerCore->updateScene();
+				if( manipulateVoxel( physCoord, m_CurrentMask, start, end ) ) {
+					invalidateWidgets( start, end );
+					m_StrokeTimer.start();
+				}
 			}
 		} else {
 			m_Interface.colorEdit->setValue(  m_CurrentMask->getImageProperties().voxelValue );
@@ -178,8 +169,303 @@ void MaskEditDialog::physicalCoordChanged( util::fvector3 physCoord, Qt::MouseBu
 
 }
 
+void MaskEditDialog::widgetClicked( util::fvector3 physCoord, Qt::MouseButton mouseButton )
+{
+	if( mouseButton == Qt::LeftButton && m_CurrentMask && m_Interface.fill->isChecked() && !m_Interface.pickColor->isChecked() ) {
+		startFill( physCoord );
+	} else {
+		physicalCoordChanged( physCoord, mouseButton );
+	}
+}
+
+bool MaskEditDialog::manipulateVoxel( const util::fvector3 physCoord, boost::shared_ptr<ImageHolder> image, util::ivector4 &start, util::ivector4 &end )
+{
+	util::ivector4 voxel = image->getISISImage()->getIndexFromPhysicalCoords( physCoord );
+	image->correctVoxelCoords<3>( voxel );
+	const util::ivector4 size = image->getImageSize();
+	const size_t timestep = image->getImageProperties().voxelCoords[dim_time];
+
+	//only voxels that are closer than m_Radius to the center along each axis are painted
+	const int reach = static_cast<int>( m_Radius ) - 1;
+	const int radSquare = static_cast<int>( m_Radius ) * m_Radius;
+
+	for( unsigned short i = 0; i < 3; i++ ) {
+		start[i] = std::max<int>( voxel[i] - reach, 0 );
+		end[i] = std::min<int>( voxel[i] + reach, size[i] - 1 );
+	}
+
+	FloodFill::RunList runs;
+
+	for( int z = start[2]; z <= end[2]; z++ ) {
+		const int dz = z - voxel[2];
+
+		for( int y = start[1]; y <= end[1]; y++ ) {
+			const int dy = y - voxel[1];
+			const int rest = radSquare - dz * dz - dy * dy;
+
+			if( rest >= 0 ) {
+				const int dx = std::min<int>( reach, static_cast<int>( std::sqrt( static_cast<double>( rest ) ) ) );
+				const size_t row = ( static_cast<size_t>( z ) * size[1] + y ) * size[0];
+				runs.push_back( std::make_pair( row + std::max<int>( voxel[0] - dx, 0 ), row + std::min<int>( voxel[0] + dx, size[0] - 1 ) + 1 ) );
+			}
+		}
+	}
+
+	//the whole stroke becomes one batch of the edit journal, it is committed by strokeFinished
+	return !runs.empty() && writeRuns( image, timestep, runs, m_Interface.colorEdit->value() );
+}
+
+bool MaskEditDialog::writeRuns( boost::shared_ptr<ImageHolder> image, const size_t &timestep, const FloodFill::RunList &runs, const double &newValue )
+{
+	switch( image->getImageProperties().majorTypeID ) {
+	case isis::data::ValueArray<bool>::staticID:
+		return writeRuns<bool>( image, timestep, runs, newValue );
+	case isis::data::ValueArray<int8_t>::staticID:
+		return writeRuns<int8_t>( image, timestep, runs, newValue );
+	case isis::data::ValueArray<uint8_t>::staticID:
+		return writeRuns<uint8_t>( image, timestep, runs, newValue );
+	case isis::data::ValueArray<int16_t>::staticID:
+		return writeRuns<int16_t>( image, timestep, runs, newValue );
+	case isis::data::ValueArray<uint16_t>::staticID:
+		return writeRuns<uint16_t>( image, timestep, runs, newValue );
+	case isis::data::ValueArray<int32_t>::staticID:
+		return writeRuns<int32_t>( image, timestep, runs, newValue );
+	case isis::data::ValueArray<uint32_t>::staticID:
+		return writeRuns<uint32_t>( image, timestep, runs, newValue );
+	case isis::data::ValueArray<int64_t>::staticID:
+		return writeRuns<int64_t>( image, timestep, runs, newValue );
+	case isis::data::ValueArray<uint64_t>::staticID:
+		return writeRuns<uint64_t>( image, timestep, runs, newValue );
+	case isis::data::ValueArray<double>::staticID:
+		return writeRuns<double>( image, timestep, runs, newValue );
+	case isis::data::ValueArray<float>::staticID:
+		return writeRuns<float>( image, timestep, runs, newValue );
+	default:
+		LOG( Runtime, error ) << "Unknown type ID " << image->getImageProperties().majorTypeID << " when trying to paint mask";
+		return false;
+	}
+}
+
+void MaskEditDialog::startFill( const util::fvector3 &physCoord )
+{
+	const util::ivector4 seed = m_CurrentMask->getISISImage()->getIndexFromPhysicalCoords( physCoord );
+	const size_t timestep = m_CurrentMask->getImageProperties().voxelCoords[dim_time];
+	bool started = false;
+
+	if( m_Interface.useWindow->isChecked() ) {
+		const ImageHolder::Pointer windowImage = getWindowImage();
+
+		if( !windowImage ) {
+			LOG( Runtime, error ) << "There is no image with the size of the mask to take the window from.";
+			return;
+		}
+
+		started = m_FloodFill.fill( windowImage, seed, windowImage->getImageProperties().voxelCoords[dim_time],
+									m_Interface.lowerThreshold->value(), m_Interface.upperThreshold->value() );
+	} else {
+		started = m_FloodFill.fill( m_CurrentMask, seed, timestep );
+	}
+
+	if( started ) {
+		m_FillMask = m_CurrentMask;
+		m_FillTimestep = timestep;
+		m_ReportedFillProgress = 0;
+		m_ViewerCore->getProgressFeedback()->show( 100, "Filling..." );
+		m_FillProgressTimer.start();
+	}
+}
+
+ImageHolder::Pointer MaskEditDialog::getWindowImage() const
+{
+	const ImageHolder::Vector &images = m_CurrentWidgetEnsemble ? m_CurrentWidgetEnsemble->getImageVector() : m_ViewerCore->getImageVector();
+	BOOST_FOREACH( ImageHolder::Vector::const_reference image, images ) {
+		if( image != m_CurrentMask && image->getImageSize() == m_CurrentMask->getImageSize() ) {
+			return image;
+		}
+	}
+	return ImageHolder::Pointer();
+}
+
+void MaskEditDialog::windowToggled( bool window )
+{
+	m_Interface.lowerThreshold->setEnabled( window );
+	m_Interface.upperThreshold->setEnabled( window );
+
+	if( window && m_CurrentMask && m_Interface.lowerThreshold->value() == m_Interface.upperThreshold->value() ) {
+		const ImageHolder::Pointer windowImage = getWindowImage();
+
+		if( windowImage ) {
+			m_Interface.lowerThreshold->setValue( windowImage->getImageProperties().minMax.first->as<double>() );
+			m_Interface.upperThreshold->setValue( windowImage->getImageProperties().minMax.second->as<double>() );
+		}
+	}
+}
+
+void MaskEditDialog::updateFillProgress()
+{
+	const int progress = m_FloodFill.getProgress();
+
+	if( progress > m_ReportedFillProgress ) {
+		m_ViewerCore->getProgressFeedback()->progress( "", progress - m_ReportedFillProgress );
+		m_ReportedFillProgress = progress;
+	}
+}
+
+void MaskEditDialog::fillFinished()
+{
+	//a cancelled fill finishes as well, but then the next one is already running
+	if( m_FloodFill.isRunning() ) {
+		return;
+	}
+
+	m_FillProgressTimer.stop();
+	m_ViewerCore->getProgressFeedback()->close();
+
+	if( m_FillMask && !m_FloodFill.getRuns().empty() ) {
+		finishStroke();
+
+		//the whole region is written at once and repainted once
+		if( writeRuns( m_FillMask, m_FillTimestep, m_FloodFill.getRuns(), m_Interface.colorEdit->value() ) ) {
+			LOG( Runtime, info ) << "Filled " << m_FloodFill.getNumberOfVoxels() << " voxels.";
+			util::Singletons::get<EditJournal, 10>().commit( "Fill" );
+			m_ViewerCore->emitImageContentChanged( m_FillMask );
+
+			if( m_RangeChanged ) {
+				m_ViewerCore->getUICore()->refreshUI();
+			}
+
+			m_RangeChanged = false;
+		}
+	}
+
+	m_FillMask.reset();
+}
+
+void MaskEditDialog::morphologyClicked()
+{
+	if( !m_CurrentMask ) {
+		return;
+	}
+
+	finishStroke();
+	const boost::shared_ptr<_internal::__Image> isisImage = m_CurrentMask->getISISImage();
+	const util::fvector3 voxelSize = isisImage->getPropertyAs<util::fvector3>( "voxelSize" ) +
+									 ( isisImage->hasProperty( "voxelGap" ) ? isisImage->getPropertyAs<util::fvector3>( "voxelGap" ) : util::fvector3() );
+	const size_t timestep = m_CurrentMask->getImageProperties().voxelCoords[dim_time];
+	std::vector<uint8_t> before;
+
+	if( !Morphology::getForeground( *m_CurrentMask, timestep, before ) ) {
+		return;
+	}
+
+	const Morphology::Operation operation = static_cast<Morphology::Operation>( m_Interface.morphOperation->currentIndex() );
+	const std::string operationName = m_Interface.morphOperation->currentText().toStdString();
+	m_ViewerCore->getUICore()->toggleLoadingIcon( true, QString( operationName.c_str() ) + "..." );
+	std::vector<uint8_t> after( before );
+	Morphology( m_CurrentMask->getImageSize(), voxelSize, parallel::getNumberOfThreads( *m_ViewerCore->getSettings() ) )
+	.apply( after, operation, m_Interface.morphRadius->value() );
+
+	//only the voxels that changed are written, added ones get the value of colorEdit and removed ones become background
+	const FloodFill::RunList added = getDifference( after, before );
+	const FloodFill::RunList removed = getDifference( before, after );
+	const bool changed = !added.empty() || !removed.empty();
+
+	if( !added.empty() ) {
+		writeRuns( m_CurrentMask, timestep, added, m_Interface.colorEdit->value() );
+	}
+
+	if( !removed.empty() ) {
+		writeRuns( m_CurrentMask, timestep, removed, 0 );
+	}
+
+	util::Singletons::get<EditJournal, 10>().commit( operationName );
+	m_ViewerCore->getUICore()->toggleLoadingIcon( false );
+
+	if( changed ) {
+		m_ViewerCore->emitImageContentChanged( m_CurrentMask );
+
+		if( m_RangeChanged ) {
+			m_ViewerCore->getUICore()->refreshUI();
+		}
+	}
+
+	m_RangeChanged = false;
+}
+
+FloodFill::RunList MaskEditDialog::getDifference( const std::vector<uint8_t> &foreground, const std::vector<uint8_t> &reference )
+{
+	FloodFill::RunList runs;
+	const size_t volume = foreground.size();
+	size_t i = 0;
+
+	while( i < volume ) {
+		if( foreground[i] && !reference[i] ) {
+			const size_t first = i;
+
+			while( i < volume && foreground[i] && !reference[i] ) {
+				i++;
+			}
+
+			runs.push_back( std::make_pair( first, i ) );
+		} else {
+			i++;
+		}
+	}
+
+	return runs;
+}
+
+void MaskEditDialog::invalidateWidgets( const util::ivector4 &start, const util::ivector4 &end )
+{
+	//slices extracted ahead of time are outdated now
+	util::Singletons::get<SliceCache, 10>().clear( m_CurrentMask );
+	const util::ivector4 &trueVoxelCoords = m_CurrentMask->getImageProperties().trueVoxelCoords;
+	BOOST_FOREACH( WidgetEnsemble::Vector::reference ensemble, m_ViewerCore->getUICore()->getEnsembleList() ) {
+		if( ensemble->hasImage( m_CurrentMask ) ) {
+			BOOST_FOREACH( WidgetEnsemble::reference ensembleComponent, *ensemble ) {
+				widget::WidgetInterface *widget = ensembleComponent->getWidgetInterface();
+
+				//widgets without a plane orientation are updated by strokeFinished
+				if( widget->getPlaneOrientation() != not_specified ) {
+					const util::ivector4 mapping = mapCoordsToOrientation( util::ivector4( 0, 1, 2, 3 ), m_CurrentMask->getImageProperties().latchedOrientation, widget->getPlaneOrientation(), false );
+					const int32_t slice = trueVoxelCoords[mapping[2]];
+
+					if( slice >= start[mapping[2]] && slice <= end[mapping[2]] ) {
+						widget->updateScene();
+					}
+				}
+			}
+		}
+	}
+}
+
+void MaskEditDialog::strokeFinished()
+{
+	util::Singletons::get<EditJournal, 10>().commit( "Paint" );
+
+	if( m_CurrentMask ) {
+		m_ViewerCore->emitImageContentChanged( m_CurrentMask );
+
+		if( m_RangeChanged ) {
+			m_ViewerCore->getUICore()->refreshUI();
+		}
+	}
+
+	m_RangeChanged = false;
+}
+
+void MaskEditDialog::finishStroke()
+{
+	if( m_StrokeTimer.isActive() ) {
+		m_StrokeTimer.stop();
+		strokeFinished();
+	}
+}
+
 void MaskEditDialog::editCurrentImage()
 {
+	finishStroke();
+
 	if( m_ViewerCore->hasImage() ) {
 		m_Interface.pickColor->setEnabled( true );
 		m_CurrentMask = m_ViewerCore->getCurrentImage();
@@ -216,8 +502,9 @@ void MaskEditDialog::createEmptyMask()
 
 void MaskEditDialog::closeEvent( QCloseEvent * )
 {
+	finishStroke();
 	disconnect( m_ViewerCore, SIGNAL ( emitOnWidgetMoved( util::fvector3, Qt::MouseButton ) ), this, SLOT( physicalCoordChanged( util::fvector3, Qt::MouseButton ) ) );
-	disconnect( m_ViewerCore, SIGNAL ( emitOnWidgetClicked( util::fvector3, Qt::MouseButton ) ), this, SLOT( physicalCoordChanged( util::fvector3, Qt::MouseButton ) ) );
+	disconnect( m_ViewerCore, SIGNAL ( emitOnWidgetClicked( util::fvector3, Qt::MouseButton ) ), this, SLOT( widgetClicked( util::fvector3, Qt::MouseButton ) ) );
 	BOOST_FOREACH( WidgetEnsemble::Vector::reference ensemble, m_ViewerCore->getUICore()->getEnsembleList() ) {
 		BOOST_FOREACH( WidgetEnsemble::reference ensembleComponent, *ensemble ) {
 			ensembleComponent->getWidgetInterface()->setMouseCursorIcon( QIcon() );
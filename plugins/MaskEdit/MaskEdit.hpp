@@ -31,6 +31,9 @@
 #include "ui_maskEdit.h"
 #include "qviewercore.hpp"
 #include "widgetensemble.hpp"
+#include "editjournal.hpp"
+#include "FloodFill.hpp"
+#include "Morphology.hpp"
 #include <DataStorage/chunk.hpp>
 
 namespace isis
@@ -52,6 +55,7 @@ public:
 
 public Q_SLOTS:
 	void physicalCoordChanged( util::fvector3 physCoord, Qt::MouseButton );
+	void widgetClicked( util::fvector3 physCoord, Qt::MouseButton );
 	void radiusChange( int );
 	void paintToggled();
 	void pickColorClicked();
@@ -61,6 +65,11 @@ public Q_SLOTS:
 	virtual void showEvent( QShowEvent * );
 	void paintClicked();
 	void cutClicked();
+	void strokeFinished();
+	void windowToggled( bool );
+	void updateFillProgress();
+	void fillFinished();
+	void morphologyClicked();
 
 private:
 
@@ -73,42 +82,74 @@ private:
 
 	WidgetEnsemble::Pointer m_CurrentWidgetEnsemble;
 
+	//emitImageContentChanged is only emitted once the painting rests for a moment
+	QTimer m_StrokeTimer;
+	bool m_RangeChanged;
+
+	FloodFill m_FloodFill;
+	QTimer m_FillProgressTimer;
+	int m_ReportedFillProgress;
+	boost::shared_ptr<ImageHolder> m_FillMask;
+	size_t m_FillTimestep;
+
+	/**
+	 * Paints a sphere of m_Radius voxels around physCoord into the current volume of image.
+	 * The sphere is clipped to the image and rasterized into runs along its rows, so every run is written at once.
+	 * The bounding box of the painted voxels is returned in start and end (both inclusive).
+	 */
+	bool manipulateVoxel( const util::fvector3 physCoord, boost::shared_ptr<ImageHolder> image, util::ivector4 &start, util::ivector4 &end );
+
+	///starts filling the region of m_CurrentMask that is connected to physCoord in the background
+	void startFill( const util::fvector3 &physCoord );
+	///returns the first other image of the current ensemble with the size of m_CurrentMask
+	boost::shared_ptr<ImageHolder> getWindowImage() const;
+
+	///records the runs [first, last) of the volume timestep of image in the edit journal and sets them to value
+	bool writeRuns( boost::shared_ptr<ImageHolder> image, const size_t &timestep, const FloodFill::RunList &runs, const double &newValue );
+
 	template<typename TYPE>
-	void manipulateVoxel( const util::fvector3 physCoord, boost::shared_ptr<ImageHolder> image ) {
-		util::ivector4 voxel = image->getISISImage()->getIndexFromPhysicalCoords( physCoord );
-		image->correctVoxelCoords<3>( voxel );
-		util::ivector4 start;
-		util::ivector4 end;
-		const size_t timestep = image->getImageProperties().voxelCoords[dim_time];
-
-		for( unsigned short i = 0; i < 3; i++ ) {
-			start[i] =  voxel[i] - m_Radius;
-			end[i] =  voxel[i] + m_Radius;
+	bool writeRuns( boost::shared_ptr<ImageHolder> image, const size_t &timestep, const FloodFill::RunList &runs, const double &newValue ) {
+		//voxels of chunks with another type would only be written to a converted copy
+		if( !image->hasChunksOfType<TYPE>() ) {
+			LOG( Runtime, error ) << "Can not paint into " << image->getImageProperties().fileName << ", its chunks have different types.";
+			return false;
 		}
 
-		unsigned short radSquare = m_Radius * m_Radius;
+		//e.g. the image is registered in the background
+		if( image->areVoxelsLocked() ) {
+			LOG( Runtime, error ) << "Can not paint into " << image->getImageProperties().fileName << ", its voxels are read by another operation.";
+			return false;
+		}
+
+		const TYPE value = util::Value<double>( newValue ).as<TYPE>();
+		util::Singletons::get<EditJournal, 10>().record( image, timestep, runs );
 
-		util::Value<double> colorValue( m_Interface.colorEdit->value() );
+		if( !image->fillTypedVoxels<TYPE>( timestep, runs, value ) ) {
+			return false;
+		}
 
-		for( short k = start[2] + 1; k < end[2]; k++ ) {
-			for( short j = start[1] + 1; j < end[1]; j++ ) {
-				for( short i = start[0] + 1; i < end[0]; i++ ) {
-					int x = voxel[0] - i;
-					int y = voxel[1] - j;
-					int z = voxel[2] - k;
+		const TYPE min = image->getImageProperties().minMax.first->as<TYPE>();
+		const TYPE max = image->getImageProperties().minMax.second->as<TYPE>();
 
-					if( x *x + y *y + z *z <= radSquare ) {
-						util::ivector4 finalVoxel( i, j, k );
-						image->correctVoxelCoords<3>( finalVoxel );
-						image->setTypedVoxel<TYPE>( finalVoxel[0], finalVoxel[1], finalVoxel[2], timestep, colorValue.as<TYPE>() );
-					}
-				}
-			}
+		if( value < min || value > max ) {
+			image->refreshVolumes( std::vector<size_t>( 1, timestep ),
+								   std::pair<double, double>( std::min( value, min ), std::max( value, max ) ) );
+			image->updateColorMap();
+			m_RangeChanged = true;
+		} else {
+			image->contentChanged();
 		}
 
-		m_ViewerCore->getUICore()->refreshUI();
+		return true;
 	}
 
+	///returns the runs of the voxels whose value in foreground is 1 and in reference is not
+	static FloodFill::RunList getDifference( const std::vector<uint8_t> &foreground, const std::vector<uint8_t> &reference );
+
+	///repaints the widgets showing m_CurrentMask whose slice intersects the box [start, end]
+	void invalidateWidgets( const util::ivector4 &start, const util::ivector4 &end );
+	///emits the pending content change of m_CurrentMask right away
+	void finishStroke();
 
 };
 
@@ -0,0 +1,260 @@
+/****************************************************************
+ *
+ * <Copyright information>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *
+ * Morphology.cpp
+ *
+ * Description:
+ *
+ *  Created on: Oct 19, 2026
+ ******************************************************************/
+#include "Morphology.hpp"
+#include <limits>
+
+namespace isis
+{
+namespace viewer
+{
+namespace plugin
+{
+
+Morphology::Morphology ( const util::ivector4 &size, const util::fvector3 &voxelSize, const unsigned short &numberOfThreads )
+	: m_Size( size ),
+	  m_VoxelSize( voxelSize ),
+	  m_Volume( static_cast<size_t>( size[0] ) * size[1] * size[2] ),
+	  m_NumberOfThreads( numberOfThreads )
+{}
+
+void Morphology::apply ( std::vector<uint8_t> &foreground, const Operation &operation, const double &radius ) const
+{
+	switch( operation ) {
+	case dilate:
+		grow( foreground, radius );
+		break;
+	case erode:
+		//eroding the foreground is dilating the background
+		invert( foreground );
+		grow( foreground, radius );
+		invert( foreground );
+		break;
+	case open:
+		apply( foreground, erode, radius );
+		apply( foreground, dilate, radius );
+		break;
+	case close:
+		apply( foreground, dilate, radius );
+		apply( foreground, erode, radius );
+		break;
+	}
+}
+
+void Morphology::invert ( std::vector<uint8_t> &foreground )
+{
+	for( std::vector<uint8_t>::iterator iter = foreground.begin(); iter != foreground.end(); ++iter ) {
+		*iter ^= 1;
+	}
+}
+
+void Morphology::grow ( std::vector<uint8_t> &foreground, const double &radius ) const
+{
+	std::vector<float> distance( m_Volume );
+	distanceTransform( foreground, distance );
+	//voxels lying exactly on the sphere belong to it
+	const float limit = radius * radius * ( 1 + 1e-4 );
+
+	for( size_t i = 0; i < m_Volume; i++ ) {
+		foreground[i] = distance[i] <= limit;
+	}
+}
+
+void Morphology::distanceTransform ( const std::vector<uint8_t> &foreground, std::vector<float> &distance ) const
+{
+	const float infinity = std::numeric_limits<float>::infinity();
+
+	for( size_t i = 0; i < m_Volume; i++ ) {
+		distance[i] = foreground[i] ? 0 : infinity;
+	}
+
+	std::vector<Workspace> workspaces( m_NumberOfThreads );
+	const size_t numberOfLines[3] = { static_cast<size_t>( m_Size[1] ) * m_Size[2], static_cast<size_t>( m_Size[0] ) * m_Size[2], static_cast<size_t>( m_Size[0] ) * m_Size[1] };
+
+	for( unsigned short axis = 0; axis < 3; axis++ ) {
+		if( m_Size[axis] > 1 ) {
+			LineOp op = { this, &distance[0], axis, &workspaces };
+			parallel::forEachRange( 0, numberOfLines[axis], op, m_NumberOfThreads, 64 );
+		}
+	}
+}
+
+void Morphology::LineOp::operator() ( const size_t &first, const size_t &last, const unsigned short &threadIndex )
+{
+	const util::ivector4 &size = morphology->m_Size;
+	const size_t length = size[axis];
+	const size_t rowLength = size[0];
+	const size_t sliceLength = rowLength * size[1];
+	const size_t strides[3] = { 1, rowLength, sliceLength };
+	Workspace &workspace = ( *workspaces )[threadIndex];
+
+	for( size_t line = first; line < last; line++ ) {
+		size_t start;
+
+		switch( axis ) {
+		case 0:
+			start = line * rowLength;
+			break;
+		case 1:
+			start = line % rowLength + line / rowLength * sliceLength;
+			break;
+		default:
+			start = line;
+			break;
+		}
+
+		transformLine( distance + start, length, strides[axis], morphology->m_VoxelSize[axis], workspace );
+	}
+}
+
+void Morphology::transformLine ( float *line, const size_t &length, const size_t &stride, const double &spacing, Workspace &workspace )
+{
+	const float infinity = std::numeric_limits<float>::infinity();
+	workspace.values.resize( length );
+	workspace.boundaries.resize( length + 1 );
+	workspace.parabolas.resize( length );
+	float *values = &workspace.values[0];
+	double *boundaries = &workspace.boundaries[0];
+	size_t *parabolas = &workspace.parabolas[0];
+	bool hasValue = false;
+
+	for( size_t i = 0; i < length; i++ ) {
+		values[i] = line[i * stride];
+		hasValue = hasValue || values[i] != infinity;
+	}
+
+	//nothing to propagate
+	if( !hasValue ) {
+		return;
+	}
+
+	//lower envelope of the parabolas rooted at the voxels with a finite value, infinite ones never contribute
+	long k = -1;
+
+	for( size_t q = 0; q < length; q++ ) {
+		if( values[q] == infinity ) {
+			continue;
+		}
+
+		const double position = q * spacing;
+		const double height = values[q] + position * position;
+
+		if( k < 0 ) {
+			k = 0;
+			parabolas[0] = q;
+			boundaries[0] = -std::numeric_limits<double>::max();
+			boundaries[1] = std::numeric_limits<double>::max();
+			continue;
+		}
+
+		double intersection;
+
+		while( true ) {
+			const double otherPosition = parabolas[k] * spacing;
+			intersection = ( height - ( values[parabolas[k]] + otherPosition * otherPosition ) ) / ( 2 * ( position - otherPosition ) );
+
+			if( intersection > boundaries[k] || k == 0 ) {
+				break;
+			}
+
+			k--;
+		}
+
+		if( intersection <= boundaries[k] ) {
+			//the new parabola is lower everywhere
+			parabolas[k] = q;
+		} else {
+			k++;
+			parabolas[k] = q;
+			boundaries[k] = intersection;
+		}
+
+		boundaries[k + 1] = std::numeric_limits<double>::max();
+	}
+
+	k = 0;
+
+	for( size_t q = 0; q < length; q++ ) {
+		const double position = q * spacing;
+
+		while( boundaries[k + 1] < position ) {
+			k++;
+		}
+
+		const double offset = position - parabolas[k] * spacing;
+		line[q * stride] = offset * offset + values[parabolas[k]];
+	}
+}
+
+bool Morphology::getForeground ( const ImageHolder &image, const size_t &timestep, std::vector<uint8_t> &foreground )
+{
+	const util::ivector4 size = image.getImageSize();
+	foreground.resize( static_cast<size_t>( size[0] ) * size[1] * size[2] );
+
+	switch( image.getImageProperties().majorTypeID ) {
+	case data::ValueArray<bool>::staticID:
+		getTypedForeground<bool>( image, timestep, foreground );
+		break;
+	case data::ValueArray<int8_t>::staticID:
+		getTypedForeground<int8_t>( image, timestep, foreground );
+		break;
+	case data::ValueArray<uint8_t>::staticID:
+		getTypedForeground<uint8_t>( image, timestep, foreground );
+		break;
+	case data::ValueArray<int16_t>::staticID:
+		getTypedForeground<int16_t>( image, timestep, foreground );
+		break;
+	case data::ValueArray<uint16_t>::staticID:
+		getTypedForeground<uint16_t>( image, timestep, foreground );
+		break;
+	case data::ValueArray<int32_t>::staticID:
+		getTypedForeground<int32_t>( image, timestep, foreground );
+		break;
+	case data::ValueArray<uint32_t>::staticID:
+		getTypedForeground<uint32_t>( image, timestep, foreground );
+		break;
+	case data::ValueArray<int64_t>::staticID:
+		getTypedForeground<int64_t>( image, timestep, foreground );
+		break;
+	case data::ValueArray<uint64_t>::staticID:
+		getTypedForeground<uint64_t>( image, timestep, foreground );
+		break;
+	case data::ValueArray<float>::staticID:
+		getTypedForeground<float>( image, timestep, foreground );
+		break;
+	case data::ValueArray<double>::staticID:
+		getTypedForeground<double>( image, timestep, foreground );
+		break;
+	default:
+		LOG( Runtime, error ) << "Morphological operations are not supported for images of type " << image.getImageProperties().majorTypeName;
+		return false;
+	}
+
+	return true;
+}
+
+}
+}
+}
@@ -0,0 +1,112 @@
+/****************************************************************
+ *
+ * <Copyright information>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *
+ * Morphology.hpp
+ *
+ * Description:
+ *
+ *  Created on: Oct 19, 2026
+ ******************************************************************/
+#ifndef MORPHOLOGY_HPP
+#define MORPHOLOGY_HPP
+
+#include "imageholder.hpp"
+
+namespace isis
+{
+namespace viewer
+{
+namespace plugin
+{
+
+/**
+ * Dilation, erosion, opening and closing of binary volumes with a ball of a physical radius.
+ * Both basic operations threshold the exact euclidean distance transform, which is computed in three separable passes
+ * (one per axis, weighted by the voxel size), so anisotropic voxels are handled correctly and the cost does not depend on the radius.
+ * The lines of every pass are distributed over the threads.
+ */
+class Morphology
+{
+public:
+	enum Operation { dilate, erode, open, close };
+
+	Morphology( const util::ivector4 &size, const util::fvector3 &voxelSize, const unsigned short &numberOfThreads );
+
+	///applies operation with a ball of radius (in mm) to foreground, a volume of 0 (background) and 1 (foreground)
+	void apply( std::vector<uint8_t> &foreground, const Operation &operation, const double &radius ) const;
+
+	/**
+	 * Fills foreground with 1 for every voxel of the volume timestep of image with a value above zero and 0 for all others.
+	 * Returns false if the type of the image is not supported.
+	 */
+	static bool getForeground( const ImageHolder &image, const size_t &timestep, std::vector<uint8_t> &foreground );
+
+private:
+	///adds every voxel to foreground whose distance to the foreground is at most radius
+	void grow( std::vector<uint8_t> &foreground, const double &radius ) const;
+	///computes the squared distance (in mm^2) of every voxel to the closest voxel of foreground
+	void distanceTransform( const std::vector<uint8_t> &foreground, std::vector<float> &distance ) const;
+	static void invert( std::vector<uint8_t> &foreground );
+
+	struct Workspace {
+		std::vector<float> values;
+		std::vector<double> boundaries;
+		std::vector<size_t> parabolas;
+	};
+
+	///squared distance transform of one line with the given spacing of its voxels (lower envelope of parabolas)
+	static void transformLine( float *line, const size_t &length, const size_t &stride, const double &spacing, Workspace &workspace );
+
+	struct LineOp {
+		const Morphology *morphology;
+		float *distance;
+		unsigned short axis;
+		std::vector<Workspace> *workspaces;
+		void operator()( const size_t &first, const size_t &last, const unsigned short &threadIndex );
+	};
+
+	template<typename TYPE>
+	struct ForegroundOp {
+		uint8_t *foreground;
+		void operator()( const TYPE *begin, const size_t &length ) {
+			for( size_t i = 0; i < length; i++ ) {
+				foreground[i] = begin[i] > TYPE( 0 );
+			}
+
+			foreground += length;
+		}
+	};
+
+	template<typename TYPE>
+	static void getTypedForeground( const ImageHolder &image, const size_t &timestep, std::vector<uint8_t> &foreground ) {
+		ForegroundOp<TYPE> op = { &foreground[0] };
+		forEachRun( image.getTypedSegments<TYPE>( timestep ), 0, foreground.size(), op );
+	}
+
+	util::ivector4 m_Size;
+	util::fvector3 m_VoxelSize;
+	size_t m_Volume;
+	unsigned short m_NumberOfThreads;
+};
+
+}
+}
+}
+
+#endif // MORPHOLOGY_HPP
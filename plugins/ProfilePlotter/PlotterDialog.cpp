@@ -29,6 +29,7 @@
 #include "PlotterDialog.hpp"
 
 #include <fftw3.h>
+#include <set>
 
 isis::viewer::plugin::PlotterDialog::PlotterDialog ( QWidget *parent, isis::viewer::QViewerCore *core )
 	: QDialog( parent ), m_ViewerCore( core )
@@ -61,9 +62,10 @@ isis::viewer::plugin::PlotterDialog::PlotterDialog ( QWidget *parent, isis::view
 	setMinimumHeight( 200 );
 	setMaximumHeight( 500 );
 
-	//TODO
-	ui.spectrumRadio->setEnabled( false );
-	ui.spectrumRadio->setToolTip( tr( "Not yet supported." ) );
+	//the wisdom is kept next to the settings of the viewer
+	const QString wisdomFile = QFileInfo( m_ViewerCore->getSettings()->getQSettings()->fileName() ).absolutePath() + "/fftw_wisdom";
+	m_SpectrumCalculator.reset( new SpectrumCalculator( wisdomFile.toStdString() ) );
+	connect( ui.bandPowerButton, SIGNAL( clicked() ), this, SLOT( createBandPowerMap() ) );
 
 }
 
@@ -94,27 +96,32 @@ void isis::viewer::plugin::PlotterDialog::refresh ( isis::util::fvector3 physica
 {
 	if( !ui.checkLock->isChecked() && isVisible() ) {
 		m_CurrentPhysicalCoords = physicalCoords;
-		plot->clear();
+		std::set<const ImageHolder *> images;
 		BOOST_FOREACH( ImageHolder::Vector::const_reference image, m_ViewerCore->getImageVector() ) {
+			images.insert( image.get() );
 			const unsigned short axis = image->getISISImage()->mapScannerAxisToImageDimension( static_cast<isis::data::scannerAxis>( ui.comboAxis->currentIndex() ) );
+			ProfileCache &cache = getProfileCache( image, axis );
+			QwtPlotCurve *curve = cache.curve;
+			curve->detach();
 
 			if( image->getImageSize()[axis] > 1 ) {
-				QwtPlotCurve *curve = new QwtPlotCurve();
-				curve->detach();
-
 				util::ivector4 voxCoords = image->getISISImage()->getIndexFromPhysicalCoords( physicalCoords );
 				image->correctVoxelCoords<3>( voxCoords );
 
 				if( ui.timeCourseRadio->isChecked() ) {
-					fillProfile( image, voxCoords, curve, axis );
+					fillProfile( image, voxCoords, cache );
 				} else {
-					fillSpectrum( image, voxCoords, curve, axis );
+					fillSpectrum( image, voxCoords, cache );
 				}
 
 				if( image.get() == m_ViewerCore->getCurrentImage().get() || m_ViewerCore->getMode() == ViewerCoreBase::statistical_mode ) {
 					curve->attach( plot );
-					plotMarker->setSpacing(11);
-					plotMarker->attach( plot );
+
+					if( ui.timeCourseRadio->isChecked() ) {
+						plotMarker->setSpacing(11);
+						plotMarker->attach( plot );
+					}
+
 					curve->setPen( QPen( Qt::red ) );
 				} else {
 					if( image->getImageProperties().isVisible ) {
@@ -131,19 +138,118 @@ void isis::viewer::plugin::PlotterDialog::refresh ( isis::util::fvector3 physica
 				plot->setTitle( QString( "Image has only one timestep!" ) );
 			}
 		}
+
+		//forget the images that were closed
+		for( std::map<const ImageHolder *, ProfileCache>::iterator iter = m_ProfileCaches.begin(); iter != m_ProfileCaches.end(); ) {
+			if( images.find( iter->first ) == images.end() ) {
+				delete iter->second.curve;
+				m_ProfileCaches.erase( iter++ );
+			} else {
+				++iter;
+			}
+		}
+
 		plot->replot();
 		plotMarker->detach();
 	}
 }
 
+isis::viewer::plugin::PlotterDialog::ProfileCache &isis::viewer::plugin::PlotterDialog::getProfileCache ( const boost::shared_ptr< isis::viewer::ImageHolder > image, const unsigned short &axis )
+{
+	std::map<const ImageHolder *, ProfileCache>::iterator iter = m_ProfileCaches.find( image.get() );
+
+	if( iter == m_ProfileCaches.end() ) {
+		ProfileCache cache;
+		cache.curve = new QwtPlotCurve();
+		cache.revision = 0;
+		cache.axis = 0;
+		cache.scannerAxis = -1;
+		iter = m_ProfileCaches.insert( std::make_pair( image.get(), cache ) ).first;
+	}
 
+	ProfileCache &cache = iter->second;
+	const int scannerAxis = ui.comboAxis->currentIndex();
+
+	if( cache.revision != image->getContentRevision() || cache.scannerAxis != scannerAxis || cache.axis != axis ) {
+		cache.revision = image->getContentRevision();
+		cache.axis = axis;
+		cache.scannerAxis = scannerAxis;
+		using namespace isis::data;
+
+		switch( image->getImageProperties().majorTypeID ) {
+		case ValueArray<bool>::staticID:
+			cache.readProfile = TypedProfileReader<bool>( image );
+			break;
+		case ValueArray<int8_t>::staticID:
+			cache.readProfile = TypedProfileReader<int8_t>( image );
+			break;
+		case ValueArray<uint8_t>::staticID:
+			cache.readProfile = TypedProfileReader<uint8_t>( image );
+			break;
+		case ValueArray<int16_t>::staticID:
+			cache.readProfile = TypedProfileReader<int16_t>( image );
+			break;
+		case ValueArray<uint16_t>::staticID:
+			cache.readProfile = TypedProfileReader<uint16_t>( image );
+			break;
+		case ValueArray<int32_t>::staticID:
+			cache.readProfile = TypedProfileReader<int32_t>( image );
+			break;
+		case ValueArray<uint32_t>::staticID:
+			cache.readProfile = TypedProfileReader<uint32_t>( image );
+			break;
+		case ValueArray<int64_t>::staticID:
+			cache.readProfile = TypedProfileReader<int64_t>( image );
+			break;
+		case ValueArray<uint64_t>::staticID:
+			cache.readProfile = TypedProfileReader<uint64_t>( image );
+			break;
+		case ValueArray<float>::staticID:
+			cache.readProfile = TypedProfileReader<float>( image );
+			break;
+		case ValueArray<double>::staticID:
+			cache.readProfile = TypedProfileReader<double>( image );
+			break;
+		default:
+			cache.readProfile.clear();
+			break;
+		}
+
+		//the physical coordinate along the axis grows linear with the index, so the offsets are the same for every voxel
+		cache.xOffsets.resize( image->getImageSize()[axis] );
 
+		if( axis == 3 ) {
+			float factor = 1;
 
-void isis::viewer::plugin::PlotterDialog::fillProfile ( boost::shared_ptr< isis::viewer::ImageHolder > image, const isis::util::ivector4 &voxCoords, QwtPlotCurve *curve, const unsigned short &axis )
+			if ( image->getISISImage()->hasProperty( "repetitionTime" ) ) {
+				factor = ( float )image->getISISImage()->getPropertyAs<uint16_t>( "repetitionTime" ) / 1000;
+			}
+
+			for( int32_t i = 0; i < cache.xOffsets.size(); i++ ) {
+				cache.xOffsets[i] = factor * i;
+			}
+		} else {
+			util::ivector4 coords( 0, 0, 0, 0 );
+			const double origin = image->getISISImage()->getPhysicalCoordsFromIndex( coords )[scannerAxis];
+
+			for( int32_t i = 0; i < cache.xOffsets.size(); i++ ) {
+				coords[axis] = i;
+				cache.xOffsets[i] = image->getISISImage()->getPhysicalCoordsFromIndex( coords )[scannerAxis] - origin;
+			}
+		}
+	}
+
+	return cache;
+}
+
+
+void isis::viewer::plugin::PlotterDialog::fillProfile ( boost::shared_ptr< isis::viewer::ImageHolder > image, const isis::util::ivector4 &voxCoords, ProfileCache &cache )
 {
 	std::stringstream title;
 	std::stringstream coordsAsString;
+	const unsigned short axis = cache.axis;
 	float factor = 1;
+	plot->setAxisTitle( 0, tr( "Intensity" ) );
 
 	if( axis == 3 ) {
 		title << "Timecourse for " << m_ViewerCore->getCurrentImage()->getImageProperties().fileName;
@@ -169,115 +275,113 @@ void isis::viewer::plugin::PlotterDialog::fillProfile ( boost::shared_ptr< isis:
 		setWindowTitle( title.str().c_str() );
 	}
 
-	plotMarker->setXValue( image->getISISImage()->getPhysicalCoordsFromIndex( voxCoords )[ui.comboAxis->currentIndex()] * factor );
+	//the x values are the cached offsets shifted to the first voxel along the axis through voxCoords
+	double first = 0;
 
-	QVector<double> xValues;
-	QVector<double> intensityValues;
-	using namespace isis::data;
-	util::ivector4 _coords = voxCoords;
+	if( axis != 3 ) {
+		util::ivector4 firstCoords = voxCoords;
+		firstCoords[axis] = 0;
+		first = image->getISISImage()->getPhysicalCoordsFromIndex( firstCoords )[ui.comboAxis->currentIndex()];
+		plotMarker->setXValue( image->getISISImage()->getPhysicalCoordsFromIndex( voxCoords )[ui.comboAxis->currentIndex()] );
+	} else {
+		plotMarker->setXValue( image->getImageProperties().timestep * factor );
+	}
 
-	for ( size_t i = 0; i < image->getImageSize()[axis]; i++ ) {
-		_coords[axis] = i;
+	cache.xValues.resize( cache.xOffsets.size() );
 
-		if( axis != 3 ) {
-			xValues.push_back( image->getISISImage()->getPhysicalCoordsFromIndex( _coords )[ui.comboAxis->currentIndex()] );
-		} else {
-			xValues.push_back( factor * i );
-		}
+	for( int32_t i = 0; i < cache.xOffsets.size(); i++ ) {
+		cache.xValues[i] = first + cache.xOffsets[i];
 	}
 
-	switch( image->getImageProperties().majorTypeID ) {
-	case ValueArray<bool>::staticID:
-		fillVector<bool>( intensityValues, _coords, image, axis );
-		break;
-	case ValueArray<int8_t>::staticID:
-		fillVector<int8_t>( intensityValues, _coords, image, axis );
-		break;
-	case ValueArray<uint8_t>::staticID:
-		fillVector<uint8_t>( intensityValues, _coords, image, axis );
-		break;
-	case ValueArray<int16_t>::staticID:
-		fillVector<int16_t>( intensityValues, _coords, image, axis );
-		break;
-	case ValueArray<uint16_t>::staticID:
-		fillVector<uint16_t>( intensityValues, _coords, image, axis );
-		break;
-	case ValueArray<int32_t>::staticID:
-		fillVector<int32_t>( intensityValues, _coords, image, axis );
-		break;
-	case ValueArray<uint32_t>::staticID:
-		fillVector<uint32_t>( intensityValues, _coords, image, axis );
-		break;
-	case ValueArray<int64_t>::staticID:
-		fillVector<int64_t>( intensityValues, _coords, image, axis );
-		break;
-	case ValueArray<uint64_t>::staticID:
-		fillVector<uint64_t>( intensityValues, _coords, image, axis );
-		break;
-	case ValueArray<float>::staticID:
-		fillVector<float>( intensityValues, _coords, image, axis );
-		break;
-	case ValueArray<double>::staticID:
-		fillVector<double>( intensityValues, _coords, image, axis );
-		break;
+	if( cache.readProfile ) {
+		cache.readProfile( voxCoords, axis, cache.yValues );
+	} else {
+		cache.yValues.fill( 0, cache.xValues.size() );
 	}
 
-	curve->setData( xValues, intensityValues );
-	
-
+	cache.curve->setData( cache.xValues, cache.yValues );
 }
 
-void isis::viewer::plugin::PlotterDialog::fillSpectrum ( boost::shared_ptr< isis::viewer::ImageHolder > image, const isis::util::ivector4 &voxCoords, QwtPlotCurve *curve, const unsigned short &axis )
+void isis::viewer::plugin::PlotterDialog::fillSpectrum ( boost::shared_ptr< isis::viewer::ImageHolder > image, const isis::util::ivector4 &voxCoords, ProfileCache &cache )
 {
-	plot->setAxisTitle( 2, tr( "1 / Hz" ) );
-	plot->setAxisTitle( 0, tr( "" ) );
-
-	double powermin = 10000000, powermax = -10000000;
-	fftw_plan plan;
-
-	size_t n = image->getImageSize()[3];
-
-	const size_t nc = ( n / 2 ) + 1;
-	double *in = ( double * ) fftw_malloc( sizeof( double ) * n );
-	fftw_complex *out = ( fftw_complex * ) fftw_malloc ( sizeof ( fftw_complex ) * nc );
-
-	plan = fftw_plan_dft_r2c_1d( n, in, out, FFTW_ESTIMATE );
-	util::ivector4 _coords = voxCoords;
-
-	for( size_t i = 0; i < n; i++ ) {
-		_coords[axis] = i;
-		in[i] = image->getISISImage()->voxel<int16_t>( _coords[0], _coords[1], _coords[2], image->getImageProperties().timestep );
+	std::stringstream title;
+	title << "Spectrum for " << m_ViewerCore->getCurrentImage()->getImageProperties().fileName;
+	setWindowTitle( title.str().c_str() );
+	plot->setTitle( ( std::string( "Spectrum for axis " ) + ui.comboAxis->currentText().toStdString() ).c_str() );
+	plot->setAxisTitle( 2, cache.axis == 3 ? tr( "f / Hz" ) : tr( "f / (1/mm)" ) );
+	plot->setAxisTitle( 0, tr( "Amplitude" ) );
+
+	if( !cache.readProfile ) {
+		return;
 	}
 
-	fftw_execute( plan );
-	QVector<double> yVec( nc + 2 );
-	QVector<double> xVec( nc + 2 );
-
-	for ( int k = 1; k < static_cast<int>( nc ); k++ ) {
-		yVec[k] = ( double )sqrt( out[k][0] * out[k][0] + out[k][1] * out[k][1] );
-
-		if ( powermin > yVec[k] ) powermin = yVec[k];
-
-		if ( powermax < yVec[k] ) powermax = yVec[k];
-
-		xVec[k] = k;
+	cache.readProfile( voxCoords, cache.axis, cache.yValues );
+	m_SpectrumCalculator->getAmplitudes( cache.yValues, cache.yValues );
+	//the constant part is left out, it would dominate the scale
+	const int nc = cache.yValues.size();
+	const double spacing = std::fabs( cache.xOffsets[1] - cache.xOffsets[0] );
+	const double frequencyStep = 1. / ( cache.xOffsets.size() * ( spacing > 0 ? spacing : 1 ) );
+	cache.xValues.resize( nc - 1 );
+
+	for( int k = 1; k < nc; k++ ) {
+		cache.xValues[k - 1] = k * frequencyStep;
+		cache.yValues[k - 1] = cache.yValues[k];
 	}
 
-	yVec[0] = 0.0;
-	yVec[nc] = powermin;
-	xVec[nc] = nc;
-	yVec[nc+1] = powermax;
-	xVec[nc+1] = nc + 1;
-	curve->setData( xVec, yVec );
-
-
+	cache.yValues.resize( nc - 1 );
+	cache.curve->setData( cache.xValues, cache.yValues );
 }
 
+void isis::viewer::plugin::PlotterDialog::createBandPowerMap()
+{
+	if( !m_ViewerCore->hasImage() || m_ViewerCore->getCurrentImage()->getImageSize()[dim_time] < 2 ) {
+		QMessageBox msg( this );
+		msg.setText( "The band power map needs an image with more than one timestep!" );
+		msg.exec();
+		return;
+	}
 
+	const ImageHolder::Pointer image = m_ViewerCore->getCurrentImage();
+	const util::ivector4 size = image->getImageSize();
+	float repetitionTime = 1;
 
+	if ( image->getISISImage()->hasProperty( "repetitionTime" ) ) {
+		repetitionTime = ( float )image->getISISImage()->getPropertyAs<uint16_t>( "repetitionTime" ) / 1000;
+	} else {
+		LOG( Runtime, warning ) << "The image has no repetition time. Assuming 1 s.";
+	}
 
+	//bin k holds the frequency k / ( n * TR )
+	const double binsPerHz = size[dim_time] * repetitionTime;
+	const size_t firstBin = std::ceil( ui.lowerFrequency->value() * binsPerHz );
+	const size_t lastBin = std::floor( ui.upperFrequency->value() * binsPerHz );
 
+	if( lastBin < firstBin ) {
+		QMessageBox msg( this );
+		msg.setText( "The frequency band contains no frequency of the image!" );
+		msg.exec();
+		return;
+	}
 
+	QApplication::setOverrideCursor( Qt::WaitCursor );
+	data::MemChunk<double> ch( size[0], size[1], size[2] );
+	ch.join( static_cast<util::PropertyMap &>( *image->getISISImage() ) );
 
+	if( !ch.hasProperty( "acquisitionNumber" ) ) {
+		ch.setPropertyAs<uint16_t>( "acquisitionNumber", 0 );
+	}
 
-
+	m_SpectrumCalculator->getBandPower( image, firstBin, lastBin, &ch.voxel<double>( 0, 0, 0 ), parallel::getNumberOfThreads( *m_ViewerCore->getSettings() ) );
+	data::Image map( ch );
+	map.setPropertyAs<std::string>( "source", "band_power_map" );
+	const ImageHolder::Pointer mapImage = m_ViewerCore->addImage( map, ImageHolder::statistical_image );
+	BOOST_FOREACH( WidgetEnsemble::Vector::reference ensemble, m_ViewerCore->getUICore()->getEnsembleList() ) {
+		if( ensemble->hasImage( image ) ) {
+			ensemble->addImage( mapImage );
+		}
+	}
+	QApplication::restoreOverrideCursor();
+	m_ViewerCore->setCurrentImage( mapImage );
+	m_ViewerCore->getUICore()->refreshUI();
+	m_ViewerCore->updateScene();
+}
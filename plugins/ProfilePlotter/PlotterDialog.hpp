@@ -31,6 +31,7 @@
 #include <QtGui>
 #include <QWidget>
 #include "Plot.hpp"
+#include "SpectrumCalculator.hpp"
 #include <qwt_plot_curve.h>
 #include <qwt_plot_grid.h>
 #include <qwt_plot_marker.h>
@@ -40,6 +41,8 @@
 #include <iostream>
 #include "qviewercore.hpp"
 #include "DataStorage/valuearray.hpp"
+#include <boost/function.hpp>
+#include <map>
 
 namespace isis
 {
@@ -58,6 +61,7 @@ public Q_SLOTS:
 	void updateScene();
 
 	virtual void refresh( util::fvector3 physicalCoords );
+	void createBandPowerMap();
 
 private:
 	Ui::plottingDialog ui;
@@ -66,24 +70,76 @@ private:
 	QwtPlotMarker *plotMarker;
 	QViewerCore *m_ViewerCore;
 	util::fvector3 m_CurrentPhysicalCoords;
+	boost::scoped_ptr<SpectrumCalculator> m_SpectrumCalculator;
 
-	void fillProfile( boost::shared_ptr<ImageHolder> image, const util::ivector4 &voxCoords, QwtPlotCurve *curve, const unsigned short &axis );
-	void fillSpectrum(  boost::shared_ptr<ImageHolder> image, const util::ivector4 &voxCoords, QwtPlotCurve *curve, const unsigned short &axis );
+	///reads the values of all voxels along one image dimension through the given voxel
+	typedef boost::function<void ( const util::ivector4 &, const unsigned short &, QVector<double> & )> ProfileReader;
 
+	///everything the plot of one image needs that does not change with the voxel
+	struct ProfileCache {
+		size_t revision;
+		unsigned short axis;
+		int scannerAxis;
+		ProfileReader readProfile;
+		///x values relative to the first voxel along the axis
+		QVector<double> xOffsets;
+		QVector<double> xValues;
+		QVector<double> yValues;
+		QwtPlotCurve *curve;
+	};
+	std::map<const ImageHolder *, ProfileCache> m_ProfileCaches;
+
+	ProfileCache &getProfileCache( const boost::shared_ptr<ImageHolder> image, const unsigned short &axis );
+	void fillProfile( boost::shared_ptr<ImageHolder> image, const util::ivector4 &voxCoords, ProfileCache &cache );
+	void fillSpectrum( boost::shared_ptr<ImageHolder> image, const util::ivector4 &voxCoords, ProfileCache &cache );
+
+	/**
+	 * Reads profiles directly from the memory of the image.
+	 * The segments of the whole image are fetched once, so a profile costs one read per voxel.
+	 */
 	template<typename TYPE>
-	void fillVector( QVector<double> &iv, const util::ivector4 &vox, const boost::shared_ptr<ImageHolder> image, const unsigned short &axis ) {
-		util::ivector4 _coords = vox;
-		isis::data::TypedImage<TYPE> tImage( *image->getISISImage() );
+	struct TypedProfileReader {
+		std::vector< TypedSegment<TYPE> > segments;
+		std::vector<size_t> offsets;
+		util::ivector4 size;
 
-		for ( size_t i = 0; i < image->getImageSize()[axis]; i++ ) {
-			_coords[axis] = i;
-			iv.push_back( static_cast<isis::data::Image &> ( tImage ).voxel<TYPE>( _coords[0], _coords[1], _coords[2], _coords[3] ) );
+		TypedProfileReader( const boost::shared_ptr<ImageHolder> image ) : size( image->getImageSize() ) {
+			segments = image->getTypedSegments<TYPE>( 0, static_cast<size_t>( size[0] ) * size[1] * size[2] * size[3] );
+			size_t offset = 0;
+			BOOST_FOREACH( typename std::vector< TypedSegment<TYPE> >::const_reference segment, segments ) {
+				offsets.push_back( offset );
+				offset += segment.length;
+			}
 		}
-	}
 
-	template<typename TYPE>
-	void fillVectorForFFTW( double *n, const unsigned short &axis ) {
-	}
+		void operator()( const util::ivector4 &coords, const unsigned short &axis, QVector<double> &values ) const {
+			size_t strides[4];
+			strides[0] = 1;
+
+			for( unsigned short i = 1; i < 4; i++ ) {
+				strides[i] = strides[i - 1] * size[i - 1];
+			}
+
+			size_t index = 0;
+
+			for( unsigned short i = 0; i < 4; i++ ) {
+				if( i != axis ) {
+					index += coords[i] * strides[i];
+				}
+			}
+
+			values.resize( size[axis] );
+			size_t s = std::upper_bound( offsets.begin(), offsets.end(), index ) - offsets.begin() - 1;
+
+			for( int32_t i = 0; i < size[axis]; i++, index += strides[axis] ) {
+				while( index >= offsets[s] + segments[s].length ) {
+					s++;
+				}
+
+				values[i] = segments[s].begin[index - offsets[s]];
+			}
+		}
+	};
 
 };
 
@@ -0,0 +1,138 @@
+/****************************************************************
+ *
+ * <Copyright information>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *
+ * SpectrumCalculator.cpp
+ *
+ * Description:
+ *
+ *  Created on: Oct 19, 2026
+ ******************************************************************/
+#include "SpectrumCalculator.hpp"
+#include <cmath>
+
+namespace isis
+{
+namespace viewer
+{
+namespace plugin
+{
+
+SpectrumCalculator::SpectrumCalculator ( const std::string &wisdomFile )
+	: m_WisdomFile( wisdomFile ),
+	  m_WisdomChanged( false )
+{
+	if( !fftw_import_wisdom_from_filename( m_WisdomFile.c_str() ) ) {
+		LOG( Dev, info ) << "No fftw wisdom found in " << m_WisdomFile;
+	}
+}
+
+SpectrumCalculator::~SpectrumCalculator()
+{
+	typedef std::map< std::pair<int, int>, Plan >::value_type PlanType;
+	BOOST_FOREACH( PlanType & plan, m_Plans ) {
+		fftw_destroy_plan( plan.second.plan );
+		fftw_free( plan.second.in );
+		fftw_free( plan.second.out );
+	}
+
+	if( m_WisdomChanged && !fftw_export_wisdom_to_filename( m_WisdomFile.c_str() ) ) {
+		LOG( Runtime, warning ) << "Could not save the fftw wisdom to " << m_WisdomFile;
+	}
+}
+
+const SpectrumCalculator::Plan &SpectrumCalculator::getPlan ( const int &n, const int &howMany )
+{
+	//creating plans is not thread safe in fftw
+	boost::mutex::scoped_lock lock( m_PlanMutex );
+	const std::pair<int, int> key( n, howMany );
+	std::map< std::pair<int, int>, Plan >::iterator iter = m_Plans.find( key );
+
+	if( iter == m_Plans.end() ) {
+		const int nc = n / 2 + 1;
+		Plan plan;
+		plan.in = static_cast<double *>( fftw_malloc( sizeof( double ) * n * howMany ) );
+		plan.out = static_cast<fftw_complex *>( fftw_malloc( sizeof( fftw_complex ) * nc * howMany ) );
+		//measuring overwrites the buffers, the wisdom makes this cheap for known sizes
+		plan.plan = fftw_plan_many_dft_r2c( 1, &n, howMany, plan.in, NULL, 1, n, plan.out, NULL, 1, nc, FFTW_MEASURE );
+		m_WisdomChanged = true;
+		iter = m_Plans.insert( std::make_pair( key, plan ) ).first;
+	}
+
+	return iter->second;
+}
+
+void SpectrumCalculator::getAmplitudes ( const QVector< double > &values, QVector< double > &amplitudes )
+{
+	const int n = values.size();
+	const int nc = n / 2 + 1;
+	const Plan &plan = getPlan( n, 1 );
+	std::copy( values.begin(), values.end(), plan.in );
+	fftw_execute( plan.plan );
+	amplitudes.resize( nc );
+
+	for( int k = 0; k < nc; k++ ) {
+		amplitudes[k] = std::sqrt( plan.out[k][0] * plan.out[k][0] + plan.out[k][1] * plan.out[k][1] );
+	}
+}
+
+void SpectrumCalculator::getBandPower ( const ImageHolder::Pointer image, const size_t &firstBin, const size_t &lastBin, double *map, const unsigned short &numberOfThreads )
+{
+	switch( image->getImageProperties().majorTypeID ) {
+	case data::ValueArray<bool>::staticID:
+		internGetBandPower<bool>( image, firstBin, lastBin, map, numberOfThreads );
+		break;
+	case data::ValueArray<int8_t>::staticID:
+		internGetBandPower<int8_t>( image, firstBin, lastBin, map, numberOfThreads );
+		break;
+	case data::ValueArray<uint8_t>::staticID:
+		internGetBandPower<uint8_t>( image, firstBin, lastBin, map, numberOfThreads );
+		break;
+	case data::ValueArray<int16_t>::staticID:
+		internGetBandPower<int16_t>( image, firstBin, lastBin, map, numberOfThreads );
+		break;
+	case data::ValueArray<uint16_t>::staticID:
+		internGetBandPower<uint16_t>( image, firstBin, lastBin, map, numberOfThreads );
+		break;
+	case data::ValueArray<int32_t>::staticID:
+		internGetBandPower<int32_t>( image, firstBin, lastBin, map, numberOfThreads );
+		break;
+	case data::ValueArray<uint32_t>::staticID:
+		internGetBandPower<uint32_t>( image, firstBin, lastBin, map, numberOfThreads );
+		break;
+	case data::ValueArray<int64_t>::staticID:
+		internGetBandPower<int64_t>( image, firstBin, lastBin, map, numberOfThreads );
+		break;
+	case data::ValueArray<uint64_t>::staticID:
+		internGetBandPower<uint64_t>( image, firstBin, lastBin, map, numberOfThreads );
+		break;
+	case data::ValueArray<float>::staticID:
+		internGetBandPower<float>( image, firstBin, lastBin, map, numberOfThreads );
+		break;
+	case data::ValueArray<double>::staticID:
+		internGetBandPower<double>( image, firstBin, lastBin, map, numberOfThreads );
+		break;
+	default:
+		LOG( Runtime, error ) << "Can not calculate the band power of images of type " << image->getImageProperties().majorTypeName;
+		break;
+	}
+}
+
+}
+}
+}
@@ -0,0 +1,157 @@
+/****************************************************************
+ *
+ * <Copyright information>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *
+ * SpectrumCalculator.hpp
+ *
+ * Description:
+ *
+ *  Created on: Oct 19, 2026
+ ******************************************************************/
+#ifndef SPECTRUMCALCULATOR_HPP
+#define SPECTRUMCALCULATOR_HPP
+
+#include <fftw3.h>
+#include <boost/thread/mutex.hpp>
+#include <QVector>
+#include <map>
+#include "imageholder.hpp"
+
+namespace isis
+{
+namespace viewer
+{
+namespace plugin
+{
+
+/**
+ * Computes spectra with FFTW.
+ * Plans are created once per length and batch size and kept for the lifetime of the calculator.
+ * The accumulated wisdom is stored in wisdomFile, so later sessions get measured plans without measuring again.
+ */
+class SpectrumCalculator
+{
+public:
+	SpectrumCalculator( const std::string &wisdomFile );
+	~SpectrumCalculator();
+
+	///writes the amplitudes of the frequencies 0 .. values.size() / 2 of values to amplitudes
+	void getAmplitudes( const QVector<double> &values, QVector<double> &amplitudes );
+
+	/**
+	 * Writes the power of the time series of every voxel of image in the frequency bins [firstBin, lastBin] to map.
+	 * The power is the part of the mean square of the time series that lies in these bins.
+	 */
+	void getBandPower( const ImageHolder::Pointer image, const size_t &firstBin, const size_t &lastBin, double *map, const unsigned short &numberOfThreads );
+
+private:
+	///number of time series transformed by one execution of a batch plan
+	static const int batchSize = 32;
+
+	struct Plan {
+		fftw_plan plan;
+		double *in;
+		fftw_complex *out;
+	};
+
+	///returns the plan for howMany transforms of length n. The buffers of the plan must not be used concurrently.
+	const Plan &getPlan( const int &n, const int &howMany );
+
+	template<typename TYPE>
+	void internGetBandPower( const ImageHolder::Pointer image, const size_t &firstBin, const size_t &lastBin, double *map, const unsigned short &numberOfThreads ) {
+		const int n = image->getImageSize()[dim_time];
+		std::vector< std::vector< TypedSegment<TYPE> > > segments;
+
+		for( int t = 0; t < n; t++ ) {
+			segments.push_back( image->getTypedSegments<TYPE>( t ) );
+		}
+
+		const size_t volume = image->getImageSize()[0] * image->getImageSize()[1] * image->getImageSize()[2];
+		BandPowerOp<TYPE> op = { getPlan( n, batchSize ).plan, segments, n, volume, firstBin, lastBin, map };
+		parallel::forEachRange( 0, ( volume + batchSize - 1 ) / batchSize, op, numberOfThreads );
+	}
+
+	template<typename TYPE>
+	struct BandPowerOp {
+		fftw_plan plan;
+		const std::vector< std::vector< TypedSegment<TYPE> > > &segments;
+		const int n;
+		const size_t volume;
+		const size_t firstBin;
+		const size_t lastBin;
+		double *map;
+
+		void operator()( const size_t &firstBatch, const size_t &lastBatch, const unsigned short & ) {
+			const int nc = n / 2 + 1;
+			//every thread transforms in its own buffers, fftw_malloc gives them the alignment of the plan
+			double *in = static_cast<double *>( fftw_malloc( sizeof( double ) * n * batchSize ) );
+			fftw_complex *out = static_cast<fftw_complex *>( fftw_malloc( sizeof( fftw_complex ) * nc * batchSize ) );
+
+			for( size_t batch = firstBatch; batch < lastBatch; batch++ ) {
+				const size_t first = batch * batchSize;
+				const size_t last = std::min( first + batchSize, volume );
+				std::fill( in, in + n * batchSize, 0 );
+
+				//the voxels of a batch are contiguous in every volume
+				for( int t = 0; t < n; t++ ) {
+					RunOp runOp = { in + t, n };
+					forEachRun( segments[t], first, last, runOp );
+				}
+
+				fftw_execute_dft_r2c( plan, in, out );
+
+				for( size_t voxel = first; voxel < last; voxel++ ) {
+					const fftw_complex *spectrum = out + ( voxel - first ) * nc;
+					double power = 0;
+
+					for( size_t k = firstBin; k <= lastBin && k < static_cast<size_t>( nc ); k++ ) {
+						//all bins but the constant and the nyquist frequency stand for a negative frequency as well
+						const double weight = ( k == 0 || 2 * k == static_cast<size_t>( n ) ) ? 1 : 2;
+						power += weight * ( spectrum[k][0] * spectrum[k][0] + spectrum[k][1] * spectrum[k][1] );
+					}
+
+					map[voxel] = power / ( static_cast<double>( n ) * n );
+				}
+			}
+
+			fftw_free( in );
+			fftw_free( out );
+		}
+
+		struct RunOp {
+			double *destination;
+			const int n;
+			void operator()( const TYPE *begin, const size_t &length ) {
+				for( size_t i = 0; i < length; i++, destination += n ) {
+					*destination = begin[i];
+				}
+			}
+		};
+	};
+
+	std::map< std::pair<int, int>, Plan > m_Plans;
+	boost::mutex m_PlanMutex;
+	const std::string m_WisdomFile;
+	bool m_WisdomChanged;
+};
+
+}
+}
+}
+
+#endif // SPECTRUMCALCULATOR_HPP
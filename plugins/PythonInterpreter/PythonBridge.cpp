@@ -26,15 +26,71 @@
  *      Author: tuerke
  ******************************************************************/
 #include "PythonBridge.hpp"
+#include "PythonVoxelBuffer.hpp"
+#include "PythonSceneQueue.hpp"
+#include <editjournal.hpp>
+#include <boost/bind.hpp>
+#include <CoreUtils/singletons.hpp>
+
+namespace
+{
+struct AddImage {
+	isis::viewer::QViewerCore *core;
+	isis::data::Image image;
+	isis::viewer::ImageHolder::ImageType imageType;
+	isis::viewer::ImageHolder::Pointer *result;
+	void operator()() const { *result = core->addImage( image, imageType ); }
+};
+
+void synchronizeImage( isis::viewer::QViewerCore *core, isis::viewer::ImageHolder::Pointer image, bool *result )
+{
+	//e.g. a running registration reads the memory of the image
+	if( image->areVoxelsLocked() ) {
+		LOG( isis::viewer::Runtime, error ) << "The voxels of " << image->getImageProperties().fileName << " are locked, so the image can not be committed.";
+		*result = false;
+		return;
+	}
+
+	isis::util::Singletons::get<isis::viewer::EditJournal, 10>().forget( image.get() );
+	image->synchronize();
+	image->updateColorMap();
+	core->emitImageContentChanged( image );
+	*result = true;
+}
+}
 
 PythonBridge::PythonBridge( isis::viewer::QViewerCore *core )
-	: m_ViewerCore( core )
+	: m_ViewerCore( core ),
+	  m_Thread( *this ),
+	  m_MainThreadState( NULL ),
+	  m_ScriptThreadId( 0 )
 {
 	initializePython();
 
 	exposeViewerCore();
 	exposeImageHolder();
 	exposeEnums();
+
+	//from now on every thread has to acquire the GIL before it uses python
+#if PY_VERSION_HEX < 0x03070000
+	PyEval_InitThreads();
+#endif
+	m_MainThreadState = PyEval_SaveThread();
+}
+
+PythonBridge::~PythonBridge()
+{
+	interrupt();
+
+	//the script may still wait for its scene changes
+	while( !m_Thread.wait( 50 ) ) {
+		processSceneUpdates();
+	}
+
+	PyEval_RestoreThread( m_MainThreadState );
+	main_namespace.reset();
+	main_module.reset();
+	Py_Finalize();
 }
 
 void PythonBridge::exposeEnums()
@@ -54,15 +110,56 @@ void PythonBridge::exposeViewerCore()
 	( *main_namespace )["Core"] = class_<isis::viewer::QViewerCore, boost::noncopyable >( "Core" )
 								  .def( "getVersion", &isis::viewer::QViewerCore::getVersion )
 								  .staticmethod( "getVersion" )
-								  .def( "addImage", &isis::viewer::ViewerCoreBase::addImage )
-								  .def( "updateScene", &isis::viewer::QViewerCore::updateScene )
+								  .def( "addImage", &PythonBridge::addImage )
+								  .def( "updateScene", &PythonBridge::updateScene )
+								  .def( "commitImage", &PythonBridge::commitImage )
 								  ;
 
 }
 
+namespace
+{
+size_t getNumberOfTimesteps( const isis::viewer::ImageHolder &image )
+{
+	//the volume vector is empty while the volumes are run length encoded
+	return image.getImageSize()[3];
+}
+}
+
 void PythonBridge::exposeImageHolder()
 {
-	( *main_namespace )["ImageHolder"] = class_< isis::viewer::ImageHolder > ( "ImageHolder" );
+	( *main_namespace )["ImageHolder"] = class_< isis::viewer::ImageHolder, isis::viewer::ImageHolder::Pointer, boost::noncopyable > ( "ImageHolder", no_init )
+										 .def( "getChunks", &PythonVoxelBuffer::getChunkArrays )
+										 .def( "getVolume", &PythonVoxelBuffer::getVolumeArray )
+										 .def( "getNumberOfTimesteps", &getNumberOfTimesteps )
+										 ;
+}
+
+isis::viewer::ImageHolder::Pointer PythonBridge::addImage( isis::viewer::QViewerCore &core, const isis::data::Image &image, const isis::viewer::ImageHolder::ImageType &imageType )
+{
+	isis::viewer::ImageHolder::Pointer result;
+	const AddImage operation = { &core, image, imageType, &result };
+	isis::util::Singletons::get<PythonSceneQueue, 10>().post( operation, true );
+	return result;
+}
+
+void PythonBridge::updateScene( isis::viewer::QViewerCore &core )
+{
+	isis::util::Singletons::get<PythonSceneQueue, 10>().requestUpdate( &core, false );
+}
+
+void PythonBridge::commitImage( isis::viewer::QViewerCore &core, isis::viewer::ImageHolder::Pointer image )
+{
+	bool committed = false;
+	//waits, so the script can not change the voxels while they are synchronized
+	isis::util::Singletons::get<PythonSceneQueue, 10>().post( boost::bind( &synchronizeImage, &core, image, &committed ), true );
+
+	if( !committed ) {
+		PyErr_SetString( PyExc_RuntimeError, "The voxels of the image are locked, e.g. by a running registration." );
+		throw_error_already_set();
+	}
+
+	isis::util::Singletons::get<PythonSceneQueue, 10>().requestUpdate( &core, true );
 }
 
 
@@ -84,12 +181,35 @@ void PythonBridge::initializePython()
 
 
 
-std::string PythonBridge::run( const std::string &code ) const
+bool PythonBridge::start( const std::string &code )
 {
-	if( m_ViewerCore->hasImage() ) {
-		( *main_namespace )["ci"] = m_ViewerCore->getCurrentImage()->getISISImage().get();
+	if( m_Thread.isRunning() ) {
+		return false;
 	}
 
+	const PyGILState_STATE state = PyGILState_Ensure();
+
+	try {
+		if( m_ViewerCore->hasImage() ) {
+			( *main_namespace )["ci"] = m_ViewerCore->getCurrentImage()->getISISImage().get();
+			( *main_namespace )["image"] = m_ViewerCore->getCurrentImage();
+		}
+
+		( *main_namespace )["core"] = ptr( m_ViewerCore );
+	} catch( error_already_set ) {
+		PyErr_Print();
+	}
+
+	PyGILState_Release( state );
+	m_Thread.code = code;
+	m_Thread.start();
+	return true;
+}
+
+void PythonBridge::execute( const std::string &code )
+{
+	const PyGILState_STATE state = PyGILState_Ensure();
+	m_ScriptThreadId = PyThreadState_Get()->thread_id;
 
 	try {
 		handle<> ignored( ( PyRun_String( code.c_str(), Py_file_input, main_namespace->ptr(), main_namespace->ptr() ) ) );
@@ -97,5 +217,23 @@ std::string PythonBridge::run( const std::string &code ) const
 		PyErr_Print();
 	}
 
-	return python_stdio_redirector.GetOutput();
+	m_ScriptThreadId = 0;
+	PyGILState_Release( state );
+}
+
+void PythonBridge::interrupt()
+{
+	const PyGILState_STATE state = PyGILState_Ensure();
+
+	//raised as soon as the script executes python code again
+	if( m_ScriptThreadId ) {
+		PyThreadState_SetAsyncExc( m_ScriptThreadId, PyExc_KeyboardInterrupt );
+	}
+
+	PyGILState_Release( state );
+}
+
+void PythonBridge::processSceneUpdates()
+{
+	isis::util::Singletons::get<PythonSceneQueue, 10>().processPending();
 }
@@ -31,22 +31,61 @@
 
 #include <boost/python.hpp>
 #include <qviewercore.hpp>
+#include <QThread>
 #include "PythonStdIORedirect.hpp"
 
 using namespace boost::python;
 
+/**
+ * Runs python scripts with access to the viewer core.
+ * The scripts run on a dedicated interpreter thread, so the GUI stays responsive, and only this thread holds the GIL
+ * while a script runs. Scene changes of a script (addImage, updateScene, commitImage) are queued and run on the
+ * GUI thread in batches by processSceneUpdates(), which has to be called regularly while a script is running.
+ */
 class PythonBridge
 {
 public:
 	PythonBridge( isis::viewer::QViewerCore *core );
 
-	virtual ~PythonBridge() { Py_Finalize(); }
+	virtual ~PythonBridge();
 
 	boost::scoped_ptr< object > main_namespace;
 	boost::scoped_ptr< object > main_module;
-	std::string run( const std::string &code ) const;
+
+	///starts code on the interpreter thread, returns false if a script is still running
+	bool start( const std::string &code );
+	bool isRunning() const { return m_Thread.isRunning(); }
+	///raises KeyboardInterrupt in the running script
+	void interrupt();
+	///runs the scene changes requested by the running script since the last call
+	void processSceneUpdates();
+	///returns the output of the scripts since the last call
+	std::string getOutput() const { return python_stdio_redirector.GetOutput(); }
+
+	///adds image to the scene on the GUI thread and returns its ImageHolder
+	static isis::viewer::ImageHolder::Pointer addImage( isis::viewer::QViewerCore &core, const isis::data::Image &image, const isis::viewer::ImageHolder::ImageType &imageType );
+	///requests a redraw of the scene after the current batch of scene changes
+	static void updateScene( isis::viewer::QViewerCore &core );
+	/**
+	 * Has to be called after the voxels of image were changed through one of its numpy arrays.
+	 * Updates the internal representation and the min/max of image on the GUI thread and redraws the scene.
+	 * The edit journal of image is dropped, since these changes were not recorded.
+	 */
+	static void commitImage( isis::viewer::QViewerCore &core, isis::viewer::ImageHolder::Pointer image );
 private:
+	class InterpreterThread : public QThread
+	{
+	public:
+		InterpreterThread( PythonBridge &bridge ) : m_Bridge( bridge ) {}
+		std::string code;
+	protected:
+		void run() { m_Bridge.execute( code ); }
+	private:
+		PythonBridge &m_Bridge;
+	};
+
 	void initializePython();
+	void execute( const std::string &code );
 	isis::viewer::QViewerCore *m_ViewerCore;
 
 	void exposeEnums();
@@ -55,9 +94,14 @@ private:
 
 	PythonStdIoRedirect python_stdio_redirector;
 
+	InterpreterThread m_Thread;
+	//state of the GUI thread while it does not hold the GIL
+	PyThreadState *m_MainThreadState;
+	//python id of the interpreter thread while it runs a script, only accessed with the GIL held
+	unsigned long m_ScriptThreadId;
 };
 
 
 
 
-#endif
\ No newline at end of file
+#endif
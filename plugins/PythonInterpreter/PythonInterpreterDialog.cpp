@@ -7,12 +7,46 @@ isis::viewer::plugin::PyhtonInterpreterDialog::PyhtonInterpreterDialog( QWidget
 {
 	m_Interface.setupUi( this );
 	connect( m_Interface.run, SIGNAL( clicked() ), this, SLOT( run() ) );
+	connect( m_Interface.cancel, SIGNAL( clicked() ), this, SLOT( cancel() ) );
+	connect( &m_UpdateTimer, SIGNAL( timeout() ), this, SLOT( processUpdates() ) );
+	m_UpdateTimer.setInterval( 50 );
 	m_Bridge.reset( new PythonBridge( m_ViewerCore ) );
 }
 
 
 void isis::viewer::plugin::PyhtonInterpreterDialog::run()
 {
-	std::string output = m_Bridge->run( m_Interface.pythonInput->toPlainText().toStdString() );
-	m_Interface.output->addItem( output.c_str() );
+	if( m_Bridge->start( m_Interface.pythonInput->toPlainText().toStdString() ) ) {
+		m_Interface.run->setEnabled( false );
+		m_Interface.cancel->setEnabled( true );
+		m_UpdateTimer.start();
+	}
+}
+
+void isis::viewer::plugin::PyhtonInterpreterDialog::cancel()
+{
+	m_Bridge->interrupt();
+}
+
+void isis::viewer::plugin::PyhtonInterpreterDialog::processUpdates()
+{
+	const bool finished = !m_Bridge->isRunning();
+	m_Bridge->processSceneUpdates();
+	showOutput();
+
+	if( finished ) {
+		m_UpdateTimer.stop();
+		m_Interface.run->setEnabled( true );
+		m_Interface.cancel->setEnabled( false );
+	}
+}
+
+void isis::viewer::plugin::PyhtonInterpreterDialog::showOutput()
+{
+	const std::string output = m_Bridge->getOutput();
+
+	if( !output.empty() ) {
+		m_Interface.output->addItem( output.c_str() );
+		m_Interface.output->scrollToBottom();
+	}
 }
@@ -31,6 +31,7 @@
 #include "ui_pythonInterpreter.h"
 #include "qviewercore.hpp"
 #include <QDialog>
+#include <QTimer>
 
 #include "PythonBridge.hpp"
 
@@ -51,11 +52,17 @@ public:
 
 public Q_SLOTS:
 	virtual void run();
+	void cancel();
+	void processUpdates();
 
 private:
+	void showOutput();
+
 	Ui::pythonDialog m_Interface;
 	QViewerCore *m_ViewerCore;
 	boost::scoped_ptr< PythonBridge > m_Bridge;
+	//polls the running script for output and scene changes
+	QTimer m_UpdateTimer;
 };
 
 
@@ -0,0 +1,131 @@
+/****************************************************************
+ *
+ * <Copyright information>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *
+ * PythonStdIORedirect.cpp
+ *
+ * Description:
+ *
+ *  Created on: Oct 19, 2026
+ ******************************************************************/
+#include "PythonSceneQueue.hpp"
+#include <QCoreApplication>
+#include <QThread>
+#include <boost/foreach.hpp>
+#include <uicore.hpp>
+
+PythonSceneQueue::PythonSceneQueue()
+	: m_NextTicket( 0 ),
+	  m_Executed( 0 ),
+	  m_Core( NULL ),
+	  m_UpdateScene( false ),
+	  m_RefreshUI( false )
+{}
+
+bool PythonSceneQueue::isGUIThread()
+{
+	return QCoreApplication::instance() && QThread::currentThread() == QCoreApplication::instance()->thread();
+}
+
+void PythonSceneQueue::post( const Operation &operation, bool wait )
+{
+	if( isGUIThread() ) {
+		operation();
+		return;
+	}
+
+	if( !wait ) {
+		boost::lock_guard<boost::mutex> lock( m_Mutex );
+		m_Pending.push_back( std::make_pair( ++m_NextTicket, operation ) );
+		return;
+	}
+
+	//the mutex has to be unlocked before the GIL is acquired again
+	ScopedGILRelease release;
+	boost::unique_lock<boost::mutex> lock( m_Mutex );
+	const size_t ticket = ++m_NextTicket;
+	m_Pending.push_back( std::make_pair( ticket, operation ) );
+
+	//the batch the operation belongs to may already be taken by processPending, so wait for the operation itself
+	while( m_Executed < ticket ) {
+		m_BatchDone.wait( lock );
+	}
+}
+
+void PythonSceneQueue::requestUpdate( isis::viewer::QViewerCore *core, bool refreshUI )
+{
+	if( isGUIThread() ) {
+		core->updateScene();
+
+		if( refreshUI ) {
+			core->getUICore()->refreshUI();
+		}
+
+		return;
+	}
+
+	boost::lock_guard<boost::mutex> lock( m_Mutex );
+	m_Core = core;
+	m_UpdateScene = true;
+	m_RefreshUI = m_RefreshUI || refreshUI;
+}
+
+void PythonSceneQueue::processPending()
+{
+	using namespace isis;
+	using namespace isis::viewer;
+	std::vector<std::pair<size_t, Operation> > batch;
+	QViewerCore *core;
+	bool updateScene, refreshUI;
+	{
+		boost::lock_guard<boost::mutex> lock( m_Mutex );
+		batch.swap( m_Pending );
+		core = m_Core;
+		updateScene = m_UpdateScene;
+		refreshUI = m_RefreshUI;
+		m_UpdateScene = m_RefreshUI = false;
+	}
+
+	size_t executed = 0;
+	typedef std::pair<size_t, Operation> PendingType;
+	BOOST_FOREACH( const PendingType &operation, batch ) {
+		try {
+			operation.second();
+		} catch( const std::exception &e ) {
+			LOG( Runtime, error ) << "A scene operation of the python script failed: " << e.what();
+		}
+
+		executed = operation.first;
+	}
+
+	if( refreshUI ) {
+		core->getUICore()->refreshUI();
+	}
+
+	if( updateScene ) {
+		core->updateScene();
+	}
+
+	if( executed ) {
+		{
+			boost::lock_guard<boost::mutex> lock( m_Mutex );
+			m_Executed = executed;
+		}
+		m_BatchDone.notify_all();
+	}
+}
@@ -0,0 +1,85 @@
+/****************************************************************
+ *
+ * <Copyright information>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *
+ * PythonStdIORedirect.cpp
+ *
+ * Description:
+ *
+ *  Created on: Oct 19, 2026
+ ******************************************************************/
+#ifndef PYTHONSCENEQUEUE_HPP
+#define PYTHONSCENEQUEUE_HPP
+
+#include <Python.h>
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <qviewercore.hpp>
+
+/**
+ * Hands the changes of the scene requested by a script on the interpreter thread over to the GUI thread.
+ * The GUI thread runs all operations queued since its last call of processPending() as one batch,
+ * followed by at most one redraw of the scene and one refresh of the UI, no matter how often they were requested.
+ * Get the queue via util::Singletons::get<PythonSceneQueue, 10>().
+ */
+class PythonSceneQueue
+{
+public:
+	typedef boost::function<void ()> Operation;
+
+	PythonSceneQueue();
+
+	/**
+	 * Queues operation for the next batch. If wait is true the call blocks until the operation was run,
+	 * with the GIL released meanwhile, so the caller has to hold the GIL.
+	 * The operation is run at once if it is posted by the GUI thread.
+	 */
+	void post( const Operation &operation, bool wait );
+	///requests a redraw of the scene of core and optionally a refresh of the UI after the next batch
+	void requestUpdate( isis::viewer::QViewerCore *core, bool refreshUI );
+
+	///runs the pending batch, has to be called by the GUI thread
+	void processPending();
+
+private:
+	static bool isGUIThread();
+
+	boost::mutex m_Mutex;
+	boost::condition_variable m_BatchDone;
+	//operations with their ticket, which is increased with every posted operation
+	std::vector<std::pair<size_t, Operation> > m_Pending;
+	size_t m_NextTicket;
+	//all operations up to this ticket were run
+	size_t m_Executed;
+	isis::viewer::QViewerCore *m_Core;
+	bool m_UpdateScene;
+	bool m_RefreshUI;
+};
+
+///releases the GIL of the current thread for its lifetime
+class ScopedGILRelease
+{
+public:
+	ScopedGILRelease() : m_State( PyEval_SaveThread() ) {}
+	~ScopedGILRelease() { PyEval_RestoreThread( m_State ); }
+private:
+	PyThreadState *m_State;
+};
+
+#endif
@@ -30,9 +30,12 @@
 #include <sstream>
 
 PythonStdIoRedirect::ContainerType PythonStdIoRedirect::m_outputs;
+boost::mutex PythonStdIoRedirect::m_mutex;
 
 void PythonStdIoRedirect::Write( const std::string &str )
 {
+	boost::lock_guard<boost::mutex> lock( m_mutex );
+
 	if ( m_outputs.capacity() < 100 ) {
 		m_outputs.resize( 100 );
 	}
@@ -44,6 +47,7 @@ std::string PythonStdIoRedirect::GetOutput()
 {
 	std::string ret;
 	std::stringstream ss;
+	boost::lock_guard<boost::mutex> lock( m_mutex );
 
 	for( boost::circular_buffer<std::string>::const_iterator it = m_outputs.begin();
 		 it != m_outputs.end();
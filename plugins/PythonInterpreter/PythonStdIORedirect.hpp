@@ -31,6 +31,7 @@
 
 #include <iostream>
 #include <boost/circular_buffer.hpp>
+#include <boost/thread/mutex.hpp>
 
 class PythonStdIoRedirect
 {
@@ -41,6 +42,7 @@ public:
 
 private:
 	static ContainerType m_outputs; // must be static, otherwise output is missing
+	static boost::mutex m_mutex; // written by the interpreter thread, read by the GUI thread
 };
 
 
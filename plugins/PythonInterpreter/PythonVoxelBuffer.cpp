@@ -0,0 +1,208 @@
+/****************************************************************
+ *
+ * <Copyright information>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *
+ * PythonStdIORedirect.cpp
+ *
+ * Description:
+ *
+ *  Created on: Oct 19, 2026
+ ******************************************************************/
+#include "PythonVoxelBuffer.hpp"
+#include <boost/foreach.hpp>
+
+namespace
+{
+struct VoxelBufferObject {
+	PyObject_HEAD
+	boost::shared_ptr<void> *memory;
+	Py_ssize_t shape[4];
+	Py_ssize_t strides[4];
+	int ndim;
+	Py_ssize_t itemSize;
+	Py_ssize_t length;
+	const char *format;
+	bool readOnly;
+};
+
+int getBuffer( PyObject *exporter, Py_buffer *view, int flags )
+{
+	VoxelBufferObject *self = reinterpret_cast<VoxelBufferObject *>( exporter );
+
+	if( ( flags & PyBUF_WRITABLE ) == PyBUF_WRITABLE && self->readOnly ) {
+		PyErr_SetString( PyExc_BufferError, "The internal volumes of an image are read only." );
+		view->obj = NULL;
+		return -1;
+	}
+
+	view->buf = self->memory->get();
+	view->obj = exporter;
+	Py_INCREF( exporter );
+	view->len = self->length;
+	view->readonly = self->readOnly;
+	view->itemsize = self->itemSize;
+	view->format = ( flags & PyBUF_FORMAT ) == PyBUF_FORMAT ? const_cast<char *>( self->format ) : NULL;
+	view->ndim = self->ndim;
+	//the memory is contiguous in c order, so the strides may be omitted
+	view->shape = ( flags & PyBUF_ND ) == PyBUF_ND ? self->shape : NULL;
+	view->strides = ( flags & PyBUF_STRIDES ) == PyBUF_STRIDES ? self->strides : NULL;
+	view->suboffsets = NULL;
+	view->internal = NULL;
+	return 0;
+}
+
+void deallocate( PyObject *object )
+{
+	delete reinterpret_cast<VoxelBufferObject *>( object )->memory;
+	Py_TYPE( object )->tp_free( object );
+}
+
+//both are zero initialized and filled by readyVoxelBufferType
+PyBufferProcs bufferProcs;
+PyTypeObject voxelBufferType;
+
+bool readyVoxelBufferType()
+{
+	if( !voxelBufferType.tp_name ) {
+		//what PyVarObject_HEAD_INIT( NULL, 0 ) would do, the type is set by PyType_Ready
+		Py_INCREF( reinterpret_cast<PyObject *>( &voxelBufferType ) );
+		bufferProcs.bf_getbuffer = getBuffer;
+		voxelBufferType.tp_name = "vast.VoxelBuffer";
+		voxelBufferType.tp_basicsize = sizeof( VoxelBufferObject );
+		voxelBufferType.tp_dealloc = deallocate;
+		voxelBufferType.tp_as_buffer = &bufferProcs;
+#if PY_MAJOR_VERSION < 3
+		voxelBufferType.tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_NEWBUFFER;
+#else
+		voxelBufferType.tp_flags = Py_TPFLAGS_DEFAULT;
+#endif
+		voxelBufferType.tp_doc = "Voxel memory of an image exported through the buffer protocol";
+	}
+
+	return PyType_Ready( &voxelBufferType ) == 0;
+}
+}
+
+boost::python::object PythonVoxelBuffer::createArray( const boost::shared_ptr<void> &memory, const std::vector<Py_ssize_t> &shape,
+		const char *format, const Py_ssize_t &itemSize, bool readOnly )
+{
+	if( !readyVoxelBufferType() ) {
+		boost::python::throw_error_already_set();
+	}
+
+	if( shape.empty() || shape.size() > 4 ) {
+		PyErr_SetString( PyExc_ValueError, "A voxel buffer needs between one and four dimensions." );
+		boost::python::throw_error_already_set();
+	}
+
+	VoxelBufferObject *buffer = PyObject_New( VoxelBufferObject, &voxelBufferType );
+
+	if( !buffer ) {
+		boost::python::throw_error_already_set();
+	}
+
+	buffer->memory = new boost::shared_ptr<void>( memory );
+	buffer->ndim = shape.size();
+	buffer->itemSize = itemSize;
+	buffer->format = format;
+	buffer->readOnly = readOnly;
+	buffer->length = itemSize;
+
+	for( int i = buffer->ndim - 1; i >= 0; i-- ) {
+		buffer->shape[i] = shape[i];
+		buffer->strides[i] = buffer->length;
+		buffer->length *= shape[i];
+	}
+
+	const boost::python::object exporter( boost::python::handle<>( reinterpret_cast<PyObject *>( buffer ) ) );
+	return boost::python::import( "numpy" ).attr( "asarray" )( exporter );
+}
+
+boost::python::object PythonVoxelBuffer::createChunkArray( isis::data::Chunk &chunk, const std::vector<Py_ssize_t> &shape, bool readOnly )
+{
+	using namespace isis::data;
+
+	switch( chunk.getTypeID() ) {
+	case ValueArray<bool>::staticID:
+		return createTypedArray<bool>( chunk, shape, readOnly );
+	case ValueArray<int8_t>::staticID:
+		return createTypedArray<int8_t>( chunk, shape, readOnly );
+	case ValueArray<uint8_t>::staticID:
+		return createTypedArray<uint8_t>( chunk, shape, readOnly );
+	case ValueArray<int16_t>::staticID:
+		return createTypedArray<int16_t>( chunk, shape, readOnly );
+	case ValueArray<uint16_t>::staticID:
+		return createTypedArray<uint16_t>( chunk, shape, readOnly );
+	case ValueArray<int32_t>::staticID:
+		return createTypedArray<int32_t>( chunk, shape, readOnly );
+	case ValueArray<uint32_t>::staticID:
+		return createTypedArray<uint32_t>( chunk, shape, readOnly );
+	case ValueArray<int64_t>::staticID:
+		return createTypedArray<int64_t>( chunk, shape, readOnly );
+	case ValueArray<uint64_t>::staticID:
+		return createTypedArray<uint64_t>( chunk, shape, readOnly );
+	case ValueArray<float>::staticID:
+		return createTypedArray<float>( chunk, shape, readOnly );
+	case ValueArray<double>::staticID:
+		return createTypedArray<double>( chunk, shape, readOnly );
+	default:
+		PyErr_SetString( PyExc_TypeError, ( "Chunks of type " + chunk.getTypeName() + " can not be exported to numpy." ).c_str() );
+		boost::python::throw_error_already_set();
+		return boost::python::object();
+	}
+}
+
+boost::python::list PythonVoxelBuffer::getChunkArrays( isis::viewer::ImageHolder::Pointer image )
+{
+	boost::python::list arrays;
+	//another thread reads the memory of the chunks, e.g. a registration
+	const bool readOnly = image->areVoxelsLocked();
+
+	if( readOnly && PyErr_WarnEx( PyExc_RuntimeWarning, "The voxels of the image are locked, e.g. by a running registration. The arrays are read only.", 1 ) < 0 ) {
+		boost::python::throw_error_already_set();
+	}
+
+	BOOST_FOREACH( std::vector<isis::data::Chunk>::reference chunk, image->getChunkVector() ) {
+		const isis::util::FixedVector<size_t, 4> size = chunk.getSizeAsVector();
+		std::vector<Py_ssize_t> shape;
+
+		for( int i = std::max<int>( 1, chunk.getRelevantDims() ) - 1; i >= 0; i-- ) {
+			shape.push_back( size[i] );
+		}
+
+		arrays.append( createChunkArray( chunk, shape, readOnly ) );
+	}
+	return arrays;
+}
+
+boost::python::object PythonVoxelBuffer::getVolumeArray( isis::viewer::ImageHolder::Pointer image, const size_t &timestep )
+{
+	if( timestep >= image->getImageSize()[3] ) {
+		PyErr_SetString( PyExc_IndexError, "The image has no volume at this timestep." );
+		boost::python::throw_error_already_set();
+	}
+
+	const isis::util::FixedVector<size_t, 4> &size = image->getImageSize();
+	std::vector<Py_ssize_t> shape;
+	shape.push_back( size[2] );
+	shape.push_back( size[1] );
+	shape.push_back( size[0] );
+	//encoded volumes are expanded into a copy, so the internal representation is never changed by the interpreter thread
+	isis::data::Chunk volume = image->getVolume( timestep );
+	return createChunkArray( volume, shape, true );
+}
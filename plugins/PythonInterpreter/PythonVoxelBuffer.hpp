@@ -0,0 +1,75 @@
+/****************************************************************
+ *
+ * <Copyright information>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *
+ * PythonStdIORedirect.cpp
+ *
+ * Description:
+ *
+ *  Created on: Oct 19, 2026
+ ******************************************************************/
+#ifndef PYTHONVOXELBUFFER_HPP
+#define PYTHONVOXELBUFFER_HPP
+
+#include <boost/python.hpp>
+#include <imageholder.hpp>
+
+/**
+ * Creates numpy arrays on the voxel memory of images without copying it.
+ * The memory is exported to numpy through the buffer protocol by a small python object, which holds a reference
+ * to the memory, so it stays valid as long as an array on it exists.
+ * numpy is only needed when an array is created.
+ */
+class PythonVoxelBuffer
+{
+public:
+	/**
+	 * Returns a writable array for every chunk of the original image, shaped (slowest, ..., fastest) along the relevant dimensions of the chunk.
+	 * The arrays are read only while the voxels of the image are locked.
+	 */
+	static boost::python::list getChunkArrays( isis::viewer::ImageHolder::Pointer image );
+	///returns a read only array (z, y, x) on the internal representation of the volume timestep of image, or on an expanded copy if it is run length encoded
+	static boost::python::object getVolumeArray( isis::viewer::ImageHolder::Pointer image, const size_t &timestep );
+
+private:
+	template<typename TYPE> struct Format;
+
+	static boost::python::object createArray( const boost::shared_ptr<void> &memory, const std::vector<Py_ssize_t> &shape,
+			const char *format, const Py_ssize_t &itemSize, bool readOnly );
+
+	template<typename TYPE>
+	static boost::python::object createTypedArray( isis::data::Chunk &chunk, const std::vector<Py_ssize_t> &shape, bool readOnly ) {
+		return createArray( chunk.getValueArray<TYPE>().getRawAddress(), shape, Format<TYPE>::get(), sizeof( TYPE ), readOnly );
+	}
+	static boost::python::object createChunkArray( isis::data::Chunk &chunk, const std::vector<Py_ssize_t> &shape, bool readOnly );
+};
+
+//format characters of the struct module
+template<> struct PythonVoxelBuffer::Format<bool> { static const char *get() { return "?"; } };
+template<> struct PythonVoxelBuffer::Format<int8_t> { static const char *get() { return "b"; } };
+template<> struct PythonVoxelBuffer::Format<uint8_t> { static const char *get() { return "B"; } };
+template<> struct PythonVoxelBuffer::Format<int16_t> { static const char *get() { return "h"; } };
+template<> struct PythonVoxelBuffer::Format<uint16_t> { static const char *get() { return "H"; } };
+template<> struct PythonVoxelBuffer::Format<int32_t> { static const char *get() { return "i"; } };
+template<> struct PythonVoxelBuffer::Format<uint32_t> { static const char *get() { return "I"; } };
+template<> struct PythonVoxelBuffer::Format<int64_t> { static const char *get() { return "q"; } };
+template<> struct PythonVoxelBuffer::Format<uint64_t> { static const char *get() { return "Q"; } };
+template<> struct PythonVoxelBuffer::Format<float> { static const char *get() { return "f"; } };
+template<> struct PythonVoxelBuffer::Format<double> { static const char *get() { return "d"; } };
+
+#endif
@@ -30,6 +30,10 @@
 #define VAST_VOXELOP_HPP
 
 #include <DataStorage/image.hpp>
+#include <muParser.h>
+#include <limits>
+#include <boost/lexical_cast.hpp>
+#include "imageholder.hpp"
 
 namespace isis
 {
@@ -40,32 +44,364 @@ namespace plugin
 namespace _internal
 {
 
-class VoxelOp : public data::VoxelOp<double>
+///converts the result of an expression to TYPE, clamped to the range of TYPE and rounded for integer types
+template<typename TYPE>
+TYPE toType( const double &value )
+{
+	if( std::numeric_limits<TYPE>::is_integer ) {
+		if( value != value ) {
+			return 0;
+		}
+
+		const double rounded = std::floor( value + 0.5 );
+		return rounded <= static_cast<double>( std::numeric_limits<TYPE>::min() ) ? std::numeric_limits<TYPE>::min() :
+			   rounded >= static_cast<double>( std::numeric_limits<TYPE>::max() ) ? std::numeric_limits<TYPE>::max() : static_cast<TYPE>( rounded );
+	}
+
+	return static_cast<TYPE>( value );
+}
+
+template<> inline bool toType<bool>( const double &value ) { return value != 0 && value == value; }
+
+///reads the values of an image as double. An image with one volume is repeated for every timestep.
+class VoxelReader
+{
+public:
+	virtual ~VoxelReader() {}
+	///writes the values of the voxels [index, index + length) to destination
+	virtual void read( size_t index, size_t length, double *destination ) const = 0;
+	static boost::shared_ptr<VoxelReader> create( const ImageHolder::Pointer image );
+};
+
+template<typename TYPE>
+class TypedVoxelReader : public VoxelReader
+{
+public:
+	TypedVoxelReader( const ImageHolder::Pointer image )
+		: m_Size( static_cast<size_t>( image->getImageSize()[0] ) * image->getImageSize()[1] * image->getImageSize()[2] * image->getImageSize()[3] ),
+		  m_Segments( image->getTypedSegments<TYPE>( 0, m_Size ) ) {}
+
+	void read( size_t index, size_t length, double *destination ) const {
+		index %= m_Size;
+
+		while( length ) {
+			const size_t runLength = std::min( length, m_Size - index );
+			ReadOp readOp = { destination };
+			forEachRun( m_Segments, index, index + runLength, readOp );
+			destination += runLength;
+			length -= runLength;
+			index = 0;
+		}
+	}
+
+private:
+	struct ReadOp {
+		double *destination;
+		void operator()( const TYPE *begin, const size_t &length ) {
+			std::copy( begin, begin + length, destination );
+			destination += length;
+		}
+	};
+
+	const size_t m_Size;
+	const std::vector< TypedSegment<TYPE> > m_Segments;
+};
+
+///writes doubles to the memory of an image, converted to the type of the image
+class VoxelWriter
 {
-	mu::Parser parser;
-	double voxBuff;
-	util::FixedVector<double, 4> posBuff;
 public:
-	VoxelOp( std::string expr ) {
-		parser.SetExpr( expr );
-		parser.DefineVar( std::string( "vox" ), &voxBuff );
-		parser.DefineVar( std::string( "pos_x" ), &posBuff[data::rowDim] );
-		parser.DefineVar( std::string( "pos_y" ), &posBuff[data::columnDim] );
-		parser.DefineVar( std::string( "pos_z" ), &posBuff[data::sliceDim] );
-		parser.DefineVar( std::string( "pos_t" ), &posBuff[data::timeDim] );
+	virtual ~VoxelWriter() {}
+	///writes values to the voxels [index, index + length) and extends minMax by the written values
+	virtual void write( const size_t &index, const size_t &length, const double *values, std::pair<double, double> &minMax ) const = 0;
+	///the writer of the chunks of image. Throws if the chunks do not all have the major type of the image.
+	static boost::shared_ptr<VoxelWriter> create( const ImageHolder::Pointer image );
+};
+
+template<typename TYPE>
+class TypedVoxelWriter : public VoxelWriter
+{
+public:
+	TypedVoxelWriter( const std::vector< TypedSegment<TYPE> > &segments ) : m_Segments( segments ) {}
+
+	void write( const size_t &index, const size_t &length, const double *values, std::pair<double, double> &minMax ) const {
+		WriteOp writeOp = { values, &minMax };
+		forEachRun( m_Segments, index, index + length, writeOp );
+	}
+
+private:
+	struct WriteOp {
+		const double *values;
+		std::pair<double, double> *minMax;
+		void operator()( const TYPE *begin, const size_t &length ) {
+			TYPE *destination = const_cast<TYPE *>( begin );
+
+			for( size_t i = 0; i < length; i++ ) {
+				destination[i] = toType<TYPE>( values[i] );
+				const double value = destination[i];
+
+				if( value < minMax->first ) {
+					minMax->first = value;
+				}
+
+				if( value > minMax->second ) {
+					minMax->second = value;
+				}
+			}
+
+			values += length;
+		}
+	};
+
+	const std::vector< TypedSegment<TYPE> > m_Segments;
+};
+
+/**
+ * Evaluates a muParser expression for every voxel and writes the results with a VoxelWriter.
+ * The variables are the value of the voxel of the current image "vox", the values of the voxels of the loaded images by name
+ * and the position "pos_x", "pos_y", "pos_z" and "pos_t".
+ * All images are read voxel by voxel in one pass, so no intermediate image is created.
+ * The expression is evaluated in bulk mode on blocks of voxels, every thread with its own parser.
+ */
+class VoxelOp
+{
+public:
+	typedef std::vector< std::pair<std::string, ImageHolder::Pointer> > ImageList;
+
+	///number of voxels evaluated by one call of the parser
+	enum { blockSize = 1024 };
+
+	/**
+	 * Parses expression and binds the images of the list it uses.
+	 * Syntax errors and images whose grid differs from the current image are thrown as mu::Parser::exception_type.
+	 */
+	VoxelOp( const std::string &expression, const ImageHolder::Pointer image, const ImageList &images ) : m_Expression( expression ) {
+		Variables variables;
+		mu::Parser parser;
+		std::vector<std::string> names( 1, "vox" );
+		BOOST_FOREACH( ImageList::const_reference boundImage, images ) {
+			names.push_back( boundImage.first );
+		}
+		variables.define( parser, names, 1 );
+		parser.SetExpr( m_Expression );
+		parser.Eval();
+		const mu::varmap_type usedVariables = parser.GetUsedVar();
+		m_Size = image->getImageSize();
+
+		if( usedVariables.find( "vox" ) != usedVariables.end() ) {
+			bind( "vox", image, image );
+		}
+
+		BOOST_FOREACH( ImageList::const_reference boundImage, images ) {
+			if( usedVariables.find( boundImage.first ) != usedVariables.end() ) {
+				bind( boundImage.first, boundImage.second, image );
+			}
+		}
+
+		//images with one volume are repeated, all others need the same number of timesteps
+		BOOST_FOREACH( std::vector< Binding >::const_reference binding, m_Bindings ) {
+			if( binding.timesteps != 1 && binding.timesteps != static_cast<size_t>( m_Size[3] ) ) {
+				throw mu::Parser::exception_type( "The image " + binding.name + " has neither one nor " + boost::lexical_cast<std::string>( m_Size[3] ) + " timesteps." );
+			}
+		}
+	}
+
+	///the size of the result, which is the size of the current image with the most timesteps of the bound images
+	const util::ivector4 &getSize() const { return m_Size; }
+
+	///evaluates the expression for the voxels [first, last) of the result and returns the min/max of the written values
+	std::pair<double, double> apply( const VoxelWriter &writer, const size_t &first, const size_t &last, const unsigned short &numberOfThreads ) const {
+		EvaluateOp op( *this, writer, numberOfThreads );
+		const unsigned short parts = parallel::forEachRange( first, last, op, numberOfThreads, blockSize );
+		std::pair<double, double> minMax( std::numeric_limits<double>::max(), -std::numeric_limits<double>::max() );
+
+		for( unsigned short part = 0; part < parts; part++ ) {
+			minMax.first = std::min( minMax.first, op.minMax[part].first );
+			minMax.second = std::max( minMax.second, op.minMax[part].second );
+		}
+
+		return minMax;
 	}
-	bool operator()( double &vox, const isis::util::vector4<size_t>& pos ) {
-		voxBuff = vox; //using parser.DefineVar every time would slow down the evaluation
-		posBuff = pos;
-		vox = parser.Eval();
-		return true;
+
+private:
+	struct Binding {
+		std::string name;
+		size_t timesteps;
+		boost::shared_ptr<VoxelReader> reader;
+	};
+
+	void bind( const std::string &name, const ImageHolder::Pointer image, const ImageHolder::Pointer reference ) {
+		const util::ivector4 size = image->getImageSize();
+		const util::ivector4 referenceSize = reference->getImageSize();
+		bool sameGrid = size[0] == referenceSize[0] && size[1] == referenceSize[1] && size[2] == referenceSize[2];
+
+		for( unsigned short i = 0; i < 3; i++ ) {
+			sameGrid = sameGrid && std::fabs( image->getImageProperties().voxelSize[i] - reference->getImageProperties().voxelSize[i] ) < 1e-3
+					   && std::fabs( image->getImageProperties().indexOrigin[i] - reference->getImageProperties().indexOrigin[i] ) < 1e-3;
+		}
+
+		if( !sameGrid ) {
+			throw mu::Parser::exception_type( "The grid of the image " + name + " differs from the grid of the current image." );
+		}
+
+		Binding binding;
+		binding.name = name;
+		binding.timesteps = size[3];
+		binding.reader = VoxelReader::create( image );
+		m_Bindings.push_back( binding );
+		m_Size[3] = std::max( m_Size[3], size[3] );
 	}
 
+	///the arrays the variables of a parser point to in bulk mode
+	struct Variables {
+		std::vector< std::vector<double> > values;
+		std::vector<double> position[4];
+		void define( mu::Parser &parser, const std::vector<std::string> &names, const size_t &size ) {
+			values.resize( names.size(), std::vector<double>( size ) );
+
+			for( unsigned short i = 0; i < 4; i++ ) {
+				position[i].resize( size );
+			}
+
+			for( size_t i = 0; i < names.size(); i++ ) {
+				parser.DefineVar( names[i], &values[i][0] );
+			}
+
+			parser.DefineVar( std::string( "pos_x" ), &position[data::rowDim][0] );
+			parser.DefineVar( std::string( "pos_y" ), &position[data::columnDim][0] );
+			parser.DefineVar( std::string( "pos_z" ), &position[data::sliceDim][0] );
+			parser.DefineVar( std::string( "pos_t" ), &position[data::timeDim][0] );
+		}
+	};
+
+	struct EvaluateOp {
+		EvaluateOp( const VoxelOp &_voxelOp, const VoxelWriter &_writer, const unsigned short &numberOfThreads )
+			: voxelOp( _voxelOp ), writer( _writer ),
+			  minMax( numberOfThreads, std::make_pair( std::numeric_limits<double>::max(), -std::numeric_limits<double>::max() ) ) {}
+
+		void operator()( const size_t &firstVoxel, const size_t &lastVoxel, const unsigned short &threadIndex ) {
+			mu::Parser parser;
+			Variables variables;
+			std::vector<std::string> names;
+			BOOST_FOREACH( std::vector< Binding >::const_reference binding, voxelOp.m_Bindings ) {
+				names.push_back( binding.name );
+			}
+			variables.define( parser, names, blockSize );
+			parser.SetExpr( voxelOp.m_Expression );
+			std::vector<double> results( blockSize );
+			const util::ivector4 &size = voxelOp.m_Size;
+
+			for( size_t block = firstVoxel; block < lastVoxel; block += blockSize ) {
+				const size_t length = std::min<size_t>( blockSize, lastVoxel - block );
+
+				//the values of all images are read block by block and never stored as a whole
+				for( size_t i = 0; i < names.size(); i++ ) {
+					voxelOp.m_Bindings[i].reader->read( block, length, &variables.values[i][0] );
+				}
+
+				for( size_t i = 0; i < length; i++ ) {
+					size_t index = block + i;
+
+					for( unsigned short dim = 0; dim < 4; dim++ ) {
+						variables.position[dim][i] = index % size[dim];
+						index /= size[dim];
+					}
+				}
+
+				parser.Eval( &results[0], length );
+				writer.write( block, length, &results[0], minMax[threadIndex] );
+			}
+		}
+
+		const VoxelOp &voxelOp;
+		const VoxelWriter &writer;
+		std::vector< std::pair<double, double> > minMax;
+	};
+
+	const std::string m_Expression;
+	util::ivector4 m_Size;
+	std::vector< Binding > m_Bindings;
 };
 
+inline boost::shared_ptr<VoxelReader> VoxelReader::create( const ImageHolder::Pointer image )
+{
+	switch( image->getImageProperties().majorTypeID ) {
+	case data::ValueArray<bool>::staticID:
+		return boost::shared_ptr<VoxelReader>( new TypedVoxelReader<bool>( image ) );
+	case data::ValueArray<int8_t>::staticID:
+		return boost::shared_ptr<VoxelReader>( new TypedVoxelReader<int8_t>( image ) );
+	case data::ValueArray<uint8_t>::staticID:
+		return boost::shared_ptr<VoxelReader>( new TypedVoxelReader<uint8_t>( image ) );
+	case data::ValueArray<int16_t>::staticID:
+		return boost::shared_ptr<VoxelReader>( new TypedVoxelReader<int16_t>( image ) );
+	case data::ValueArray<uint16_t>::staticID:
+		return boost::shared_ptr<VoxelReader>( new TypedVoxelReader<uint16_t>( image ) );
+	case data::ValueArray<int32_t>::staticID:
+		return boost::shared_ptr<VoxelReader>( new TypedVoxelReader<int32_t>( image ) );
+	case data::ValueArray<uint32_t>::staticID:
+		return boost::shared_ptr<VoxelReader>( new TypedVoxelReader<uint32_t>( image ) );
+	case data::ValueArray<int64_t>::staticID:
+		return boost::shared_ptr<VoxelReader>( new TypedVoxelReader<int64_t>( image ) );
+	case data::ValueArray<uint64_t>::staticID:
+		return boost::shared_ptr<VoxelReader>( new TypedVoxelReader<uint64_t>( image ) );
+	case data::ValueArray<float>::staticID:
+		return boost::shared_ptr<VoxelReader>( new TypedVoxelReader<float>( image ) );
+	case data::ValueArray<double>::staticID:
+		return boost::shared_ptr<VoxelReader>( new TypedVoxelReader<double>( image ) );
+	default:
+		throw mu::Parser::exception_type( "Voxel operations are not supported for images of type " + image->getImageProperties().majorTypeName );
+	}
+}
+
+template<typename TYPE>
+boost::shared_ptr<VoxelWriter> createTypedVoxelWriter( const ImageHolder::Pointer image )
+{
+	if( image->areVoxelsLocked() ) {
+		throw mu::Parser::exception_type( "The voxels of the image can not be changed while another operation reads them." );
+	}
+
+	//the results are written to the memory of the chunks, so there must not be a converted copy
+	if( !image->hasChunksOfType<TYPE>() ) {
+		throw mu::Parser::exception_type( "Voxel operations are not supported for images with chunks of different types." );
+	}
+
+	const util::ivector4 size = image->getImageSize();
+	return boost::shared_ptr<VoxelWriter>( new TypedVoxelWriter<TYPE>( image->getTypedSegments<TYPE>( 0, static_cast<size_t>( size[0] ) * size[1] * size[2] * size[3] ) ) );
+}
+
+inline boost::shared_ptr<VoxelWriter> VoxelWriter::create( const ImageHolder::Pointer image )
+{
+	switch( image->getImageProperties().majorTypeID ) {
+	case data::ValueArray<bool>::staticID:
+		return createTypedVoxelWriter<bool>( image );
+	case data::ValueArray<int8_t>::staticID:
+		return createTypedVoxelWriter<int8_t>( image );
+	case data::ValueArray<uint8_t>::staticID:
+		return createTypedVoxelWriter<uint8_t>( image );
+	case data::ValueArray<int16_t>::staticID:
+		return createTypedVoxelWriter<int16_t>( image );
+	case data::ValueArray<uint16_t>::staticID:
+		return createTypedVoxelWriter<uint16_t>( image );
+	case data::ValueArray<int32_t>::staticID:
+		return createTypedVoxelWriter<int32_t>( image );
+	case data::ValueArray<uint32_t>::staticID:
+		return createTypedVoxelWriter<uint32_t>( image );
+	case data::ValueArray<int64_t>::staticID:
+		return createTypedVoxelWriter<int64_t>( image );
+	case data::ValueArray<uint64_t>::staticID:
+		return createTypedVoxelWriter<uint64_t>( image );
+	case data::ValueArray<float>::staticID:
+		return createTypedVoxelWriter<float>( image );
+	case data::ValueArray<double>::staticID:
+		return createTypedVoxelWriter<double>( image );
+	default:
+		throw mu::Parser::exception_type( "Voxel operations are not supported for images of type " + image->getImageProperties().majorTypeName );
+	}
+}
+
 }
 }
 }
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -27,6 +27,7 @@
  ******************************************************************/
 #include "VoxelOperationDialog.hpp"
 #include <uicore.hpp>
+#include <editjournal.hpp>
 
 namespace isis
 {
@@ -42,6 +43,56 @@ VoxelOperationDialog::VoxelOperationDialog ( QWidget *parent, QViewerCore *core
 	m_Interface.setupUi( this );
 	connect( m_Interface.calcButton, SIGNAL( pressed() ), this, SLOT( calculatePressed() ) );
 	connect( m_Interface.helpButton, SIGNAL( pressed() ), this, SLOT( helpPressed() ) );
+	connect( m_Interface.newImage, SIGNAL( toggled( bool ) ), m_Interface.currentVolumeOnly, SLOT( setDisabled( bool ) ) );
+}
+
+void VoxelOperationDialog::showEvent( QShowEvent * )
+{
+	QStringList names;
+	BOOST_FOREACH( _internal::VoxelOp::ImageList::const_reference image, getImageList() ) {
+		names << QString( "%1: %2" ).arg( image.first.c_str() ).arg( image.second->getImageProperties().fileName.c_str() );
+	}
+	m_Interface.imageNames->setText( names.join( "\n" ) );
+}
+
+_internal::VoxelOp::ImageList VoxelOperationDialog::getImageList() const
+{
+	_internal::VoxelOp::ImageList images;
+	BOOST_FOREACH( ImageHolder::Vector::const_reference image, m_ViewerCore->getImageVector() ) {
+		const size_t index = images.size();
+		const std::string name = index < 26 ? std::string( 1, 'A' + index ) : "img" + boost::lexical_cast<std::string>( index + 1 );
+		images.push_back( std::make_pair( name, image ) );
+	}
+	return images;
+}
+
+void VoxelOperationDialog::writeToNewImage( const _internal::VoxelOp &vop, const ImageHolder::Pointer image, const std::string &op )
+{
+	const util::ivector4 size = vop.getSize();
+	const size_t numberOfVoxels = static_cast<size_t>( size[0] ) * size[1] * size[2] * size[3];
+	data::MemChunk<float> ch( size[0], size[1], size[2], size[3] );
+	ch.join( static_cast<util::PropertyMap &>( *image->getISISImage() ) );
+
+	if( !ch.hasProperty( "acquisitionNumber" ) ) {
+		ch.setPropertyAs<uint16_t>( "acquisitionNumber", 0 );
+	}
+
+	TypedSegment<float> segment;
+	segment.memory = boost::shared_static_cast<const float>( ch.getValueArray<float>().getRawAddress() );
+	segment.begin = segment.memory.get();
+	segment.length = numberOfVoxels;
+	const _internal::TypedVoxelWriter<float> writer( std::vector< TypedSegment<float> >( 1, segment ) );
+	vop.apply( writer, 0, numberOfVoxels, parallel::getNumberOfThreads( *m_ViewerCore->getSettings() ) );
+	data::Image result( ch );
+	result.setPropertyAs<std::string>( "source", op );
+	const ImageHolder::Pointer resultImage = m_ViewerCore->addImage( result, image->getImageProperties().imageType );
+	BOOST_FOREACH( WidgetEnsemble::Vector::reference ensemble, m_ViewerCore->getUICore()->getEnsembleList() ) {
+		if( ensemble->hasImage( image ) ) {
+			ensemble->addImage( resultImage );
+		}
+	}
+	m_ViewerCore->setCurrentImage( resultImage );
+	m_ViewerCore->updateScene();
 }
 
 void VoxelOperationDialog::helpPressed()
@@ -56,31 +107,26 @@ void VoxelOperationDialog::calculatePressed()
 		const std::string op = m_Interface.operationInput->text().toStdString();
 
 		try {
-			_internal::VoxelOp vop( op );
 			const ImageHolder::Pointer image = m_ViewerCore->getCurrentImage();
+			_internal::VoxelOp vop( op, image, getImageList() );
 			m_Interface.calcButton->setEnabled( false );
 			m_Interface.calcButton->setText( "Calculating..." );
 			std::stringstream ss;
 			ss << "Calculating " << op << "...";
 			m_ViewerCore->getUICore()->toggleLoadingIcon( true, ss.str().c_str() );
-			image->getISISImage()->foreachVoxel<double>( vop );
-			m_ViewerCore->getUICore()->toggleLoadingIcon( false );
-			util::slist voxelOpHistory;
 
-			if( image->getPropMap().hasProperty( "VoxelOperation/opHistory" ) ) {
-				voxelOpHistory = image->getPropMap().getPropertyAs<util::slist>( "VoxelOperation/opHistory" );
+			if( m_Interface.newImage->isChecked() ) {
+				writeToNewImage( vop, image, op );
+			} else {
+				writeToImage( vop, image, op );
 			}
 
-			voxelOpHistory.push_back( op );
-			image->getPropMap().setPropertyAs<util::slist>( "VoxelOperation/opHistory", voxelOpHistory );
-			std::stringstream ss1;
-			ss1 << "VoxelOperation: " << op;
-			image->addChangedAttribute( ss1.str() );
-			image->synchronize( );
-			image->updateColorMap();
-			m_ViewerCore->emitImageContentChanged( image );
+			m_ViewerCore->getUICore()->toggleLoadingIcon( false );
 			m_ViewerCore->getUICore()->refreshUI( true );
 		} catch( mu::Parser::exception_type &e ) {
+			//voxels that were written before the error can still be undone
+			util::Singletons::get<EditJournal, 10>().commit( op );
+			m_ViewerCore->getUICore()->toggleLoadingIcon( false );
 			QMessageBox msgBox;
 			msgBox.setText( e.GetMsg().c_str() );
 			msgBox.exec();
@@ -93,6 +139,50 @@ void VoxelOperationDialog::calculatePressed()
 
 }
 
+void VoxelOperationDialog::writeToImage( const _internal::VoxelOp &vop, const ImageHolder::Pointer image, const std::string &op )
+{
+	const util::ivector4 size = image->getImageSize();
+
+	if( vop.getSize()[3] != size[3] ) {
+		throw mu::Parser::exception_type( "The result has more timesteps than the current image. Write it to a new image instead." );
+	}
+
+	const size_t volume = size[0] * size[1] * size[2];
+	std::vector<size_t> timesteps;
+
+	if( m_Interface.currentVolumeOnly->isChecked() ) {
+		timesteps.push_back( image->getImageProperties().timestep );
+	} else {
+		for( int32_t t = 0; t < size[3]; t++ ) {
+			timesteps.push_back( t );
+		}
+	}
+
+	EditJournal &journal = util::Singletons::get<EditJournal, 10>();
+	BOOST_FOREACH( std::vector<size_t>::const_reference timestep, timesteps ) {
+		journal.record( image, timestep, 0, volume );
+	}
+
+	//the volumes are contiguous, so the timesteps form one range of voxels
+	const std::pair<double, double> minMax = vop.apply( *_internal::VoxelWriter::create( image ), timesteps.front() * volume, ( timesteps.back() + 1 ) * volume,
+			parallel::getNumberOfThreads( *m_ViewerCore->getSettings() ) );
+	util::slist voxelOpHistory;
+
+	if( image->getPropMap().hasProperty( "VoxelOperation/opHistory" ) ) {
+		voxelOpHistory = image->getPropMap().getPropertyAs<util::slist>( "VoxelOperation/opHistory" );
+	}
+
+	voxelOpHistory.push_back( op );
+	image->getPropMap().setPropertyAs<util::slist>( "VoxelOperation/opHistory", voxelOpHistory );
+	std::stringstream ss1;
+	ss1 << "VoxelOperation: " << op;
+	image->addChangedAttribute( ss1.str() );
+	//only the changed volumes are converted to the internal representation again
+	image->refreshVolumes( timesteps, minMax );
+	image->updateColorMap();
+	journal.commit( op );
+	m_ViewerCore->emitImageContentChanged( image );
+}
 
 }
 }
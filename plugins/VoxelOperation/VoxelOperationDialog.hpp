@@ -54,11 +54,17 @@ public:
 public Q_SLOTS:
 	void calculatePressed();
 	void helpPressed();
+	virtual void showEvent( QShowEvent * );
 
 private:
 	Ui::voxelOperationDialog m_Interface;
 	QViewerCore *m_ViewerCore;
 
+	///the loaded images with the names they have in the operation
+	_internal::VoxelOp::ImageList getImageList() const;
+	void writeToImage( const _internal::VoxelOp &vop, const ImageHolder::Pointer image, const std::string &op );
+	void writeToNewImage( const _internal::VoxelOp &vop, const ImageHolder::Pointer image, const std::string &op );
+
 };
 
 
@@ -26,22 +26,9 @@
  *      Author: tuerke
  ******************************************************************/
 #include "RegistrationDialog.hpp"
-
-
-#include "itkAdapter.hpp"
-#include "itkCastImageFilter.h"
-#include "itkEllipseSpatialObject.h"
-#include "itkImage.h"
-#include "itkImageRegistrationMethod.h"
-#include "itkLinearInterpolateImageFunction.h"
-#include "itkImageFileReader.h"
-#include "itkImageFileWriter.h"
-#include "itkMattesMutualInformationImageToImageMetric.h"
-#include "itkRegularStepGradientDescentOptimizer.h"
-#include "itkResampleImageFilter.h"
-#include "itkRescaleIntensityImageFilter.h"
-#include "itkSpatialObjectToImageFilter.h"
-#include "itkVersorRigid3DTransform.h"
+#include "RegistrationThread.hpp"
+#include "uicore.hpp"
+#include "parallel.hpp"
 
 namespace isis
 {
@@ -50,17 +37,98 @@ namespace viewer
 namespace plugin
 {
 
+namespace
+{
+///parses a list of numbers separated by spaces or commas, returns false if an entry is not a number
+bool parseList( const QString &text, std::vector<double> &values )
+{
+	values.clear();
+	BOOST_FOREACH( const QString & entry, text.split( QRegExp( "[\\s,;]+" ), QString::SkipEmptyParts ) ) {
+		bool ok = false;
+		values.push_back( entry.toDouble( &ok ) );
+
+		if( !ok ) {
+			return false;
+		}
+	}
+	return true;
+}
+
+///reads the transform, the number of iterations and the levels from the settings tab, returns false if they are invalid
+bool getParameters( const Ui::RegistrationDialog &ui, RegistrationThread::Parameters &parameters )
+{
+	std::vector<double> shrinkFactors, sigmas, sampleRates;
+
+	if( !parseList( ui.shrinkFactorsEdit->text(), shrinkFactors ) || !parseList( ui.smoothingEdit->text(), sigmas )
+		|| !parseList( ui.sampleRatesEdit->text(), sampleRates ) ) {
+		LOG( Runtime, error ) << "The shrink factors, smoothing sigmas and sample rates have to be lists of numbers.";
+		return false;
+	}
+
+	if( shrinkFactors.empty() || sigmas.size() != shrinkFactors.size() || sampleRates.size() != shrinkFactors.size() ) {
+		LOG( Runtime, error ) << "There has to be one shrink factor, smoothing sigma and sample rate for every level.";
+		return false;
+	}
+
+	parameters.levels.clear();
+
+	for( size_t i = 0; i < shrinkFactors.size(); i++ ) {
+		RegistrationThread::Level level;
+		level.shrinkFactor = static_cast<unsigned short>( std::max( 1., shrinkFactors[i] ) );
+		level.smoothingSigma = std::max( 0., sigmas[i] );
+		level.sampleRate = std::min( 1., std::max( 0., sampleRates[i] ) );
+		parameters.levels.push_back( level );
+	}
+
+	parameters.transform = ui.transformCombo->currentIndex() == 1 ? RegistrationThread::affine : RegistrationThread::rigid;
+	parameters.numberOfIterations = ui.iterationsSpin->value();
+	return true;
+}
+
+util::fvector3 multiply( const itk::Matrix<double, 3, 3> &matrix, const util::fvector3 &vector )
+{
+	util::fvector3 ret;
+
+	for( unsigned short i = 0; i < 3; i++ ) {
+		for( unsigned short j = 0; j < 3; j++ ) {
+			ret[i] += matrix[i][j] * vector[j];
+		}
+	}
+
+	return ret;
+}
+
+util::fvector3 direction( const itk::Matrix<double, 3, 3> &matrix, const util::fvector3 &vector )
+{
+	util::fvector3 ret = multiply( matrix, vector );
+	ret.norm();
+	return ret;
+}
+}
+
 RegistrationDialog::RegistrationDialog ( QWidget *parent, QViewerCore *core )
 	: QDialog ( parent ),
-	  m_ViewerCore( core )
+	  m_ViewerCore( core ),
+	  m_Registration( new RegistrationThread )
 {
 	m_Interface.setupUi( this );
+	m_Interface.cancelButton->setEnabled( false );
+	m_Interface.progressBar->setValue( 0 );
+	m_ProgressTimer.setInterval( 200 );
 	connect( m_Interface.goButton, SIGNAL( pressed() ), this, SLOT( startRegistration() ) );
-
+	connect( m_Interface.cancelButton, SIGNAL( clicked() ), this, SLOT( cancelRegistration() ) );
+	connect( &m_ProgressTimer, SIGNAL( timeout() ), this, SLOT( updateProgress() ) );
+	connect( m_Registration, SIGNAL( finished() ), this, SLOT( registrationFinished() ) );
+	//the thread is deleted with the dialog and waits for the registration
+	m_Registration->setParent( this );
 }
 
 void RegistrationDialog::showEvent ( QShowEvent * )
 {
+	if( m_Registration->isRunning() ) {
+		return;
+	}
+
 	m_Interface.fixedImageCombo->clear();
 	m_Interface.movingImageCombo->clear();
 	BOOST_FOREACH( const ImageHolder::Vector::const_reference image, m_ViewerCore->getImageVector() ) {
@@ -69,89 +137,170 @@ void RegistrationDialog::showEvent ( QShowEvent * )
 	}
 }
 
+void RegistrationDialog::closeEvent ( QCloseEvent * )
+{
+	cancelRegistration();
+}
+
 void RegistrationDialog::startRegistration()
 {
+	if( m_Registration->isRunning() ) {
+		return;
+	}
+
 	if( m_Interface.fixedImageCombo->currentText() == m_Interface.movingImageCombo->currentText() ) {
 		QMessageBox msgBox;
 		msgBox.setIcon( QMessageBox::Question );
 		msgBox.setStandardButtons( QMessageBox::Yes | QMessageBox::No );
 		msgBox.setText( "The fixed and moving images are the same. Do you really want to proceed?" );
+
+		if( msgBox.exec() != QMessageBox::Yes ) {
+			return;
+		}
 	}
 
-	typedef itk::Image< uint8_t, 3>  ImageType;
-	typedef itk::VersorRigid3DTransform< double > TransformType;
-	typedef itk::RegularStepGradientDescentOptimizer       OptimizerType;
-	typedef itk::MattesMutualInformationImageToImageMetric<ImageType, ImageType> MetricType;
-	typedef itk::LinearInterpolateImageFunction< ImageType, double >    InterpolatorType;
-	typedef itk::ImageRegistrationMethod< ImageType, ImageType > RegistrationType;
-	typedef RegistrationType::ParametersType ParametersType;
+	m_FixedImage = m_ViewerCore->getImageMap().at( m_Interface.fixedImageCombo->currentText().toStdString() );
+	m_MovingImage = m_ViewerCore->getImageMap().at( m_Interface.movingImageCombo->currentText().toStdString() );
+
+	RegistrationThread::Parameters parameters;
+
+	if( !getParameters( m_Interface, parameters ) ) {
+		m_FixedImage.reset();
+		m_MovingImage.reset();
+		return;
+	}
+
+	parameters.numberOfThreads = parallel::getNumberOfThreads( *m_ViewerCore->getSettings() );
+	//itk may work on the memory of the chunks, so the images must not be edited until the registration has finished
+	m_FixedImage->lockVoxels();
+	m_MovingImage->lockVoxels();
+
+	if( !m_Registration->start( *m_FixedImage->getISISImage(), *m_MovingImage->getISISImage(), parameters ) ) {
+		LOG( Runtime, error ) << "Could not start the registration of " << m_MovingImage->getImageProperties().fileName
+							  << " onto " << m_FixedImage->getImageProperties().fileName << "!";
+		releaseImages();
+		return;
+	}
+
+	m_RowVec = m_MovingImage->getISISImage()->getPropertyAs<util::fvector3>( "rowVec" );
+	m_ColumnVec = m_MovingImage->getISISImage()->getPropertyAs<util::fvector3>( "columnVec" );
+	m_SliceVec = m_MovingImage->getISISImage()->getPropertyAs<util::fvector3>( "sliceVec" );
+	m_IndexOrigin = m_MovingImage->getISISImage()->getPropertyAs<util::fvector3>( "indexOrigin" );
+	m_Interface.progressBar->setMaximum( parameters.levels.size() * parameters.numberOfIterations );
+	m_Interface.progressBar->setValue( 0 );
+	m_Interface.reportEdit->clear();
+	m_Interface.metricLabel->setText( "Registering..." );
+	setRunning( true );
+	m_ProgressTimer.start();
+}
+
+void RegistrationDialog::cancelRegistration()
+{
+	if( m_Registration->isRunning() ) {
+		m_Interface.metricLabel->setText( "Cancelling..." );
+		m_Interface.cancelButton->setEnabled( false );
+		m_Registration->cancel();
+	}
+}
+
+void RegistrationDialog::updateProgress()
+{
+	RegistrationThread::Progress progress;
 
-	isis::adapter::itkAdapter *fixedAdapter = new isis::adapter::itkAdapter;
-	isis::adapter::itkAdapter *movingAdapter = new isis::adapter::itkAdapter;
+	if( m_Registration->getProgress( progress ) ) {
+		m_Interface.progressBar->setValue( progress.level * m_Registration->getParameters().numberOfIterations + progress.iteration );
+		m_Interface.metricLabel->setText( QString( "Level %1, iteration %2: metric %3" ).arg( progress.level ).arg( progress.iteration ).arg( progress.metricValue ) );
 
-	MetricType::Pointer         metric        = MetricType::New();
-	TransformType::Pointer      transform     = TransformType::New();
-	OptimizerType::Pointer      optimizer     = OptimizerType::New();
-	InterpolatorType::Pointer   interpolator  = InterpolatorType::New();
-	RegistrationType::Pointer   registration  = RegistrationType::New();
+		//the transform maps the fixed image onto the moving image, so the moving image is shown with its inverse.
+		//The adapter flips the axes of the image and of itk alike, so the physical space of itk is the one of the viewer.
+		//The orientation of an image can not scale or shear, so only the directions of an affine transform are previewed
+		if( m_Interface.previewCheck->isChecked() && !m_Registration->wasCancelled() ) {
+			itk::Matrix<double, 3, 3> inverse;
+			inverse = progress.matrix.GetInverse();
+			util::fvector3 offset;
 
-	registration->SetMetric(        metric        );
-	registration->SetOptimizer(     optimizer     );
-	registration->SetTransform(     transform     );
-	registration->SetInterpolator(  interpolator  );
+			for( unsigned short i = 0; i < 3; i++ ) {
+				offset[i] = progress.offset[i];
+			}
 
-	ImageType::Pointer fixedImage = fixedAdapter->makeItkImageObject<ImageType>( *m_ViewerCore->getImageMap().at( m_Interface.fixedImageCombo->currentText().toStdString() )->getISISImage().get() ) ;
-	ImageType::Pointer movingImage = movingAdapter->makeItkImageObject<ImageType>( *m_ViewerCore->getImageMap().at( m_Interface.movingImageCombo->currentText().toStdString() )->getISISImage().get() ) ;
+			setMovingOrientation( direction( inverse, m_RowVec ), direction( inverse, m_ColumnVec ),
+								  direction( inverse, m_SliceVec ), multiply( inverse, m_IndexOrigin - offset ) );
+		}
+	}
+}
 
-	registration->SetFixedImage( fixedImage );
-	registration->SetMovingImage( movingImage );
+void RegistrationDialog::registrationFinished()
+{
+	m_ProgressTimer.stop();
+	restoreMovingImage();
+	setRunning( false );
 
-	registration->SetFixedImageRegion( fixedImage->GetLargestPossibleRegion() );
+	if( m_Registration->wasCancelled() ) {
+		m_Interface.metricLabel->setText( "Cancelled." );
+	} else if( !m_Registration->getError().empty() ) {
+		LOG( Runtime, error ) << "The registration failed: " << m_Registration->getError();
+		m_Interface.metricLabel->setText( "Failed." );
+	} else if( !m_Registration->getResult().empty() ) {
+		m_Interface.progressBar->setValue( m_Interface.progressBar->maximum() );
+		m_Interface.metricLabel->setText( "Done." );
+		const std::vector<RegistrationThread::Level> &levels = m_Registration->getParameters().levels;
+		double seconds = 0;
 
-	ParametersType initialParameters( transform->GetNumberOfParameters() );
+		for( size_t i = 0; i < m_Registration->getReports().size(); i++ ) {
+			const RegistrationThread::LevelReport &report = m_Registration->getReports()[i];
+			m_Interface.reportEdit->appendPlainText( QString( "Level %1 (shrink %2, sigma %3 mm, samples %4): %5 iterations, metric %6, %7 s" )
+					.arg( i ).arg( levels[i].shrinkFactor ).arg( levels[i].smoothingSigma ).arg( levels[i].sampleRate )
+					.arg( report.iterations ).arg( report.metricValue ).arg( report.seconds ) );
+			seconds += report.seconds;
+		}
 
-	initialParameters.Fill( 0.0 );
+		m_Interface.reportEdit->appendPlainText( QString( "Total: %1 s with %2 threads" ).arg( seconds ).arg( m_Registration->getParameters().numberOfThreads ) );
+		m_ViewerCore->getUICore()->createViewWidgetEnsemble( m_ViewerCore->getSettings()->getPropertyAs<std::string>( "defaultViewWidgetIdentifier" ),
+				m_ViewerCore->addImage( m_Registration->getResult().front(), ImageHolder::structural_image ) );
+		m_ViewerCore->getUICore()->refreshUI();
+	}
 
-	registration->SetInitialTransformParameters( initialParameters );
+	releaseImages();
+}
 
-	optimizer->SetMaximumStepLength( 0.1 );
-	optimizer->SetMinimumStepLength( 0.0001 );
-	optimizer->SetRelaxationFactor( 0.9 );
-	optimizer->SetGradientMagnitudeTolerance( 0.00001 );
-	optimizer->SetMinimize( true );
-	optimizer->SetNumberOfIterations( 200 );
-	OptimizerType::ScalesType scale( transform->GetNumberOfParameters() );
-	scale[0] = 1.0;
-	scale[0] = 1.0;
-	scale[0] = 1.0;
-	scale[0] = 1.0 / 100.0;
-	scale[0] = 1.0 / 100.0;
-	scale[0] = 1.0 / 100.0;
-	optimizer->SetScales( scale );
+void RegistrationDialog::releaseImages()
+{
+	if( m_FixedImage && m_MovingImage ) {
+		m_FixedImage->unlockVoxels();
+		m_MovingImage->unlockVoxels();
+	}
 
-	metric->SetNumberOfFixedImageSamples( fixedImage->GetLargestPossibleRegion().GetNumberOfPixels() * 0.01 );
-	metric->SetNumberOfHistogramBins( 50 );
+	m_FixedImage.reset();
+	m_MovingImage.reset();
+}
 
-	registration->Update();
+void RegistrationDialog::setMovingOrientation( const util::fvector3 &rowVec, const util::fvector3 &columnVec, const util::fvector3 &sliceVec, const util::fvector3 &indexOrigin )
+{
+	m_MovingImage->getISISImage()->setPropertyAs<util::fvector3>( "rowVec", rowVec );
+	m_MovingImage->getISISImage()->setPropertyAs<util::fvector3>( "columnVec", columnVec );
+	m_MovingImage->getISISImage()->setPropertyAs<util::fvector3>( "sliceVec", sliceVec );
+	m_MovingImage->getISISImage()->setPropertyAs<util::fvector3>( "indexOrigin", indexOrigin );
+	m_MovingImage->updateOrientation();
+	m_ViewerCore->emitImageContentChanged( m_MovingImage );
+}
+
+void RegistrationDialog::restoreMovingImage()
+{
+	if( m_MovingImage ) {
+		setMovingOrientation( m_RowVec, m_ColumnVec, m_SliceVec, m_IndexOrigin );
+	}
+}
 
-	typedef itk::ResampleImageFilter <
-	ImageType,
-	ImageType >    ResampleFilterType;
-	ResampleFilterType::Pointer resampler = ResampleFilterType::New();
-	resampler->SetInput( movingImage );
-	resampler->SetTransform( registration->GetOutput()->Get() );
-	resampler->SetSize( fixedImage->GetLargestPossibleRegion().GetSize() );
-	resampler->SetOutputOrigin(  fixedImage->GetOrigin() );
-	resampler->SetOutputSpacing( fixedImage->GetSpacing() );
-	resampler->SetOutputDirection( fixedImage->GetDirection() );
-	resampler->SetDefaultPixelValue( 0 );
-	resampler->Update();
-	data::Image outImage = fixedAdapter->makeIsisImageObject<ImageType>( resampler->GetOutput() ).front();
-	m_ViewerCore->getUICore()->createViewWidgetEnsemble( m_ViewerCore->getSettings()->getPropertyAs<std::string>( "defaultViewWidgetIdentifier" ), m_ViewerCore->addImage( outImage, ImageHolder::structural_image ) );
-	m_ViewerCore->getUICore()->refreshUI();
+void RegistrationDialog::setRunning( bool running )
+{
+	m_Interface.goButton->setEnabled( !running );
+	m_Interface.cancelButton->setEnabled( running );
+	m_Interface.fixedImageCombo->setEnabled( !running );
+	m_Interface.movingImageCombo->setEnabled( !running );
+	m_Interface.Settings->setEnabled( !running );
 }
 
 
 }
 }
-}
\ No newline at end of file
+}
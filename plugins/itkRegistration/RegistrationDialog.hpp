@@ -39,6 +39,14 @@ namespace viewer
 namespace plugin
 {
 
+class RegistrationThread;
+
+/**
+ * Registers a moving image onto a fixed image in the background.
+ * The metric value of every iteration is shown while the registration runs and the current transform
+ * is previewed by changing the orientation of the moving image, which is restored once the registration has finished.
+ * The wall time and final metric value of every level of the pyramid are reported when the registration has finished.
+ */
 class RegistrationDialog : public QDialog
 {
 	Q_OBJECT
@@ -47,12 +55,32 @@ public:
 
 public Q_SLOTS:
 	void showEvent( QShowEvent * );
+	void closeEvent( QCloseEvent * );
 	void startRegistration();
+	void cancelRegistration();
+	void updateProgress();
+	void registrationFinished();
 
 private:
+	///shows the moving image with the given orientation
+	void setMovingOrientation( const util::fvector3 &rowVec, const util::fvector3 &columnVec, const util::fvector3 &sliceVec, const util::fvector3 &indexOrigin );
+	void restoreMovingImage();
+	///unlocks the voxels of the fixed and moving image and forgets them
+	void releaseImages();
+	void setRunning( bool running );
+
 	QViewerCore *m_ViewerCore;
 	Ui::RegistrationDialog m_Interface;
 
+	RegistrationThread *m_Registration;
+	QTimer m_ProgressTimer;
+	ImageHolder::Pointer m_FixedImage;
+	ImageHolder::Pointer m_MovingImage;
+	//orientation of the moving image before the preview
+	util::fvector3 m_RowVec;
+	util::fvector3 m_ColumnVec;
+	util::fvector3 m_SliceVec;
+	util::fvector3 m_IndexOrigin;
 };
 
 }
@@ -0,0 +1,389 @@
+/****************************************************************
+ *
+ * <Copyright information>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *
+ * RegistrationThread.cpp
+ *
+ * Description:
+ *
+ *  Created on: Oct 19, 2026
+ ******************************************************************/
+#include "RegistrationThread.hpp"
+#include <QTime>
+
+#include "itkAffineTransform.h"
+#include "itkCommand.h"
+#include "itkImageRegistrationMethod.h"
+#include "itkLinearInterpolateImageFunction.h"
+#include "itkMattesMutualInformationImageToImageMetric.h"
+#include "itkMultiThreader.h"
+#include "itkRegularStepGradientDescentOptimizer.h"
+#include "itkResampleImageFilter.h"
+#include "itkShrinkImageFilter.h"
+#include "itkSmoothingRecursiveGaussianImageFilter.h"
+#include "itkVersorRigid3DTransform.h"
+
+namespace isis
+{
+namespace viewer
+{
+namespace plugin
+{
+
+namespace
+{
+typedef itk::RegularStepGradientDescentOptimizer OptimizerType;
+typedef itk::MatrixOffsetTransformBase< double, 3, 3 > MatrixOffsetTransformType;
+typedef itk::VersorRigid3DTransform< double > RigidTransformType;
+typedef itk::AffineTransform< double, 3 > AffineTransformType;
+
+//the versor and the matrix are unitless, the translation is in mm
+void setScales( OptimizerType &optimizer, const RigidTransformType & )
+{
+	OptimizerType::ScalesType scales( 6 );
+	scales[0] = 1.0;
+	scales[1] = 1.0;
+	scales[2] = 1.0;
+	scales[3] = 1.0 / 100.0;
+	scales[4] = 1.0 / 100.0;
+	scales[5] = 1.0 / 100.0;
+	optimizer.SetScales( scales );
+}
+
+void setScales( OptimizerType &optimizer, const AffineTransformType & )
+{
+	OptimizerType::ScalesType scales( 12 );
+	scales.Fill( 1.0 );
+
+	for( unsigned short i = 9; i < 12; i++ ) {
+		scales[i] = 1.0 / 1000.0;
+	}
+
+	optimizer.SetScales( scales );
+}
+}
+
+///is called by the optimizer after every iteration in the registration thread
+class RegistrationThread::IterationObserver : public itk::Command
+{
+public:
+	typedef IterationObserver Self;
+	typedef itk::Command Superclass;
+	typedef itk::SmartPointer<Self> Pointer;
+	itkNewMacro( Self );
+
+	///transform is only used to turn the position of the optimizer into a matrix and an offset
+	void setup( RegistrationThread *thread, MatrixOffsetTransformType *transform, const unsigned short &level ) {
+		m_Thread = thread;
+		m_Transform = transform;
+		m_Level = level;
+	}
+
+	void Execute( itk::Object *caller, const itk::EventObject &event ) {
+		if( itk::IterationEvent().CheckEvent( &event ) ) {
+			OptimizerType *optimizer = static_cast<OptimizerType *>( caller );
+			m_Transform->SetParameters( optimizer->GetCurrentPosition() );
+			Progress progress;
+			progress.level = m_Level;
+			progress.iteration = optimizer->GetCurrentIteration();
+			progress.metricValue = optimizer->GetValue();
+			progress.matrix = m_Transform->GetMatrix();
+			progress.offset = m_Transform->GetOffset();
+
+			if( !m_Thread->iterationDone( progress ) ) {
+				optimizer->StopOptimization();
+			}
+		}
+	}
+	void Execute( const itk::Object *, const itk::EventObject & ) {}
+
+protected:
+	IterationObserver() : m_Thread( 0 ), m_Level( 0 ) {}
+
+private:
+	RegistrationThread *m_Thread;
+	MatrixOffsetTransformType::Pointer m_Transform;
+	unsigned short m_Level;
+};
+
+template<typename TYPE>
+class RegistrationThread::TypedRegistration : public RegistrationThread::Registration
+{
+public:
+	typedef itk::Image< TYPE, 3 > ImageType;
+	typedef itk::MattesMutualInformationImageToImageMetric< ImageType, ImageType > MetricType;
+	typedef itk::LinearInterpolateImageFunction< ImageType, double > InterpolatorType;
+	typedef itk::ImageRegistrationMethod< ImageType, ImageType > RegistrationType;
+	typedef itk::ResampleImageFilter< ImageType, ImageType > ResampleFilterType;
+	typedef itk::SmoothingRecursiveGaussianImageFilter< ImageType, ImageType > SmoothingFilterType;
+	typedef itk::ShrinkImageFilter< ImageType, ImageType > ShrinkFilterType;
+
+	TypedRegistration( adapter::itkAdapter &fixedAdapter, adapter::itkAdapter &movingAdapter, const data::Image &fixedImage, const data::Image &movingImage )
+		: m_FixedImage( fixedAdapter.makeItkImageObject<ImageType>( fixedImage ) ),
+		  m_MovingImage( movingAdapter.makeItkImageObject<ImageType>( movingImage ) )
+	{}
+
+	bool isValid() const { return m_FixedImage && m_MovingImage; }
+
+	void run( RegistrationThread &thread ) {
+		switch( thread.m_Parameters.transform ) {
+		case rigid:
+			runWith<RigidTransformType>( thread );
+			break;
+		case affine:
+			runWith<AffineTransformType>( thread );
+			break;
+		}
+	}
+
+private:
+	template<typename TRANSFORM>
+	void runWith( RegistrationThread &thread ) {
+		const Parameters &parameters = thread.m_Parameters;
+		typename TRANSFORM::Pointer transform = TRANSFORM::New();
+		typename TRANSFORM::ParametersType transformParameters = transform->GetParameters();
+
+		try {
+			for( unsigned short level = 0; level < parameters.levels.size() && !thread.m_Cancel; level++ ) {
+				QTime clock;
+				clock.start();
+				const Level &levelParameters = parameters.levels[level];
+				const typename ImageType::Pointer fixedImage = getLevelImage( m_FixedImage, levelParameters, parameters.numberOfThreads );
+				const typename ImageType::Pointer movingImage = getLevelImage( m_MovingImage, levelParameters, parameters.numberOfThreads );
+
+				typename MetricType::Pointer metric = MetricType::New();
+				OptimizerType::Pointer optimizer = OptimizerType::New();
+				typename InterpolatorType::Pointer interpolator = InterpolatorType::New();
+				typename RegistrationType::Pointer registration = RegistrationType::New();
+				IterationObserver::Pointer observer = IterationObserver::New();
+				observer->setup( &thread, TRANSFORM::New().GetPointer(), level );
+				optimizer->AddObserver( itk::IterationEvent(), observer );
+
+				registration->SetMetric( metric );
+				registration->SetOptimizer( optimizer );
+				registration->SetTransform( transform );
+				registration->SetInterpolator( interpolator );
+				registration->SetFixedImage( fixedImage );
+				registration->SetMovingImage( movingImage );
+				registration->SetFixedImageRegion( fixedImage->GetLargestPossibleRegion() );
+				registration->SetInitialTransformParameters( transformParameters );
+
+				//coarse levels may take larger steps
+				optimizer->SetMaximumStepLength( 0.1 * std::max<unsigned short>( 1, levelParameters.shrinkFactor ) );
+				optimizer->SetMinimumStepLength( 0.0001 );
+				optimizer->SetRelaxationFactor( 0.9 );
+				optimizer->SetGradientMagnitudeTolerance( 0.00001 );
+				optimizer->SetMinimize( true );
+				optimizer->SetNumberOfIterations( parameters.numberOfIterations );
+				setScales( *optimizer, *transform );
+
+				const size_t numberOfPixels = fixedImage->GetLargestPossibleRegion().GetNumberOfPixels();
+				metric->SetNumberOfFixedImageSamples( std::min<size_t>( numberOfPixels, std::max<size_t>( 1000, numberOfPixels * levelParameters.sampleRate ) ) );
+				metric->SetNumberOfHistogramBins( 50 );
+#if ITK_VERSION_MAJOR >= 4
+				metric->SetNumberOfThreads( parameters.numberOfThreads );
+#endif
+
+				registration->Update();
+				transformParameters = registration->GetLastTransformParameters();
+
+				LevelReport report;
+				report.iterations = optimizer->GetCurrentIteration();
+				report.metricValue = optimizer->GetValue();
+				report.seconds = clock.elapsed() / 1000.;
+				thread.m_Reports.push_back( report );
+				LOG( Runtime, info ) << "Registration level " << level << " (shrink factor " << levelParameters.shrinkFactor
+									 << ", sigma " << levelParameters.smoothingSigma << "mm, sample rate " << levelParameters.sampleRate
+									 << "): " << report.iterations << " iterations, metric " << report.metricValue << " in " << report.seconds << "s";
+			}
+
+			if( thread.m_Cancel ) {
+				return;
+			}
+
+			transform->SetParameters( transformParameters );
+			typename ResampleFilterType::Pointer resampler = ResampleFilterType::New();
+			resampler->SetNumberOfThreads( parameters.numberOfThreads );
+			resampler->SetInput( m_MovingImage );
+			resampler->SetTransform( transform );
+			resampler->SetSize( m_FixedImage->GetLargestPossibleRegion().GetSize() );
+			resampler->SetOutputOrigin( m_FixedImage->GetOrigin() );
+			resampler->SetOutputSpacing( m_FixedImage->GetSpacing() );
+			resampler->SetOutputDirection( m_FixedImage->GetDirection() );
+			resampler->SetDefaultPixelValue( 0 );
+			resampler->Update();
+			thread.m_Result = thread.m_FixedAdapter->makeIsisImageObject<ImageType>( resampler->GetOutput() );
+		} catch( itk::ExceptionObject &e ) {
+			thread.m_Error = e.GetDescription();
+		}
+	}
+
+	///returns image smoothed and shrunk as given by level
+	static typename ImageType::Pointer getLevelImage( const typename ImageType::Pointer image, const Level &level, const unsigned short &numberOfThreads ) {
+		typename ImageType::Pointer levelImage = image;
+
+		if( level.smoothingSigma > 0 ) {
+			typename SmoothingFilterType::Pointer smoothing = SmoothingFilterType::New();
+			smoothing->SetNumberOfThreads( numberOfThreads );
+			smoothing->SetInput( levelImage );
+			smoothing->SetSigma( level.smoothingSigma );
+			smoothing->Update();
+			levelImage = smoothing->GetOutput();
+			levelImage->DisconnectPipeline();
+		}
+
+		if( level.shrinkFactor > 1 ) {
+			typename ShrinkFilterType::Pointer shrink = ShrinkFilterType::New();
+			shrink->SetNumberOfThreads( numberOfThreads );
+			shrink->SetInput( levelImage );
+			shrink->SetShrinkFactors( level.shrinkFactor );
+			shrink->Update();
+			levelImage = shrink->GetOutput();
+			levelImage->DisconnectPipeline();
+		}
+
+		return levelImage;
+	}
+
+	typename ImageType::Pointer m_FixedImage;
+	typename ImageType::Pointer m_MovingImage;
+};
+
+RegistrationThread::RegistrationThread()
+	: m_Cancel( 0 ),
+	  m_HasProgress( false )
+{
+	m_Parameters.transform = rigid;
+	m_Parameters.numberOfIterations = 0;
+	m_Parameters.numberOfThreads = 1;
+	m_Progress.level = 0;
+	m_Progress.iteration = 0;
+	m_Progress.metricValue = 0;
+}
+
+RegistrationThread::~RegistrationThread()
+{
+	cancel();
+	wait();
+}
+
+bool RegistrationThread::start( const data::Image &fixedImage, const data::Image &movingImage, const Parameters &parameters )
+{
+	if( isRunning() ) {
+		LOG( Runtime, warning ) << "The registration is still running.";
+		return false;
+	}
+
+	if( parameters.levels.empty() ) {
+		LOG( Runtime, error ) << "The registration needs at least one level.";
+		return false;
+	}
+
+	if( !createRegistration( fixedImage, movingImage ) ) {
+		return false;
+	}
+
+	m_Parameters = parameters;
+	m_Parameters.numberOfThreads = std::max<unsigned short>( 1, parameters.numberOfThreads );
+	//filters created by itk itself, e.g. inside the metric, use the global default
+	itk::MultiThreader::SetGlobalDefaultNumberOfThreads( m_Parameters.numberOfThreads );
+	m_Cancel = 0;
+	m_Error.clear();
+	m_Result.clear();
+	m_Reports.clear();
+	m_Progress.level = 0;
+	m_Progress.iteration = 0;
+	m_Progress.metricValue = 0;
+	m_HasProgress = false;
+	QThread::start();
+	return true;
+}
+
+bool RegistrationThread::createRegistration( const data::Image &fixedImage, const data::Image &movingImage )
+{
+	m_Registration.reset();
+	m_FixedAdapter.reset( new adapter::itkAdapter );
+	m_MovingAdapter.reset( new adapter::itkAdapter );
+
+	switch( fixedImage.getChunkAt( 0, false ).getTypeID() ) {
+	case data::ValueArray<int8_t>::staticID:
+		m_Registration.reset( new TypedRegistration<int8_t>( *m_FixedAdapter, *m_MovingAdapter, fixedImage, movingImage ) );
+		break;
+	case data::ValueArray<uint8_t>::staticID:
+		m_Registration.reset( new TypedRegistration<uint8_t>( *m_FixedAdapter, *m_MovingAdapter, fixedImage, movingImage ) );
+		break;
+	case data::ValueArray<int16_t>::staticID:
+		m_Registration.reset( new TypedRegistration<int16_t>( *m_FixedAdapter, *m_MovingAdapter, fixedImage, movingImage ) );
+		break;
+	case data::ValueArray<uint16_t>::staticID:
+		m_Registration.reset( new TypedRegistration<uint16_t>( *m_FixedAdapter, *m_MovingAdapter, fixedImage, movingImage ) );
+		break;
+	case data::ValueArray<int32_t>::staticID:
+		m_Registration.reset( new TypedRegistration<int32_t>( *m_FixedAdapter, *m_MovingAdapter, fixedImage, movingImage ) );
+		break;
+	case data::ValueArray<uint32_t>::staticID:
+		m_Registration.reset( new TypedRegistration<uint32_t>( *m_FixedAdapter, *m_MovingAdapter, fixedImage, movingImage ) );
+		break;
+	case data::ValueArray<float>::staticID:
+		m_Registration.reset( new TypedRegistration<float>( *m_FixedAdapter, *m_MovingAdapter, fixedImage, movingImage ) );
+		break;
+	case data::ValueArray<double>::staticID:
+		m_Registration.reset( new TypedRegistration<double>( *m_FixedAdapter, *m_MovingAdapter, fixedImage, movingImage ) );
+		break;
+	default:
+		LOG( Runtime, error ) << "The type of the fixed image is not supported by the registration.";
+		return false;
+	}
+
+	return m_Registration->isValid();
+}
+
+void RegistrationThread::cancel()
+{
+	m_Cancel = 1;
+}
+
+bool RegistrationThread::iterationDone( const Progress &progress )
+{
+	boost::mutex::scoped_lock lock( m_ProgressMutex );
+	m_Progress = progress;
+	m_HasProgress = true;
+	return !m_Cancel;
+}
+
+bool RegistrationThread::getProgress( Progress &progress )
+{
+	boost::mutex::scoped_lock lock( m_ProgressMutex );
+
+	if( !m_HasProgress ) {
+		return false;
+	}
+
+	progress = m_Progress;
+	m_HasProgress = false;
+	return true;
+}
+
+void RegistrationThread::run()
+{
+	m_Registration->run( *this );
+}
+
+}
+}
+}
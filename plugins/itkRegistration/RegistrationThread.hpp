@@ -0,0 +1,163 @@
+/****************************************************************
+ *
+ * <Copyright information>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *
+ * RegistrationThread.hpp
+ *
+ * Description:
+ *
+ *  Created on: Oct 19, 2026
+ ******************************************************************/
+
+#ifndef VAST_ITKREGISTRATIONTHREAD_HPP
+#define VAST_ITKREGISTRATIONTHREAD_HPP
+
+#include <QThread>
+#include <QAtomicInt>
+#include <boost/thread/mutex.hpp>
+#include <DataStorage/image.hpp>
+
+#include "itkAdapter.hpp"
+#include "itkMatrix.h"
+#include "itkVector.h"
+
+namespace isis
+{
+namespace viewer
+{
+namespace plugin
+{
+
+/**
+ * Runs the Mattes mutual information registration of a moving onto a fixed image and the resampling
+ * of the moving image in a background thread.
+ * The registration runs through a pyramid of levels. On each level both images are smoothed and shrunk,
+ * and the transform found on a level is the start of the next one.
+ * The state of the optimizer is stored after every iteration and can be polled with getProgress(), e.g. to preview the transform.
+ * cancel() stops the optimizer after its current iteration.
+ */
+class RegistrationThread : public QThread
+{
+public:
+	enum TransformType { rigid, affine };
+
+	struct Level {
+		///factor by which both images are shrunk along each axis
+		unsigned short shrinkFactor;
+		///sigma of the gaussian applied before shrinking in mm, no smoothing if 0
+		double smoothingSigma;
+		///fraction of the voxels of the shrunk fixed image the metric samples
+		double sampleRate;
+	};
+
+	struct Parameters {
+		TransformType transform;
+		///levels from coarse to fine
+		std::vector<Level> levels;
+		///maximum number of iterations of each level
+		unsigned int numberOfIterations;
+		unsigned short numberOfThreads;
+	};
+
+	struct Progress {
+		unsigned short level;
+		unsigned int iteration;
+		double metricValue;
+		///the current transform, which maps a point x of the fixed image to matrix * x + offset in the moving image
+		itk::Matrix<double, 3, 3> matrix;
+		itk::Vector<double, 3> offset;
+	};
+
+	struct LevelReport {
+		unsigned int iterations;
+		double metricValue;
+		///wall time of the level in seconds, including the smoothing and shrinking
+		double seconds;
+	};
+
+	RegistrationThread();
+	///cancels the running registration and waits for it
+	~RegistrationThread();
+
+	/**
+	 * Converts both images and starts the registration.
+	 * The registration works on the pixel type of the fixed image. If the moving image has this type as well
+	 * and both consist of one chunk, itk uses their memory directly, otherwise they are copied by the calling thread.
+	 * Returns false if the registration is still running, parameters has no level or an image could not be converted.
+	 */
+	bool start( const data::Image &fixedImage, const data::Image &movingImage, const Parameters &parameters );
+	///lets the optimizer stop after its current iteration, getResult() stays empty
+	void cancel();
+
+	/**
+	 * Copies the state of the optimizer after its last iteration to progress.
+	 * Returns false if no iteration has finished since the last call.
+	 */
+	bool getProgress( Progress &progress );
+	const Parameters &getParameters() const { return m_Parameters; }
+
+	bool wasCancelled() const { return m_Cancel; }
+	///returns the description of the itk exception that aborted the registration, only valid when the thread has finished
+	const std::string &getError() const { return m_Error; }
+	///returns the moving image resampled into the space of the fixed image, only valid when the thread has finished
+	const std::list<data::Image> &getResult() const { return m_Result; }
+	///returns the timing and final metric value of every finished level, only valid when the thread has finished
+	const std::vector<LevelReport> &getReports() const { return m_Reports; }
+
+protected:
+	void run();
+
+private:
+	class IterationObserver;
+
+	///the registration pipeline for the pixel type of the fixed image
+	class Registration
+	{
+	public:
+		virtual ~Registration() {}
+		virtual bool isValid() const = 0;
+		virtual void run( RegistrationThread &thread ) = 0;
+	};
+	template<typename TYPE> class TypedRegistration;
+
+	bool createRegistration( const data::Image &fixedImage, const data::Image &movingImage );
+
+	///stores the state of the optimizer, returns false if the registration has been cancelled
+	bool iterationDone( const Progress &progress );
+
+	//the adapters keep the metadata and memory of the images they converted, so they are created for every registration
+	//and have to outlive m_Registration
+	boost::shared_ptr<adapter::itkAdapter> m_FixedAdapter;
+	boost::shared_ptr<adapter::itkAdapter> m_MovingAdapter;
+	boost::shared_ptr<Registration> m_Registration;
+	Parameters m_Parameters;
+	QAtomicInt m_Cancel;
+	std::string m_Error;
+	std::list<data::Image> m_Result;
+	std::vector<LevelReport> m_Reports;
+
+	boost::mutex m_ProgressMutex;
+	Progress m_Progress;
+	bool m_HasProgress;
+};
+
+}
+}
+}
+
+#endif // VAST_ITKREGISTRATIONTHREAD_HPP
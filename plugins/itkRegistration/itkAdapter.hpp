@@ -34,13 +34,17 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/numeric/ublas/matrix.hpp>
 #include <boost/foreach.hpp>
+#include <boost/type_traits/is_same.hpp>
+#include <boost/type_traits/integral_constant.hpp>
 
 //itk includes
 #include <itkImage.h>
 #include <itkImportImageFilter.h>
 #include <itkRescaleIntensityImageFilter.h>
+#include <itkCastImageFilter.h>
 
 #include <vector>
+#include <limits>
 
 namespace isis
 {
@@ -63,6 +67,9 @@ public:
 	  *  1  1  1  1 <br>
 	  *  to meet the itk intern data representation requirements.<br>
 	  *  If set to false, orientation matrix will not be changed.
+	  *  If the pixel type of TImage is the type of the image and the image consists of one chunk, the itk image uses the memory
+	  *  of that chunk without copying it. In this case the adapter has to live as long as the itk image.
+	  *  If the image consists of several chunks they are copied into one buffer, the intensities are only rescaled if the types differ.
 	  *  \returns an itk smartpointer on the itkImage object
 	  */
 	template<typename TImage> typename TImage::Pointer
@@ -97,8 +104,14 @@ private:
 	std::vector< boost::shared_ptr<util::PropertyMap> > m_ChunkPropertyMapVector;
 	util::PropertyMap m_ImagePropertyMap;
 	size_t m_RelevantDim;
+	//memory of the chunk an itk image works on
+	boost::shared_ptr<void> m_ImportedMemory;
 
 	template<typename TInput, typename TOutput> typename TOutput::Pointer internCreateItk( const bool behaveAsItkReader );
+	///returns the output of importer, which already has the pixel type of TOutput
+	template<typename TImporter, typename TOutput> typename TOutput::Pointer internFinishItk( typename TImporter::Pointer importer, const boost::true_type & );
+	///returns the output of importer cast to the pixel type of TOutput, values that do not fit are rescaled to the range of that type
+	template<typename TImporter, typename TOutput> typename TOutput::Pointer internFinishItk( typename TImporter::Pointer importer, const boost::false_type & );
 
 	template<typename TImageITK, typename TOutputISIS> std::list<data::Image> internCreateISIS( const typename TImageITK::Pointer src, const bool behaveAsItkWriter );
 };
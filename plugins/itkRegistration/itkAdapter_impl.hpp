@@ -111,11 +111,8 @@ typename TOutput::Pointer itkAdapter::internCreateItk( const bool behaveAsItkRea
 	typedef itk::Image<TInput, TOutput::ImageDimension> InputImageType;
 	typedef TOutput OutputImageType;
 	typedef itk::ImportImageFilter<typename InputImageType::PixelType, OutputImageType::ImageDimension> MyImporterType;
-	typedef itk::RescaleIntensityImageFilter<InputImageType, OutputImageType> MyRescaleType;
 	typedef std::set<util::istring> PropKeyListType;
 	typename MyImporterType::Pointer importer = MyImporterType::New();
-	typename MyRescaleType::Pointer rescaler = MyRescaleType::New();
-	typename OutputImageType::Pointer outputImage = OutputImageType::New();
 	typename OutputImageType::SpacingType itkSpacing;
 	typename OutputImageType::PointType itkOrigin;
 	typename OutputImageType::DirectionType itkDirection;
@@ -202,28 +199,70 @@ typename TOutput::Pointer itkAdapter::internCreateItk( const bool behaveAsItkRea
 	importer->SetDirection( itkDirection );
 	m_ImagePropertyMap = static_cast<util::PropertyMap>( *m_ImageISIS );
 	m_RelevantDim = m_ImageISIS->getChunkAt( 0 ).getRelevantDims();
-	//reorganisation of memory according to the chunk organisiation
-	void *targePtr = malloc( m_ImageISIS->getMaxBytesPerVoxel() * m_ImageISIS->getVolume() );
-	typename InputImageType::PixelType *refTarget = ( typename InputImageType::PixelType * ) targePtr;
+	typedef typename InputImageType::PixelType InputPixelType;
 	std::vector< data::Chunk> chList = m_ImageISIS->copyChunksToVector();
-	size_t chunkIndex = 0;
 	BOOST_FOREACH(  std::vector<data::Chunk >::reference ref, chList ) {
-		data::Chunk &chRef = ref;
-		typename InputImageType::PixelType *target = refTarget + chunkIndex++ * chRef.getVolume();
-		chRef.getValueArray<typename InputImageType::PixelType>().copyToMem( target,  chRef.getVolume() );
-		boost::shared_ptr<util::PropertyMap> tmpMap ( new util::PropertyMap ( static_cast<util::PropertyMap>( chRef ) ) );
+		boost::shared_ptr<util::PropertyMap> tmpMap ( new util::PropertyMap ( static_cast<util::PropertyMap>( ref ) ) );
 		m_ChunkPropertyMapVector.push_back( tmpMap );
 	}
-	importer->SetImportPointer( refTarget, itkSize[0], false );
-	rescaler->SetInput( importer->GetOutput() );
-	std::pair<util::ValueReference, util::ValueReference> minMaxPair = m_ImageISIS->getMinMax();
-	rescaler->SetOutputMinimum( minMaxPair.first->as<typename InputImageType::PixelType>() );
-	rescaler->SetOutputMaximum( minMaxPair.second->as<typename InputImageType::PixelType>() );
-	rescaler->Update();
-	outputImage = rescaler->GetOutput();
+	const bool nativeType = boost::is_same<InputPixelType, typename OutputImageType::PixelType>::value;
 
-	free( targePtr );
+	if( nativeType && chList.size() == 1 ) {
+		//the image is one contiguous block of the requested type, so itk works on the memory of the chunk.
+		//The adapter keeps it alive, but does not let itk free it
+		m_ImportedMemory = chList.front().getValueArray<InputPixelType>().getRawAddress();
+		importer->SetImportPointer( static_cast<InputPixelType *>( m_ImportedMemory.get() ), m_ImageISIS->getVolume(), false );
+	} else {
+		//reorganisation of memory according to the chunk organisiation, the buffer belongs to the importer
+		InputPixelType *refTarget = new InputPixelType[m_ImageISIS->getVolume()];
+		size_t offset = 0;
+		BOOST_FOREACH(  std::vector<data::Chunk >::reference ref, chList ) {
+			ref.getValueArray<InputPixelType>().copyToMem( refTarget + offset,  ref.getVolume() );
+			offset += ref.getVolume();
+		}
+		importer->SetImportPointer( refTarget, m_ImageISIS->getVolume(), true );
+	}
+
+	return internFinishItk<MyImporterType, OutputImageType>( importer, boost::integral_constant<bool, nativeType>() );
+}
+
+template<typename TImporter, typename TOutput>
+typename TOutput::Pointer itkAdapter::internFinishItk( typename TImporter::Pointer importer, const boost::true_type & )
+{
+	importer->Update();
+	typename TOutput::Pointer outputImage = importer->GetOutput();
+	outputImage->DisconnectPipeline();
+	return outputImage;
+}
+
+template<typename TImporter, typename TOutput>
+typename TOutput::Pointer itkAdapter::internFinishItk( typename TImporter::Pointer importer, const boost::false_type & )
+{
+	typedef typename TOutput::PixelType OutputPixelType;
+	const std::pair<util::ValueReference, util::ValueReference> minMaxPair = m_ImageISIS->getMinMax();
+	const double lowest = std::numeric_limits<OutputPixelType>::is_integer ? std::numeric_limits<OutputPixelType>::min() : -std::numeric_limits<OutputPixelType>::max();
+	const double highest = std::numeric_limits<OutputPixelType>::max();
+	typename TOutput::Pointer outputImage;
+
+	if( minMaxPair.first->as<double>() >= lowest && minMaxPair.second->as<double>() <= highest ) {
+		//the values fit into the output type, so they keep their meaning
+		typedef itk::CastImageFilter<typename TImporter::OutputImageType, TOutput> MyCastType;
+		typename MyCastType::Pointer caster = MyCastType::New();
+		caster->SetInput( importer->GetOutput() );
+		caster->Update();
+		outputImage = caster->GetOutput();
+	} else {
+		LOG( Runtime, info ) << "The values of the image do not fit into the requested type and are rescaled to its range.";
+		typedef itk::RescaleIntensityImageFilter<typename TImporter::OutputImageType, TOutput> MyRescaleType;
+		typename MyRescaleType::Pointer rescaler = MyRescaleType::New();
+		rescaler->SetInput( importer->GetOutput() );
+		rescaler->SetOutputMinimum( static_cast<OutputPixelType>( lowest ) );
+		rescaler->SetOutputMaximum( static_cast<OutputPixelType>( highest ) );
+		rescaler->Update();
+		outputImage = rescaler->GetOutput();
+	}
 
+	outputImage->DisconnectPipeline();
 	return outputImage;
 }
 
@@ -0,0 +1,218 @@
+/****************************************************************
+ *
+ * <Copyright information>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *
+ * LightboxMosaic.cpp
+ *
+ * Description:
+ *
+ *  Created on: Oct 19, 2026
+ ******************************************************************/
+#include "LightboxMosaic.hpp"
+#include "parallel.hpp"
+
+namespace isis
+{
+namespace viewer
+{
+namespace widget
+{
+namespace
+{
+
+/**
+ * Copies the voxels of the planes [first, last) of a volume into the tiles of a mosaic.
+ * Axis i of the volume is axis mapping[i] of the mosaic, where 0 and 1 are the axes of a tile and 2 is the slice axis.
+ * Run length encoded volumes (runs is not NULL) are expanded one plane at a time.
+ */
+template<typename TYPE>
+struct ExtractOp {
+	const TYPE *src;
+	const RunLengthVolume *runs;
+	util::ivector4 size;
+	util::ivector4 mapping;
+	int32_t tileWidth;
+	int32_t tileHeight;
+	bool flipX;
+	bool flipY;
+	unsigned short columns;
+	const std::vector<int32_t> *slices;
+	const std::vector<int32_t> *tileOfSlice;
+	uint8_t *dest;
+	size_t bytesPerLine;
+
+	uint8_t *getPixel( const int32_t &tile, const int32_t &x, const int32_t &y ) const {
+		const size_t row = ( tile / columns ) * tileHeight + ( flipY ? tileHeight - 1 - y : y );
+		const size_t column = ( tile % columns ) * tileWidth + ( flipX ? tileWidth - 1 - x : x );
+		return dest + row * bytesPerLine + column * sizeof( TYPE );
+	}
+
+	void operator()( const size_t &first, const size_t &last, const unsigned short & ) const {
+		int32_t coords[3];
+		const size_t planeSize = static_cast<size_t>( size[0] ) * size[1];
+		std::vector<TYPE> plane( runs ? planeSize : 0 );
+
+		for( int32_t z = first; z < static_cast<int32_t>( last ); z++ ) {
+			//the whole plane belongs to a slice that is not shown
+			if( mapping[2] == 2 && ( *tileOfSlice )[z] < 0 ) {
+				continue;
+			}
+
+			coords[mapping[2]] = z;
+			const TYPE *planeBegin = runs ? 0 : src + z * planeSize;
+
+			if( runs ) {
+				for( size_t i = 0; i < planeSize; i++ ) {
+					plane[i] = getEncodedVoxel<TYPE>( *runs, z * planeSize + i );
+				}
+
+				planeBegin = &plane[0];
+			}
+
+			for( int32_t y = 0; y < size[1]; y++ ) {
+				coords[mapping[1]] = y;
+				const TYPE *row = planeBegin + static_cast<size_t>( y ) * size[0];
+
+				if( mapping[0] == 2 ) {
+					//the rows run across the slices, so each row holds one voxel of every tile
+					for( size_t tile = 0; tile < slices->size(); tile++ ) {
+						const int32_t slice = ( *slices )[tile];
+
+						if( slice >= 0 && slice < size[0] ) {
+							*reinterpret_cast<TYPE *>( getPixel( tile, coords[0], coords[1] ) ) = row[slice];
+						}
+					}
+				} else {
+					const int32_t tile = ( *tileOfSlice )[coords[2]];
+
+					if( tile < 0 ) {
+						continue;
+					}
+
+					coords[mapping[0]] = 0;
+					uint8_t *pixel = getPixel( tile, coords[0], coords[1] );
+					const ptrdiff_t step = mapping[0] == 0
+										   ? ( flipX ? -1 : 1 ) * static_cast<ptrdiff_t>( sizeof( TYPE ) )
+										   : ( flipY ? -1 : 1 ) * static_cast<ptrdiff_t>( bytesPerLine );
+
+					for( int32_t x = 0; x < size[0]; x++ ) {
+						*reinterpret_cast<TYPE *>( pixel + x * step ) = row[x];
+					}
+				}
+			}
+		}
+	}
+};
+
+}
+
+LightboxMosaic::LightboxMosaic()
+	: m_TileWidth( 0 ),
+	  m_TileHeight( 0 ),
+	  m_BytesPerLine( 0 ),
+	  m_ContentRevision( 0 ),
+	  m_Timestep( 0 ),
+	  m_Columns( 0 )
+{}
+
+bool LightboxMosaic::update( const ImageHolder::Pointer image, const PlaneOrientation &orientation, const unsigned short &columns, const std::vector<int32_t> &slices, const unsigned short &numberOfThreads )
+{
+	const ImageHolder::ImageProperties &properties = image->getImageProperties();
+	const util::ivector4 mapping = mapCoordsToOrientation( util::ivector4( 0, 1, 2, 3 ), properties.latchedOrientation, orientation, true );
+	const util::ivector4 flip = mapCoordsToOrientation( util::ivector4( 1, 1, 1, 1 ), properties.latchedOrientation, orientation, false, false );
+
+	if( !m_Image.isNull()
+		&& m_ContentRevision == image->getContentRevision()
+		&& m_Timestep == properties.timestep
+		&& m_Mapping == mapping
+		&& m_Flip == flip
+		&& m_Columns == columns
+		&& m_Slices == slices ) {
+		return false;
+	}
+
+	m_ContentRevision = image->getContentRevision();
+	m_Timestep = properties.timestep;
+	m_Mapping = mapping;
+	m_Flip = flip;
+	m_Columns = columns;
+	m_Slices = slices;
+
+	//the image refers to the buffer, so it has to be released before the buffer is reallocated
+	m_Image = QImage();
+
+	const util::ivector4 mappedSize = mapCoordsToOrientation( image->getImageSize(), properties.latchedOrientation, orientation );
+	const int32_t rows = columns ? ( slices.size() + columns - 1 ) / columns : 0;
+	m_TileWidth = mappedSize[0];
+	m_TileHeight = mappedSize[1];
+
+	if( !rows || !m_TileWidth || !m_TileHeight ) {
+		return true;
+	}
+
+	const size_t bytesPerVoxel = properties.isRGB ? sizeof( InternalImageColorType ) : sizeof( InternalImageType );
+	//QImage expects 32 bit aligned lines
+	m_BytesPerLine = ( columns * m_TileWidth * bytesPerVoxel + 3 ) & ~static_cast<size_t>( 3 );
+	m_Buffer.assign( m_BytesPerLine * rows * m_TileHeight, 0 );
+
+	m_TileOfSlice.assign( mappedSize[2], -1 );
+
+	for( size_t tile = 0; tile < slices.size(); tile++ ) {
+		if( slices[tile] >= 0 && slices[tile] < mappedSize[2] ) {
+			m_TileOfSlice[slices[tile]] = tile;
+		}
+	}
+
+	if( properties.isRGB ) {
+		extract<InternalImageColorType>( image, numberOfThreads );
+		m_Image = QImage( &m_Buffer[0], columns * m_TileWidth, rows * m_TileHeight, m_BytesPerLine, QImage::Format_RGB888 );
+	} else {
+		extract<InternalImageType>( image, numberOfThreads );
+		m_Image = QImage( &m_Buffer[0], columns * m_TileWidth, rows * m_TileHeight, m_BytesPerLine, QImage::Format_Indexed8 );
+	}
+
+	return true;
+}
+
+template<typename TYPE>
+void LightboxMosaic::extract( const ImageHolder::Pointer image, const unsigned short &numberOfThreads )
+{
+	const size_t timestep = image->getImageProperties().timestep;
+	//masks are read from their runs, so they are not expanded for the mosaic
+	const RunLengthVolume::Pointer runs = image->getRunLengthVolume( timestep );
+	ExtractOp<TYPE> op;
+	op.src = runs ? 0 : &image->getVolumeVector()[timestep].voxel<TYPE>( 0 );
+	op.runs = runs.get();
+	op.size = image->getImageSize();
+	op.mapping = m_Mapping;
+	op.tileWidth = m_TileWidth;
+	op.tileHeight = m_TileHeight;
+	op.flipX = m_Flip[0] < 0;
+	op.flipY = m_Flip[1] < 0;
+	op.columns = m_Columns;
+	op.slices = &m_Slices;
+	op.tileOfSlice = &m_TileOfSlice;
+	op.dest = &m_Buffer[0];
+	op.bytesPerLine = m_BytesPerLine;
+	//the threads write to disjoint pixels, since every voxel has its own place in the mosaic
+	parallel::forEachRange( 0, op.size[2], op, numberOfThreads, 8 );
+}
+
+}
+}
+}
@@ -0,0 +1,87 @@
+/****************************************************************
+ *
+ * <Copyright information>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *
+ * LightboxMosaic.hpp
+ *
+ * Description:
+ *
+ *  Created on: Oct 19, 2026
+ ******************************************************************/
+#ifndef VAST_LIGHTBOXMOSAIC_HPP
+#define VAST_LIGHTBOXMOSAIC_HPP
+
+#include <QImage>
+#include "imageholder.hpp"
+
+namespace isis
+{
+namespace viewer
+{
+namespace widget
+{
+
+/**
+ * Holds all tiles of a lightbox for one image in a single QImage, so the whole mosaic is drawn with one drawImage call.
+ * The tiles are extracted from the volume in one sweep in memory order. Planes and rows of the volume that do not
+ * contain a voxel of a shown slice are skipped, so every shown voxel is read exactly once, independent of the
+ * number of tiles and of the axis the slices are cut along.
+ * The mosaic is only extracted again if the content, the timestep or the layout of the tiles changed.
+ */
+class LightboxMosaic
+{
+public:
+	LightboxMosaic();
+
+	/**
+	 * Extracts the slices of image cut along orientation into the mosaic, if this was not already done.
+	 * The mosaic has columns tiles per row, slices holds the slice index of each tile (-1 for an empty tile).
+	 * Returns true if the mosaic was extracted again.
+	 */
+	bool update( const ImageHolder::Pointer image, const PlaneOrientation &orientation, const unsigned short &columns, const std::vector<int32_t> &slices, const unsigned short &numberOfThreads );
+
+	///the mosaic, Format_Indexed8 without a color table for scalar images and Format_RGB888 for rgb images
+	QImage &getImage() { return m_Image; }
+	int32_t getTileWidth() const { return m_TileWidth; }
+	int32_t getTileHeight() const { return m_TileHeight; }
+
+private:
+	template<typename TYPE> void extract( const ImageHolder::Pointer image, const unsigned short &numberOfThreads );
+
+	std::vector<uint8_t> m_Buffer;
+	QImage m_Image;
+	int32_t m_TileWidth;
+	int32_t m_TileHeight;
+	size_t m_BytesPerLine;
+	//tile index of each slice along the slice axis, -1 if the slice is not shown
+	std::vector<int32_t> m_TileOfSlice;
+
+	//what the mosaic was extracted for
+	size_t m_ContentRevision;
+	size_t m_Timestep;
+	util::ivector4 m_Mapping;
+	util::ivector4 m_Flip;
+	unsigned short m_Columns;
+	std::vector<int32_t> m_Slices;
+};
+
+}
+}
+}
+
+#endif // VAST_LIGHTBOXMOSAIC_HPP
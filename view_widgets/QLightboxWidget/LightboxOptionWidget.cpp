@@ -0,0 +1,60 @@
+/****************************************************************
+ *
+ * <Copyright information>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *
+ * LightboxOptionWidget.cpp
+ *
+ * Description:
+ *
+ *  Created on: Oct 19, 2026
+ ******************************************************************/
+#include "LightboxOptionWidget.hpp"
+#include "LightboxWidget.hpp"
+
+namespace isis
+{
+namespace viewer
+{
+namespace widget
+{
+
+LightboxOptionWidget::LightboxOptionWidget ( QWidget *parent )
+	: QWidget ( parent ),
+	  m_Widget( 0 )
+{
+	m_Interface.setupUi( this );
+	m_Interface.orientation->addItem( "Axial" );
+	m_Interface.orientation->addItem( "Sagittal" );
+	m_Interface.orientation->addItem( "Coronal" );
+}
+
+void LightboxOptionWidget::setWidget ( LightboxWidget *widget )
+{
+	m_Widget = widget;
+	m_Interface.rows->setValue( m_Widget->getRows() );
+	m_Interface.columns->setValue( m_Widget->getColumns() );
+	m_Interface.sliceStep->setValue( m_Widget->getSliceStep() );
+	connect( m_Interface.orientation, SIGNAL( activated( int ) ), m_Widget, SLOT( setSliceOrientation( int ) ) );
+	connect( m_Interface.rows, SIGNAL( valueChanged( int ) ), m_Widget, SLOT( setRows( int ) ) );
+	connect( m_Interface.columns, SIGNAL( valueChanged( int ) ), m_Widget, SLOT( setColumns( int ) ) );
+	connect( m_Interface.sliceStep, SIGNAL( valueChanged( int ) ), m_Widget, SLOT( setSliceStep( int ) ) );
+}
+
+}
+}
+} // end namespace
@@ -0,0 +1,58 @@
+/****************************************************************
+ *
+ * <Copyright information>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *
+ * LightboxOptionWidget.hpp
+ *
+ * Description:
+ *
+ *  Created on: Oct 19, 2026
+ ******************************************************************/
+#ifndef VAST_LIGHTBOXOPTIONWIDGET_HPP
+#define VAST_LIGHTBOXOPTIONWIDGET_HPP
+
+#include "ui_lightbox_option_widget.h"
+#include "qviewercore.hpp"
+
+namespace isis
+{
+namespace viewer
+{
+namespace widget
+{
+
+class LightboxWidget;
+
+class LightboxOptionWidget : public QWidget
+{
+	Q_OBJECT
+public:
+	LightboxOptionWidget( QWidget *parent = 0 );
+	void setWidget( LightboxWidget * );
+
+private:
+	Ui::lightboxOptionWidget m_Interface;
+	LightboxWidget *m_Widget;
+
+};
+
+}
+}
+} // end namespace
+
+#endif // VAST_LIGHTBOXOPTIONWIDGET_HPP
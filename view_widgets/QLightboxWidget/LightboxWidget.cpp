@@ -0,0 +1,491 @@
+/****************************************************************
+ *
+ * <Copyright information>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *
+ * LightboxWidget.cpp
+ *
+ * Description:
+ *
+ *  Created on: Oct 19, 2026
+ ******************************************************************/
+#include "LightboxWidget.hpp"
+#include "LightboxOptionWidget.hpp"
+#include "parallel.hpp"
+
+namespace isis
+{
+namespace viewer
+{
+namespace widget
+{
+
+LightboxWidget::LightboxWidget()
+	: QWidget(),
+	  m_Layout( 0 ),
+	  m_Rows( 6 ),
+	  m_Columns( 8 ),
+	  m_SliceStep( 0 ),
+	  m_FirstSlice( 0 ),
+	  m_CrosshairColor( 255, 102, 0 ),
+	  m_CrosshairWidth( 1 ),
+	  m_InterpolationType( nn ),
+	  m_ShowLabels( false ),
+	  m_ShowCrosshair( true ),
+	  m_LeftMouseButtonPressed( false ),
+	  m_RightMouseButtonPressed( false )
+{
+}
+
+void LightboxWidget::setup( QViewerCore *core, QWidget *parent, PlaneOrientation )
+{
+	//the ensemble only has one entity, so it does not get an orientation. The tiles are axial slices until the option widget changes it.
+	WidgetInterface::setup( core, parent, axial );
+	setParent( parent );
+	m_Layout = new QVBoxLayout( parent );
+	m_Layout->addWidget( this );
+	m_Layout->setMargin( 0 );
+	setAutoFillBackground( true );
+	setPalette( QPalette( Qt::black ) );
+	setFocus();
+
+	LightboxOptionWidget *optionWidget = dynamic_cast<LightboxOptionWidget *>( getWidgetEnsemble()->getOptionWidget() );
+
+	if( optionWidget ) {
+		optionWidget->setWidget( this );
+	}
+}
+
+void LightboxWidget::disconnectSignals()
+{
+	disconnect( m_ViewerCore, SIGNAL( emitUpdateScene( ) ), this, SLOT( updateScene( ) ) );
+	disconnect( m_ViewerCore, SIGNAL( emitPhysicalCoordsChanged( util::fvector3 ) ), this, SLOT( lookAtPhysicalCoords( util::fvector3 ) ) );
+	disconnect( m_ViewerCore, SIGNAL( emitShowLabels( bool ) ), this, SLOT( setShowLabels( bool ) ) );
+	disconnect( m_ViewerCore, SIGNAL( emitSetEnableCrosshair( bool ) ), this, SLOT( setEnableCrosshair( bool ) ) );
+	m_ViewerCore->emitImageContentChanged.disconnect( boost::bind( &LightboxWidget::updateScene, this ) );
+}
+
+void LightboxWidget::connectSignals()
+{
+	connect( m_ViewerCore, SIGNAL( emitUpdateScene( ) ), this, SLOT( updateScene( ) ) );
+	connect( m_ViewerCore, SIGNAL( emitPhysicalCoordsChanged( util::fvector3 ) ), this, SLOT( lookAtPhysicalCoords( util::fvector3 ) ) );
+	connect( m_ViewerCore, SIGNAL( emitShowLabels( bool ) ), this, SLOT( setShowLabels( bool ) ) );
+	connect( m_ViewerCore, SIGNAL( emitSetEnableCrosshair( bool ) ), this, SLOT( setEnableCrosshair( bool ) ) );
+	m_ViewerCore->emitImageContentChanged.connect( boost::bind( &LightboxWidget::updateScene, this ) );
+}
+
+void LightboxWidget::setMouseCursorIcon( QIcon icon )
+{
+	if( !icon.isNull() )  {
+		setCursor( QCursor( icon.pixmap( 45, 45 ) ) );
+	} else {
+		setCursor( Qt::ArrowCursor );
+	}
+}
+
+void LightboxWidget::addImage( const boost::shared_ptr< ImageHolder > image )
+{
+	m_Mosaics[image] = LightboxMosaic();
+	setFocus();
+}
+
+bool LightboxWidget::removeImage( const boost::shared_ptr< ImageHolder > image )
+{
+	return m_Mosaics.erase( image ) > 0;
+}
+
+void LightboxWidget::setSliceOrientation( int orientation )
+{
+	switch( orientation ) {
+	case 1:
+		m_PlaneOrientation = sagittal;
+		break;
+	case 2:
+		m_PlaneOrientation = coronal;
+		break;
+	default:
+		m_PlaneOrientation = axial;
+		break;
+	}
+
+	m_FirstSlice = 0;
+	update();
+}
+
+void LightboxWidget::setRows( int rows )
+{
+	m_Rows = rows > 0 ? rows : 1;
+	update();
+}
+
+void LightboxWidget::setColumns( int columns )
+{
+	m_Columns = columns > 0 ? columns : 1;
+	update();
+}
+
+void LightboxWidget::setSliceStep( int step )
+{
+	m_SliceStep = step > 0 ? step : 0;
+	update();
+}
+
+boost::shared_ptr< ImageHolder > LightboxWidget::getWidgetSpecCurrentImage() const
+{
+	if( std::find( getWidgetEnsemble()->getImageVector().begin(), getWidgetEnsemble()->getImageVector().end(), m_ViewerCore->getCurrentImage() ) != getWidgetEnsemble()->getImageVector().end() ) {
+		return m_ViewerCore->getCurrentImage();
+	}
+
+	return getWidgetEnsemble()->getImageVector().front();
+}
+
+std::vector< int32_t > LightboxWidget::getReferenceSlices( const boost::shared_ptr< ImageHolder > image ) const
+{
+	const int32_t numberOfSlices = mapCoordsToOrientation( image->getImageSize(), image->getImageProperties().latchedOrientation, m_PlaneOrientation )[2];
+	const int32_t numberOfTiles = m_Rows * m_Columns;
+	std::vector<int32_t> slices( numberOfTiles, -1 );
+
+	if( m_SliceStep ) {
+		for( int32_t tile = 0; tile < numberOfTiles; tile++ ) {
+			const int32_t slice = m_FirstSlice + tile * m_SliceStep;
+			slices[tile] = slice < numberOfSlices ? slice : -1;
+		}
+	} else {
+		//spread the tiles evenly, every slice is shown at most once
+		const int32_t usedTiles = std::min( numberOfTiles, numberOfSlices );
+
+		for( int32_t tile = 0; tile < usedTiles; tile++ ) {
+			slices[tile] = ( 2 * tile + 1 ) * numberOfSlices / ( 2 * usedTiles );
+		}
+	}
+
+	return slices;
+}
+
+std::vector< int32_t > LightboxWidget::getSlices( const boost::shared_ptr< ImageHolder > image, const boost::shared_ptr< ImageHolder > reference, const std::vector< int32_t > &referenceSlices ) const
+{
+	if( image.get() == reference.get() ) {
+		return referenceSlices;
+	}
+
+	//axis of the volume that is cut by the tiles
+	const int32_t referenceAxis = mapCoordsToOrientation( util::ivector4( 0, 1, 2, 3 ), reference->getImageProperties().latchedOrientation, m_PlaneOrientation, false )[2];
+	const int32_t axis = mapCoordsToOrientation( util::ivector4( 0, 1, 2, 3 ), image->getImageProperties().latchedOrientation, m_PlaneOrientation, false )[2];
+	std::vector<int32_t> slices( referenceSlices.size(), -1 );
+	util::ivector4 referenceCoords = reference->getImageProperties().voxelCoords;
+
+	for( size_t tile = 0; tile < referenceSlices.size(); tile++ ) {
+		if( referenceSlices[tile] >= 0 ) {
+			referenceCoords[referenceAxis] = referenceSlices[tile];
+			const util::ivector4 coords = image->getISISImage()->getIndexFromPhysicalCoords( reference->getISISImage()->getPhysicalCoordsFromIndex( referenceCoords ) );
+
+			if( coords[axis] >= 0 && coords[axis] < static_cast<int32_t>( image->getImageSize()[axis] ) ) {
+				slices[tile] = coords[axis];
+			}
+		}
+	}
+
+	return slices;
+}
+
+LightboxWidget::Geometry LightboxWidget::getGeometry( const boost::shared_ptr< ImageHolder > image ) const
+{
+	const util::ivector4 size = image->getImageSize();
+	const util::fvector3 mappedSize = mapCoordsToOrientation( util::fvector3( size[0], size[1], size[2] ), image->getImageProperties().latchedOrientation, m_PlaneOrientation );
+	const util::fvector3 mappedScaling = mapCoordsToOrientation( image->getImageProperties().voxelSize, image->getImageProperties().latchedOrientation, m_PlaneOrientation );
+	const float physWidth = m_Columns * mappedSize[0] * mappedScaling[0];
+	const float physHeight = m_Rows * mappedSize[1] * mappedScaling[1];
+	const float scaleW = width() / physWidth;
+	const float scaleH = height() / physHeight;
+	const float scale = scaleH < scaleW ? scaleH : scaleW;
+
+	Geometry geometry;
+	geometry.tileWidth = mappedSize[0];
+	geometry.tileHeight = mappedSize[1];
+	geometry.scaleX = mappedScaling[0] * scale;
+	geometry.scaleY = mappedScaling[1] * scale;
+	geometry.offsetX = ( width() - m_Columns * mappedSize[0] * geometry.scaleX ) / 2;
+	geometry.offsetY = ( height() - m_Rows * mappedSize[1] * geometry.scaleY ) / 2;
+	return geometry;
+}
+
+void LightboxWidget::paintEvent( QPaintEvent */*event*/ )
+{
+	if( getWidgetEnsemble()->getImageVector().empty() ) {
+		return;
+	}
+
+	const boost::shared_ptr<ImageHolder> cImage = getWidgetSpecCurrentImage();
+	const std::vector<int32_t> referenceSlices = getReferenceSlices( cImage );
+
+	//the current image is painted on top of the images of its type, statistical images on top of the structural ones
+	ImageHolder::Vector paintOrder;
+
+	if( m_ViewerCore->getMode() == ViewerCoreBase::statistical_mode ) {
+		const ImageHolder::ImageType types[2] = { ImageHolder::structural_image, ImageHolder::statistical_image };
+
+		for( unsigned short i = 0; i < 2; i++ ) {
+			BOOST_FOREACH( ImageHolder::Vector::const_reference image, getWidgetEnsemble()->getImageVector() ) {
+				if( image.get() != cImage.get() && image->getImageProperties().imageType == types[i] ) {
+					paintOrder.push_back( image );
+				}
+			}
+
+			if( cImage->getImageProperties().imageType == types[i] ) {
+				paintOrder.push_back( cImage );
+			}
+		}
+	} else {
+		BOOST_FOREACH( ImageHolder::Vector::const_reference image, getWidgetEnsemble()->getImageVector() ) {
+			if( image.get() != cImage.get() ) {
+				paintOrder.push_back( image );
+			}
+		}
+		paintOrder.push_back( cImage );
+	}
+
+	m_Painter.begin( this );
+	m_Painter.setRenderHint( QPainter::SmoothPixmapTransform, m_InterpolationType == lin );
+
+	BOOST_FOREACH( ImageHolder::Vector::const_reference image, paintOrder ) {
+		if( image->getImageProperties().isVisible ) {
+			paintMosaic( image, getSlices( image, cImage, referenceSlices ) );
+		}
+	}
+
+	m_Painter.resetTransform();
+	m_Painter.setOpacity( 1.0 );
+
+	if( m_ShowCrosshair ) {
+		paintCurrentTile( referenceSlices );
+	}
+
+	if( m_ShowLabels ) {
+		paintSliceLabels( referenceSlices );
+	}
+
+	m_Painter.end();
+}
+
+void LightboxWidget::paintMosaic( const boost::shared_ptr< ImageHolder > image, const std::vector< int32_t > &slices )
+{
+	LightboxMosaic &mosaic = m_Mosaics[image];
+	mosaic.update( image, m_PlaneOrientation, m_Columns, slices, parallel::getNumberOfThreads( *m_ViewerCore->getSettings() ) );
+	QImage &qImage = mosaic.getImage();
+
+	if( qImage.isNull() ) {
+		return;
+	}
+
+	if( !image->getImageProperties().isRGB ) {
+		qImage.setColorTable( image->getImageProperties().colorMap );
+	}
+
+	const Geometry geometry = getGeometry( image );
+	m_Painter.setTransform( QTransform().translate( geometry.offsetX, geometry.offsetY ).scale( geometry.scaleX, geometry.scaleY ) );
+	m_Painter.setOpacity( image->getImageProperties().opacity );
+	m_Painter.drawImage( 0, 0, qImage );
+}
+
+void LightboxWidget::paintCurrentTile( const std::vector< int32_t > &referenceSlices )
+{
+	const boost::shared_ptr<ImageHolder> image = getWidgetSpecCurrentImage();
+	const util::ivector4 mappedCoords = mapCoordsToOrientation( image->getImageProperties().voxelCoords, image->getImageProperties().latchedOrientation, m_PlaneOrientation );
+	const std::vector<int32_t>::const_iterator iter = std::find( referenceSlices.begin(), referenceSlices.end(), mappedCoords[2] );
+
+	if( iter == referenceSlices.end() ) {
+		return;
+	}
+
+	const int32_t tile = iter - referenceSlices.begin();
+	const Geometry geometry = getGeometry( image );
+	const util::fvector4 flipVec = mapCoordsToOrientation( util::fvector4( 1, 1, 1 ), image->getImageProperties().latchedOrientation, m_PlaneOrientation, false, false );
+	const float tileX = ( tile % m_Columns ) * geometry.tileWidth;
+	const float tileY = ( tile / m_Columns ) * geometry.tileHeight;
+	const float voxelX = flipVec[0] < 0 ? geometry.tileWidth - 1 - mappedCoords[0] : mappedCoords[0];
+	const float voxelY = flipVec[1] < 0 ? geometry.tileHeight - 1 - mappedCoords[1] : mappedCoords[1];
+
+	const QRectF tileRect( geometry.offsetX + tileX * geometry.scaleX, geometry.offsetY + tileY * geometry.scaleY,
+						   geometry.tileWidth * geometry.scaleX, geometry.tileHeight * geometry.scaleY );
+	const QPointF center( geometry.offsetX + ( tileX + voxelX + 0.5 ) * geometry.scaleX,
+						  geometry.offsetY + ( tileY + voxelY + 0.5 ) * geometry.scaleY );
+
+	QPen pen;
+	pen.setColor( m_CrosshairColor );
+	pen.setWidth( m_CrosshairWidth );
+	m_Painter.setPen( pen );
+	m_Painter.drawRect( tileRect );
+	m_Painter.drawLine( QPointF( tileRect.left(), center.y() ), QPointF( center.x() - 5, center.y() ) );
+	m_Painter.drawLine( QPointF( center.x() + 5, center.y() ), QPointF( tileRect.right(), center.y() ) );
+	m_Painter.drawLine( QPointF( center.x(), tileRect.top() ), QPointF( center.x(), center.y() - 5 ) );
+	m_Painter.drawLine( QPointF( center.x(), center.y() + 5 ), QPointF( center.x(), tileRect.bottom() ) );
+}
+
+void LightboxWidget::paintSliceLabels( const std::vector< int32_t > &referenceSlices )
+{
+	const Geometry geometry = getGeometry( getWidgetSpecCurrentImage() );
+	m_Painter.setFont( QFont( "Chicago", 10 ) );
+	m_Painter.setPen( QColor( 255, 255, 255 ) );
+
+	for( size_t tile = 0; tile < referenceSlices.size(); tile++ ) {
+		if( referenceSlices[tile] >= 0 ) {
+			const float x = geometry.offsetX + ( tile % m_Columns ) * geometry.tileWidth * geometry.scaleX;
+			const float y = geometry.offsetY + ( tile / m_Columns ) * geometry.tileHeight * geometry.scaleY;
+			m_Painter.drawText( QPointF( x + 3, y + 12 ), QString::number( referenceSlices[tile] ) );
+		}
+	}
+}
+
+bool LightboxWidget::mouseCoords2PhysCoords( const int &x, const int &y, util::fvector3 &physicalCoords ) const
+{
+	const boost::shared_ptr<ImageHolder> image = getWidgetSpecCurrentImage();
+	const Geometry geometry = getGeometry( image );
+	const float mosaicX = ( x - geometry.offsetX ) / geometry.scaleX;
+	const float mosaicY = ( y - geometry.offsetY ) / geometry.scaleY;
+
+	if( mosaicX < 0 || mosaicY < 0 ) {
+		return false;
+	}
+
+	const int32_t column = mosaicX / geometry.tileWidth;
+	const int32_t row = mosaicY / geometry.tileHeight;
+
+	if( column >= m_Columns || row >= m_Rows ) {
+		return false;
+	}
+
+	const int32_t slice = getReferenceSlices( image )[row * m_Columns + column];
+
+	if( slice < 0 ) {
+		return false;
+	}
+
+	const util::fvector4 flipVec = mapCoordsToOrientation( util::fvector4( 1, 1, 1 ), image->getImageProperties().latchedOrientation, m_PlaneOrientation, false, false );
+	util::ivector4 coords( static_cast<int32_t>( mosaicX ) - column * geometry.tileWidth, static_cast<int32_t>( mosaicY ) - row * geometry.tileHeight, slice );
+	coords[0] = flipVec[0] < 0 ? geometry.tileWidth - 1 - coords[0] : coords[0];
+	coords[1] = flipVec[1] < 0 ? geometry.tileHeight - 1 - coords[1] : coords[1];
+	coords[3] = image->getImageProperties().voxelCoords[3];
+	physicalCoords = image->getISISImage()->getPhysicalCoordsFromIndex( mapCoordsToOrientation( coords, image->getImageProperties().latchedOrientation, m_PlaneOrientation, true ) );
+	return true;
+}
+
+void LightboxWidget::mousePressEvent( QMouseEvent *e )
+{
+	if( e->button() == Qt::RightButton ) {
+		m_RightMouseButtonPressed = true;
+	} else if ( e->button() == Qt::LeftButton ) {
+		m_LeftMouseButtonPressed = true;
+	}
+
+	if( m_ViewerCore->getMode() == ViewerCoreBase::statistical_mode ) {
+		BOOST_FOREACH( ImageHolder::Vector::const_reference image, getWidgetEnsemble()->getImageVector() ) {
+			if( image->getImageProperties().imageType == ImageHolder::statistical_image ) {
+				m_ViewerCore->setCurrentImage( image );
+			}
+		}
+	}
+
+	setFocus();
+	util::fvector3 physicalCoords;
+
+	if( mouseCoords2PhysCoords( e->x(), e->y(), physicalCoords ) ) {
+		m_ViewerCore->onWidgetClicked( this, physicalCoords, e->button() );
+	}
+}
+
+void LightboxWidget::mouseMoveEvent( QMouseEvent *e )
+{
+	util::fvector3 physicalCoords;
+
+	if( ( m_LeftMouseButtonPressed || m_RightMouseButtonPressed ) && mouseCoords2PhysCoords( e->x(), e->y(), physicalCoords ) ) {
+		m_ViewerCore->onWidgetMoved( this, physicalCoords, m_LeftMouseButtonPressed ? Qt::LeftButton : Qt::RightButton );
+	}
+}
+
+void LightboxWidget::mouseReleaseEvent( QMouseEvent *e )
+{
+	if( e->button() == Qt::RightButton ) {
+		m_RightMouseButtonPressed = false;
+	}
+
+	if ( e->button() == Qt::LeftButton ) {
+		m_LeftMouseButtonPressed = false;
+	}
+
+	QWidget::mouseReleaseEvent( e );
+}
+
+void LightboxWidget::wheelEvent( QWheelEvent *e )
+{
+	if( getWidgetEnsemble()->getImageVector().empty() ) {
+		return;
+	}
+
+	const boost::shared_ptr<ImageHolder> image = getWidgetSpecCurrentImage();
+	const int32_t direction = e->delta() < 0 ? 1 : -1;
+
+	if( m_SliceStep ) {
+		//scroll by one row of tiles
+		const int32_t numberOfSlices = mapCoordsToOrientation( image->getImageSize(), image->getImageProperties().latchedOrientation, m_PlaneOrientation )[2];
+		const int32_t firstSlice = m_FirstSlice + direction * m_SliceStep * m_Columns;
+		m_FirstSlice = firstSlice < 0 ? 0 : firstSlice >= numberOfSlices ? m_FirstSlice : firstSlice;
+		update();
+	} else {
+		//move the current position to the next slice
+		const int32_t axis = mapCoordsToOrientation( util::ivector4( 0, 1, 2, 3 ), image->getImageProperties().latchedOrientation, m_PlaneOrientation, false )[2];
+		util::ivector4 coords = image->getImageProperties().voxelCoords;
+		coords[axis] += direction;
+
+		if( image->checkVoxelCoords( coords ) ) {
+			m_ViewerCore->physicalCoordsChanged( image->getISISImage()->getPhysicalCoordsFromIndex( coords ) );
+		}
+	}
+}
+
+void LightboxWidget::lookAtPhysicalCoords( const util::fvector3 &/*physicalCoords*/ )
+{
+	update();
+}
+
+void LightboxWidget::updateScene()
+{
+	update();
+}
+
+}
+}
+} //end namespace
+
+const QWidget *loadOptionWidget()
+{
+	return new isis::viewer::widget::LightboxOptionWidget();
+}
+
+isis::viewer::widget::WidgetInterface *loadWidget()
+{
+	return new isis::viewer::widget::LightboxWidget();
+}
+
+const isis::util::PropertyMap *getProperties()
+{
+	isis::util::PropertyMap *properties = new isis::util::PropertyMap();
+	properties->setPropertyAs<std::string>( "widgetIdent", "qt4_lightbox_widget" );
+	properties->setPropertyAs<std::string>( "widgetName", "Lightbox widget" );
+	properties->setPropertyAs<uint8_t>( "numberOfEntitiesInEnsemble", 1 );
+	properties->setPropertyAs<bool>( "hasOptionWidget", true );
+	return properties;
+}
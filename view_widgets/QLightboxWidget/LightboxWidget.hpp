@@ -0,0 +1,149 @@
+/****************************************************************
+ *
+ * <Copyright information>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *
+ * LightboxWidget.hpp
+ *
+ * Description:
+ *
+ *  Created on: Oct 19, 2026
+ ******************************************************************/
+#ifndef VAST_LIGHTBOXWIDGET_HPP
+#define VAST_LIGHTBOXWIDGET_HPP
+
+#include <QWidget>
+#include <QPainter>
+#include <QtGui>
+#include "widgetinterface.h"
+#include "qviewercore.hpp"
+#include "LightboxMosaic.hpp"
+
+namespace isis
+{
+namespace viewer
+{
+namespace widget
+{
+
+/**
+ * Shows a grid of rows x columns slices cut along one axis (lightbox or mosaic view).
+ * Without a slice step the slices are spread evenly over the whole volume, otherwise the tiles
+ * show every step-th slice and the mouse wheel scrolls through the volume row by row.
+ * All tiles of an image are kept in one LightboxMosaic, so redrawing costs one drawImage per image,
+ * independent of the number of tiles.
+ */
+class LightboxWidget : public QWidget, public WidgetInterface
+{
+	Q_OBJECT
+	typedef std::map<boost::shared_ptr<ImageHolder>, LightboxMosaic> MosaicMapType;
+
+	///placement of the tiles of an image in the widget
+	struct Geometry {
+		float offsetX;
+		float offsetY;
+		float scaleX;
+		float scaleY;
+		int32_t tileWidth;
+		int32_t tileHeight;
+	};
+
+public:
+	LightboxWidget();
+
+public Q_SLOTS:
+	virtual bool hasOptionWidget() const { return true; };
+	virtual unsigned short getNumberOfInstancesInEnsemble() const { return 1; }
+	virtual void setEnableCrosshair( bool enable ) { m_ShowCrosshair = enable; update(); }
+
+	virtual void disconnectSignals();
+	virtual void connectSignals();
+
+	virtual void setup( QViewerCore *, QWidget *, PlaneOrientation );
+	virtual void setZoom( float ) {}
+	virtual void addImage( const boost::shared_ptr<ImageHolder> image );
+	virtual bool removeImage( const boost::shared_ptr<ImageHolder> image );
+
+	virtual void lookAtPhysicalCoords( const util::fvector3 &physicalCoords );
+	virtual void updateScene();
+	virtual void setInterpolationType( InterpolationType interType ) { m_InterpolationType = interType; update(); }
+	virtual void setShowLabels( bool show ) { m_ShowLabels = show; update(); }
+	virtual void setMouseCursorIcon( QIcon icon );
+	virtual void setCrossHairColor( QColor color ) { m_CrosshairColor = color; }
+	virtual void setCrossHairWidth( int width ) { m_CrosshairWidth = width; }
+
+	///0 = axial, 1 = sagittal, 2 = coronal
+	void setSliceOrientation( int orientation );
+	void setRows( int rows );
+	void setColumns( int columns );
+	///distance of the slices in voxels, 0 spreads the slices over the whole volume
+	void setSliceStep( int step );
+
+	unsigned short getRows() const { return m_Rows; }
+	unsigned short getColumns() const { return m_Columns; }
+	unsigned short getSliceStep() const { return m_SliceStep; }
+
+	virtual std::string getWidgetIdent() const { return std::string( "qt4_lightbox_widget" ); }
+	virtual std::string getWidgetName() const { return std::string( "Lightbox widget" ); }
+
+protected:
+	void paintEvent( QPaintEvent *event );
+
+	virtual void wheelEvent( QWheelEvent *e );
+	virtual void mousePressEvent( QMouseEvent *e );
+	virtual void mouseReleaseEvent( QMouseEvent *e );
+	virtual void mouseMoveEvent( QMouseEvent *e );
+
+private:
+	boost::shared_ptr<ImageHolder> getWidgetSpecCurrentImage() const;
+	///returns the slice of each tile in the current image, -1 for empty tiles
+	std::vector<int32_t> getReferenceSlices( const boost::shared_ptr<ImageHolder> image ) const;
+	///returns the slices of image at the physical positions of the reference slices of the current image
+	std::vector<int32_t> getSlices( const boost::shared_ptr<ImageHolder> image, const boost::shared_ptr<ImageHolder> reference, const std::vector<int32_t> &referenceSlices ) const;
+	Geometry getGeometry( const boost::shared_ptr<ImageHolder> image ) const;
+
+	void paintMosaic( const boost::shared_ptr<ImageHolder> image, const std::vector<int32_t> &slices );
+	void paintCurrentTile( const std::vector<int32_t> &referenceSlices );
+	void paintSliceLabels( const std::vector<int32_t> &referenceSlices );
+
+	///maps the window coordinates to the physical coordinates in the tile below, returns false if there is no tile
+	bool mouseCoords2PhysCoords( const int &x, const int &y, util::fvector3 &physicalCoords ) const;
+
+	QVBoxLayout *m_Layout;
+	QPainter m_Painter;
+	MosaicMapType m_Mosaics;
+
+	unsigned short m_Rows;
+	unsigned short m_Columns;
+	unsigned short m_SliceStep;
+	//slice of the first tile if the slice step is set, scrolled with the mouse wheel
+	int32_t m_FirstSlice;
+
+	QColor m_CrosshairColor;
+	int m_CrosshairWidth;
+	InterpolationType m_InterpolationType;
+	bool m_ShowLabels;
+	bool m_ShowCrosshair;
+	bool m_LeftMouseButtonPressed;
+	bool m_RightMouseButtonPressed;
+};
+
+}
+}
+} //end namespace
+
+#endif // VAST_LIGHTBOXWIDGET_HPP
@@ -45,9 +45,11 @@ vtkImageData *VolumeHandler::getVTKImageData( const ImageHolder::Pointer image,
 	vtkTransform *transform = vtkTransform::New();
 	vtkImageReslice *reslicer = vtkImageReslice::New();
 	vtkMatrix4x4 *orientationMatrix = vtkMatrix4x4::New();
+	//the volume has to live until the reslicer is updated
+	data::Chunk volume = image->getVolume( timestep );
 	transform->Identity();
 	importer->SetDataScalarTypeToUnsignedChar();
-	importer->SetImportVoidPointer( &image->getVolumeVector().operator[]( timestep ).voxel<InternalImageType>( 0 ) );
+	importer->SetImportVoidPointer( &volume.voxel<InternalImageType>( 0 ) );
 	importer->SetWholeExtent( 0, size[0] - 1, 0, size[1] - 1, 0, size[2] - 1 );
 	importer->SetDataExtentToWholeExtent();
 
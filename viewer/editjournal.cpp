@@ -0,0 +1,490 @@
+/****************************************************************
+ *
+ * <Copyright information>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *
+ * editjournal.cpp
+ *
+ * Description:
+ *
+ *  Created on: Oct 19, 2026
+ ******************************************************************/
+#include "editjournal.hpp"
+#include <boost/scoped_array.hpp>
+#include <limits>
+#include <map>
+#include <set>
+
+namespace isis
+{
+namespace viewer
+{
+namespace _internal
+{
+
+class EditBatch
+{
+public:
+	EditBatch( const ImageHolder::Pointer image )
+		: m_Image( image ), m_ImageAddress( image.get() ), m_MinMaxBefore( getMinMax( *image ) ), m_MinMaxAfter( m_MinMaxBefore ) {}
+	virtual ~EditBatch() {}
+
+	virtual void record( ImageHolder &image, const size_t &timestep, const size_t &first, const size_t &last ) = 0;
+	///reads the values after the edit and drops all voxels that did not change
+	virtual void finish( ImageHolder &image ) = 0;
+	///writes the values before (after == false) or after the edit to the image
+	virtual void apply( ImageHolder &image, const bool &after ) const = 0;
+	virtual size_t getSize() const = 0;
+	virtual bool isEmpty() const = 0;
+
+	ImageHolder::Pointer getImage() const { return m_Image.lock(); }
+	const ImageHolder *getImageAddress() const { return m_ImageAddress; }
+
+	std::string description;
+
+protected:
+	static std::pair<double, double> getMinMax( const ImageHolder &image ) {
+		return std::make_pair( image.getImageProperties().minMax.first->as<double>(), image.getImageProperties().minMax.second->as<double>() );
+	}
+
+	///restores the min/max of the image before or after the edit, the content has to be written already
+	void restoreMinMax( ImageHolder &image, const std::vector<size_t> &timesteps, const bool &after ) const {
+		const std::pair<double, double> &minMax = after ? m_MinMaxAfter : m_MinMaxBefore;
+
+		if( getMinMax( image ) != minMax ) {
+			image.refreshVolumes( timesteps, minMax );
+			image.updateColorMap();
+		} else {
+			image.contentChanged();
+		}
+	}
+
+	boost::weak_ptr<ImageHolder> m_Image;
+	const ImageHolder *m_ImageAddress;
+	std::pair<double, double> m_MinMaxBefore;
+	std::pair<double, double> m_MinMaxAfter;
+};
+
+template<typename TYPE>
+class TypedEditBatch : public EditBatch
+{
+public:
+	TypedEditBatch( const ImageHolder::Pointer image ) : EditBatch( image ) {}
+
+	void record( ImageHolder &image, const size_t &timestep, const size_t &first, const size_t &last ) {
+		//find the runs that are already covered and merge [first, last) with them
+		CoveredMap::iterator iter = m_Covered.upper_bound( std::make_pair( timestep, first ) );
+
+		if( iter != m_Covered.begin() ) {
+			CoveredMap::iterator previous = iter;
+			--previous;
+
+			if( previous->first.first == timestep && previous->second >= first ) {
+				iter = previous;
+			}
+		}
+
+		size_t position = first;
+		size_t mergedFirst = first;
+		size_t mergedLast = last;
+
+		while( iter != m_Covered.end() && iter->first.first == timestep && iter->first.second <= last ) {
+			if( iter->first.second > position ) {
+				store( image, timestep, position, iter->first.second );
+			}
+
+			position = std::max( position, iter->second );
+			mergedFirst = std::min( mergedFirst, iter->first.second );
+			mergedLast = std::max( mergedLast, iter->second );
+			m_Covered.erase( iter++ );
+		}
+
+		if( position < last ) {
+			store( image, timestep, position, last );
+		}
+
+		m_Covered[std::make_pair( timestep, mergedFirst )] = mergedLast;
+	}
+
+	void finish( ImageHolder &image ) {
+		std::vector<Run> runs;
+		RLE before, after;
+		Decoder decoder( m_Before );
+		Buffer buffer;
+		BOOST_FOREACH( typename std::vector<Run>::const_reference run, m_Runs ) {
+			const size_t length = run.last - run.first;
+			TYPE *values = buffer.get( length );
+			ReadOp readOp = { values };
+			forEachRun( getSegments( image, run.timestep ), run.first, run.last, readOp );
+
+			for( size_t i = 0; i < length; i++ ) {
+				const TYPE value = decoder.next();
+
+				if( !( value == values[i] ) ) {
+					const size_t index = run.first + i;
+
+					if( runs.empty() || runs.back().timestep != run.timestep || runs.back().last != index ) {
+						const Run changed = { run.timestep, index, index };
+						runs.push_back( changed );
+					}
+
+					runs.back().last++;
+					append( before, value );
+					append( after, values[i] );
+				}
+			}
+		}
+		//swapping releases the memory of the recorded but unchanged voxels
+		std::vector<Run>( runs ).swap( m_Runs );
+		RLE( before ).swap( m_Before );
+		RLE( after ).swap( m_After );
+		m_Covered.clear();
+		m_Segments.clear();
+		m_MinMaxAfter = getMinMax( image );
+	}
+
+	void apply( ImageHolder &image, const bool &after ) const {
+		Decoder decoder( after ? m_After : m_Before );
+		Buffer buffer;
+		std::set<size_t> timesteps;
+		BOOST_FOREACH( typename std::vector<Run>::const_reference run, m_Runs ) {
+			const size_t length = run.last - run.first;
+			TYPE *values = buffer.get( length );
+
+			for( size_t i = 0; i < length; i++ ) {
+				values[i] = decoder.next();
+			}
+
+			image.setTypedVoxels<TYPE>( run.timestep, run.first, run.last, values );
+			timesteps.insert( run.timestep );
+		}
+		restoreMinMax( image, std::vector<size_t>( timesteps.begin(), timesteps.end() ), after );
+	}
+
+	size_t getSize() const {
+		return m_Runs.capacity() * sizeof( Run ) + ( m_Before.capacity() + m_After.capacity() ) * sizeof( typename RLE::value_type )
+			   + m_Covered.size() * ( sizeof( CoveredMap::value_type ) + 4 * sizeof( void * ) );
+	}
+	bool isEmpty() const { return m_Runs.empty(); }
+
+private:
+	struct Run {
+		size_t timestep;
+		size_t first;
+		size_t last;
+	};
+	typedef std::vector< std::pair<TYPE, uint32_t> > RLE;
+	//(timestep, first) -> last of the runs recorded so far, only used until finish()
+	typedef std::map< std::pair<size_t, size_t>, size_t > CoveredMap;
+
+	//a std::vector<bool> can not be used as a plain array, so the values of a run are buffered here
+	class Buffer
+	{
+	public:
+		Buffer() : m_Capacity( 0 ) {}
+		TYPE *get( const size_t &length ) {
+			if( length > m_Capacity ) {
+				m_Values.reset( new TYPE[length] );
+				m_Capacity = length;
+			}
+
+			return m_Values.get();
+		}
+	private:
+		boost::scoped_array<TYPE> m_Values;
+		size_t m_Capacity;
+	};
+
+	struct ReadOp {
+		TYPE *values;
+		void operator()( const TYPE *begin, const size_t &length ) {
+			std::copy( begin, begin + length, values );
+			values += length;
+		}
+	};
+	struct AppendOp {
+		RLE *rle;
+		void operator()( const TYPE *begin, const size_t &length ) {
+			for( const TYPE *value = begin; value < begin + length; value++ ) {
+				append( *rle, *value );
+			}
+		}
+	};
+	struct Decoder {
+		Decoder( const RLE &rle ) : m_Iterator( rle.begin() ), m_Used( 0 ) {}
+		TYPE next() {
+			if( m_Used == m_Iterator->second ) {
+				++m_Iterator;
+				m_Used = 0;
+			}
+
+			m_Used++;
+			return m_Iterator->first;
+		}
+		typename RLE::const_iterator m_Iterator;
+		uint32_t m_Used;
+	};
+
+	static void append( RLE &rle, const TYPE &value ) {
+		if( !rle.empty() && rle.back().first == value && rle.back().second < std::numeric_limits<uint32_t>::max() ) {
+			rle.back().second++;
+		} else {
+			rle.push_back( std::make_pair( value, static_cast<uint32_t>( 1 ) ) );
+		}
+	}
+
+	const std::vector< TypedSegment<TYPE> > &getSegments( const ImageHolder &image, const size_t &timestep ) {
+		typename SegmentMap::iterator iter = m_Segments.find( timestep );
+
+		if( iter == m_Segments.end() ) {
+			iter = m_Segments.insert( std::make_pair( timestep, image.getTypedSegments<TYPE>( timestep ) ) ).first;
+		}
+
+		return iter->second;
+	}
+
+	void store( ImageHolder &image, const size_t &timestep, const size_t &first, const size_t &last ) {
+		AppendOp appendOp = { &m_Before };
+		forEachRun( getSegments( image, timestep ), first, last, appendOp );
+		const Run run = { timestep, first, last };
+		m_Runs.push_back( run );
+	}
+
+	typedef std::map<size_t, std::vector< TypedSegment<TYPE> > > SegmentMap;
+
+	std::vector<Run> m_Runs;
+	RLE m_Before;
+	RLE m_After;
+	CoveredMap m_Covered;
+	SegmentMap m_Segments;
+};
+
+}
+
+EditJournal::EditJournal()
+	: m_MaxSize( 256 * 1024 * 1024 ), m_Size( 0 ), m_Discarded( 0 )
+{}
+
+EditJournal::BatchPointer EditJournal::createBatch ( const ImageHolder::Pointer image ) const
+{
+	switch( image->getImageProperties().majorTypeID ) {
+	case data::ValueArray<bool>::staticID:
+		return BatchPointer( new _internal::TypedEditBatch<bool>( image ) );
+	case data::ValueArray<int8_t>::staticID:
+		return BatchPointer( new _internal::TypedEditBatch<int8_t>( image ) );
+	case data::ValueArray<uint8_t>::staticID:
+		return BatchPointer( new _internal::TypedEditBatch<uint8_t>( image ) );
+	case data::ValueArray<int16_t>::staticID:
+		return BatchPointer( new _internal::TypedEditBatch<int16_t>( image ) );
+	case data::ValueArray<uint16_t>::staticID:
+		return BatchPointer( new _internal::TypedEditBatch<uint16_t>( image ) );
+	case data::ValueArray<int32_t>::staticID:
+		return BatchPointer( new _internal::TypedEditBatch<int32_t>( image ) );
+	case data::ValueArray<uint32_t>::staticID:
+		return BatchPointer( new _internal::TypedEditBatch<uint32_t>( image ) );
+	case data::ValueArray<int64_t>::staticID:
+		return BatchPointer( new _internal::TypedEditBatch<int64_t>( image ) );
+	case data::ValueArray<uint64_t>::staticID:
+		return BatchPointer( new _internal::TypedEditBatch<uint64_t>( image ) );
+	case data::ValueArray<float>::staticID:
+		return BatchPointer( new _internal::TypedEditBatch<float>( image ) );
+	case data::ValueArray<double>::staticID:
+		return BatchPointer( new _internal::TypedEditBatch<double>( image ) );
+	default:
+		LOG( Runtime, warning ) << "Changes to images of type " << image->getImageProperties().majorTypeName << " can not be undone.";
+		return BatchPointer();
+	}
+}
+
+void EditJournal::record ( const ImageHolder::Pointer image, const size_t &timestep, const size_t &first, const size_t &last )
+{
+	record( image, timestep, RunList( 1, std::make_pair( first, last ) ) );
+}
+
+void EditJournal::record ( const ImageHolder::Pointer image, const size_t &timestep, const RunList &runs )
+{
+	//the rest of a discarded batch is not recorded, as it could not be undone anyway
+	if( image.get() == m_Discarded ) {
+		return;
+	}
+
+	if( m_OpenBatch && m_OpenBatch->getImage() != image ) {
+		LOG( Dev, warning ) << "Recording changes of another image. Committing the open batch of the edit journal.";
+		commit( "" );
+	}
+
+	if( !m_OpenBatch ) {
+		m_OpenBatch = createBatch( image );
+
+		if( !m_OpenBatch ) {
+			forget( image.get() );
+			return;
+		}
+	}
+
+	BOOST_FOREACH( RunList::const_reference run, runs ) {
+		m_OpenBatch->record( *image, timestep, run.first, run.second );
+	}
+
+	if( m_OpenBatch->getSize() > m_MaxSize ) {
+		LOG( Runtime, warning ) << "The changes of " << image->getImageProperties().fileName
+								<< " are too large for the edit journal. Its older changes can not be undone anymore.";
+		forget( image.get() );
+		m_Discarded = image.get();
+	}
+}
+
+void EditJournal::commit ( const std::string &description )
+{
+	m_Discarded = 0;
+
+	if( !m_OpenBatch ) {
+		return;
+	}
+
+	const BatchPointer batch = m_OpenBatch;
+	m_OpenBatch.reset();
+	const ImageHolder::Pointer image = batch->getImage();
+
+	if( !image ) {
+		return;
+	}
+
+	batch->finish( *image );
+
+	if( batch->isEmpty() ) {
+		return;
+	}
+
+	batch->description = description;
+	BOOST_FOREACH( std::vector<BatchPointer>::const_reference redoBatch, m_RedoBatches ) {
+		m_Size -= redoBatch->getSize();
+	}
+	m_RedoBatches.clear();
+	m_UndoBatches.push_back( batch );
+	m_Size += batch->getSize();
+	dropOldest();
+}
+
+ImageHolder::Pointer EditJournal::undo()
+{
+	commit( "" );
+
+	while( !m_UndoBatches.empty() ) {
+		const BatchPointer batch = m_UndoBatches.back();
+		m_UndoBatches.pop_back();
+		const ImageHolder::Pointer image = batch->getImage();
+
+		if( image && image->areVoxelsLocked() ) {
+			LOG( Runtime, error ) << "The voxels of " << image->getImageProperties().fileName << " can not be changed while another operation reads them.";
+			m_UndoBatches.push_back( batch );
+			return ImageHolder::Pointer();
+		}
+
+		//the batches of closed images are dropped
+		if( image ) {
+			batch->apply( *image, false );
+			m_RedoBatches.push_back( batch );
+			return image;
+		}
+
+		m_Size -= batch->getSize();
+	}
+
+	return ImageHolder::Pointer();
+}
+
+ImageHolder::Pointer EditJournal::redo()
+{
+	commit( "" );
+
+	while( !m_RedoBatches.empty() ) {
+		const BatchPointer batch = m_RedoBatches.back();
+		m_RedoBatches.pop_back();
+		const ImageHolder::Pointer image = batch->getImage();
+
+		if( image && image->areVoxelsLocked() ) {
+			LOG( Runtime, error ) << "The voxels of " << image->getImageProperties().fileName << " can not be changed while another operation reads them.";
+			m_RedoBatches.push_back( batch );
+			return ImageHolder::Pointer();
+		}
+
+		if( image ) {
+			batch->apply( *image, true );
+			m_UndoBatches.push_back( batch );
+			return image;
+		}
+
+		m_Size -= batch->getSize();
+	}
+
+	return ImageHolder::Pointer();
+}
+
+std::string EditJournal::getUndoDescription() const
+{
+	return m_UndoBatches.empty() ? std::string() : m_UndoBatches.back()->description;
+}
+
+std::string EditJournal::getRedoDescription() const
+{
+	return m_RedoBatches.empty() ? std::string() : m_RedoBatches.back()->description;
+}
+
+void EditJournal::forget ( const ImageHolder *image )
+{
+	std::deque<BatchPointer> undoBatches;
+	BOOST_FOREACH( std::deque<BatchPointer>::const_reference batch, m_UndoBatches ) {
+		if( batch->getImageAddress() == image ) {
+			m_Size -= batch->getSize();
+		} else {
+			undoBatches.push_back( batch );
+		}
+	}
+	m_UndoBatches.swap( undoBatches );
+	std::vector<BatchPointer> redoBatches;
+	BOOST_FOREACH( std::vector<BatchPointer>::const_reference batch, m_RedoBatches ) {
+		if( batch->getImageAddress() == image ) {
+			m_Size -= batch->getSize();
+		} else {
+			redoBatches.push_back( batch );
+		}
+	}
+	m_RedoBatches.swap( redoBatches );
+
+	if( m_OpenBatch && m_OpenBatch->getImageAddress() == image ) {
+		m_OpenBatch.reset();
+	}
+}
+
+void EditJournal::setMaxSize ( const size_t &maxSize )
+{
+	m_MaxSize = maxSize;
+	dropOldest();
+}
+
+void EditJournal::dropOldest()
+{
+	while( m_Size > m_MaxSize && !m_UndoBatches.empty() ) {
+		LOG( Dev, info ) << "Dropping the oldest batch of the edit journal (" << m_UndoBatches.front()->getSize() << " bytes)";
+		m_Size -= m_UndoBatches.front()->getSize();
+		m_UndoBatches.pop_front();
+	}
+}
+
+}
+}
@@ -0,0 +1,106 @@
+/****************************************************************
+ *
+ * <Copyright information>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *
+ * editjournal.hpp
+ *
+ * Description:
+ *
+ *  Created on: Oct 19, 2026
+ ******************************************************************/
+#ifndef VAST_EDITJOURNAL_HPP
+#define VAST_EDITJOURNAL_HPP
+
+#include "imageholder.hpp"
+#include <deque>
+
+namespace isis
+{
+namespace viewer
+{
+namespace _internal
+{
+class EditBatch;
+}
+
+/**
+ * Undo/redo history of in place changes to the voxels of images.
+ * Before voxels are changed their runs are recorded in the open batch, which is closed by commit() once the edit is done.
+ * A batch only keeps the voxels whose value actually changed, run-length compressed before and after the edit,
+ * so its size is proportional to the changed voxels and undo() and redo() only touch these voxels.
+ * The batches are kept in a ring buffer of getMaxSize() bytes, the oldest ones are dropped first.
+ * Get the journal via util::Singletons::get<EditJournal, 10>().
+ */
+class EditJournal
+{
+public:
+	typedef std::vector< std::pair<size_t, size_t> > RunList;
+
+	EditJournal();
+
+	/**
+	 * Stores the current values of the voxels [first, last) (in memory order) of the volume timestep of image in the open batch.
+	 * Has to be called before these voxels are changed. Voxels that were already recorded in the open batch are skipped.
+	 */
+	void record( const ImageHolder::Pointer image, const size_t &timestep, const size_t &first, const size_t &last );
+	///records all runs [first, last) of the volume timestep of image, see record()
+	void record( const ImageHolder::Pointer image, const size_t &timestep, const RunList &runs );
+
+	///closes the open batch, nothing happens if there is none or nothing has changed
+	void commit( const std::string &description );
+
+	/**
+	 * Reverts the last committed batch in both representations of its image and returns the image.
+	 * The caller has to emit emitImageContentChanged for it. Returns an empty pointer if there is nothing to undo.
+	 */
+	ImageHolder::Pointer undo();
+	///applies the last undone batch again, see undo()
+	ImageHolder::Pointer redo();
+
+	bool canUndo() const { return !m_UndoBatches.empty(); }
+	bool canRedo() const { return !m_RedoBatches.empty(); }
+	std::string getUndoDescription() const;
+	std::string getRedoDescription() const;
+
+	///drops all batches of image, e.g. after it was changed without the journal
+	void forget( const ImageHolder *image );
+
+	void setMaxSize( const size_t &maxSize );
+	size_t getMaxSize() const { return m_MaxSize; }
+	///returns the memory used by all batches in bytes
+	size_t getSize() const { return m_Size; }
+
+private:
+	typedef boost::shared_ptr<_internal::EditBatch> BatchPointer;
+
+	BatchPointer createBatch( const ImageHolder::Pointer image ) const;
+	void dropOldest();
+
+	std::deque<BatchPointer> m_UndoBatches;
+	std::vector<BatchPointer> m_RedoBatches;
+	BatchPointer m_OpenBatch;
+	size_t m_MaxSize;
+	size_t m_Size;
+	//image whose open batch was discarded because it got too large
+	const ImageHolder *m_Discarded;
+};
+
+}
+}
+
+#endif // VAST_EDITJOURNAL_HPP
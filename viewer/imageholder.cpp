@@ -29,13 +29,22 @@
 #include "common.hpp"
 #include "memoryhandler.hpp"
 #include "nativeimageops.hpp"
+#include "minmaxpyramid.hpp"
 #include <numeric>
+#include <cmath>
 
 namespace isis
 {
 namespace viewer
 {
 
+namespace
+{
+struct NullDeleter {
+	void operator()( const void * ) const {}
+};
+}
+
 namespace _internal
 {
 void __Image::mapPhysicalToIndex ( const float *physicalCoords, int32_t *index )
@@ -59,17 +68,82 @@ bool __Image::checkVoxel ( const int32_t *coords )
 
 }
 
+void Histogram::initialize ( const double &min, const double &max, const size_t &numberOfBins, const bool &isInteger, const bool &_omitZero )
+{
+	size_t n = std::max<size_t>( 1, numberOfBins );
+	omitZero = _omitZero;
+
+	if( isInteger ) {
+		//every bin holds the same number of integer values, otherwise the bins alternately get more and less values
+		const double numberOfValues = max - min + 1;
+		lowerBound = min - 0.5;
+		binWidth = std::max( 1., std::ceil( numberOfValues / n ) );
+		n = std::max<size_t>( 1, static_cast<size_t>( std::ceil( numberOfValues / binWidth ) ) );
+	} else {
+		lowerBound = min;
+		binWidth = max > min ? ( max - min ) / n : 1;
+	}
+
+	bins.assign( n, 0 );
+}
+
+void Histogram::add ( const std::vector< std::vector< size_t > > &subHistograms, const unsigned short &parts )
+{
+	for( unsigned short t = 0; t < parts; t++ ) {
+		for( size_t i = 0; i < bins.size(); i++ ) {
+			bins[i] += subHistograms[t][i];
+		}
+	}
+}
+
+size_t ImageHolder::s_ContentRevisionCounter = 0;
+boost::mutex ImageHolder::s_ContentRevisionMutex;
+
+size_t ImageHolder::nextContentRevision()
+{
+	boost::mutex::scoped_lock lock( s_ContentRevisionMutex );
+	return ++s_ContentRevisionCounter;
+}
+
 ImageHolder::ImageHolder()
-	:  m_AmbiguousOrientation( false )
+	:  m_AmbiguousOrientation( false ),
+	   m_SharesVolumes( false ),
+	   m_ContentRevision( nextContentRevision() ),
+	   m_VoxelLocks( 0 )
 {}
 
 boost::shared_ptr< const void > ImageHolder::getRawAdress ( size_t timestep ) const
 {
 	if( getImageProperties().isRGB ) {
-		return m_VolumeVector.operator[]( timestep ).getValueArray<InternalImageColorType>().getRawAddress();
+		return getVolume( timestep ).getValueArray<InternalImageColorType>().getRawAddress();
 	} else {
-		return m_VolumeVector.operator[]( timestep ).getValueArray<InternalImageType>().getRawAddress();
+		return getVolume( timestep ).getValueArray<InternalImageType>().getRawAddress();
+	}
+}
+
+data::Chunk ImageHolder::getVolume( const size_t &timestep ) const
+{
+	const RunLengthVolume::Pointer runs = getRunLengthVolume( timestep );
+
+	if( !runs ) {
+		return m_VolumeVector[timestep];
 	}
+
+	data::MemChunk<InternalImageType> volume( m_ImageSize[0], m_ImageSize[1], m_ImageSize[2] );
+	runs->expand( &volume.voxel<InternalImageType>( 0, 0, 0 ) );
+	return volume;
+}
+
+RunLengthVolume::Pointer ImageHolder::getRunLengthVolume( const size_t &timestep ) const
+{
+	boost::mutex::scoped_lock lock( m_VolumesMutex );
+	return m_RunLengthVolumes.empty() ? RunLengthVolume::Pointer() : m_RunLengthVolumes[timestep];
+}
+
+bool ImageHolder::isRunLengthEncoded() const
+{
+	boost::mutex::scoped_lock lock( m_VolumesMutex );
+	return !m_RunLengthVolumes.empty();
 }
 
 util::Matrix3x3<float> ImageHolder::calculateImageOrientation( bool transposed ) const
@@ -176,7 +250,7 @@ void ImageHolder::collectImageInfo()
 	getImageProperties().minMax = getISISImage()->getMinMax();
 	getImageProperties().majorTypeID = getMajorTypeID();
 	getImageProperties().isRGB = ( data::ValueArray<util::color24>::staticID == getImageProperties().majorTypeID || data::ValueArray<util::color48>::staticID == getImageProperties().majorTypeID );
-	getImageProperties().zeroIsReserved = getImageProperties().zeroIsReserved || (
+	getImageProperties().zeroIsReserved = getImageProperties().zeroIsReserved || ( m_IngestOptions.trueZero && !getImageProperties().isRGB ) || (
 			getImageProperties().imageType == statistical_image && getImageProperties().minMax.first->as<double>() < 0 && !getImageProperties().isRGB );
 
 	if( !getImageProperties().isRGB ) {
@@ -196,7 +270,7 @@ boost::shared_ptr< _internal::__Image > ImageHolder::getISISImage() const
 }
 
 
-bool ImageHolder::setImage( const data::Image &image, const ImageType &_imageType, const std::string &filename )
+bool ImageHolder::setImage( const data::Image &image, const ImageType &_imageType, const std::string &filename, const IngestOptions &ingestOptions )
 {
 	LOG( Dev, info ) << "setImage of " << filename;
 
@@ -210,6 +284,7 @@ bool ImageHolder::setImage( const data::Image &image, const ImageType &_imageTyp
 	m_Image.reset( new _internal::__Image( image ) );
 	getImageProperties().filePath = filename;
 	getImageProperties().zeroIsReserved = false;
+	m_IngestOptions = ingestOptions;
 	boost::filesystem::path p( filename );
 	getImageProperties().fileName = p.filename();
 	// get some image information
@@ -223,15 +298,16 @@ bool ImageHolder::setImage( const data::Image &image, const ImageType &_imageTyp
 	//copy the image into continuous memory space and assure consistent data type
 	synchronize( );
 
-	LOG_IF( m_VolumeVector.empty(), Dev, error ) << "Size of chunk vector is 0!";
+	const size_t numberOfVolumes = std::max( m_RunLengthVolumes.size(), m_VolumeVector.size() );
+	LOG_IF( !numberOfVolumes, Dev, error ) << "Size of chunk vector is 0!";
 
-	if( m_VolumeVector.size() != m_ImageSize[3] ) {
+	if( numberOfVolumes != m_ImageSize[3] ) {
 		LOG( Dev, error ) << "The number of timesteps (" << m_ImageSize[3]
-						  << ") does not coincide with the number of volumes ("  << m_VolumeVector.size() << ").";
+						  << ") does not coincide with the number of volumes ("  << numberOfVolumes << ").";
 		return false;
 	}
 
-	LOG( Dev, verbose_info ) << "Spliced image to " << m_VolumeVector.size() << " volumes.";
+	LOG( Dev, verbose_info ) << "Spliced image to " << numberOfVolumes << " volumes.";
 
 	//image seems to be ok...i guess
 
@@ -310,7 +386,8 @@ void ImageHolder::updateOrientation()
 		getImageProperties().voxelSize += getISISImage()->getPropertyAs<util::fvector3>( "voxelGap" );
 	}
 
-	m_ImageProperties.boundingBox = geometrical::getPhysicalBoundingBox( ImageHolder::Pointer( new ImageHolder( *this ) ) );
+	//non owning pointer, copying the whole ImageHolder is not necessary
+	m_ImageProperties.boundingBox = geometrical::getPhysicalBoundingBox( ImageHolder::Pointer( this, NullDeleter() ) );
 }
 
 
@@ -341,9 +418,15 @@ void ImageHolder::logImageProps() const
 
 void ImageHolder::setVoxel ( const size_t &first, const size_t &second, const size_t &third, const size_t &fourth, const double &value, bool sync )
 {
+	if( !checkVoxelsUnlocked() ) {
+		return;
+	}
+
 	data::Chunk chunk = getISISImage()->getChunk( first, second, third, fourth, false );
-	getVolumeVector()[fourth].voxel<InternalImageType>( first, second, third )
+	expandVolumes();
+	m_VolumeVector[fourth].voxel<InternalImageType>( first, second, third )
 	= getImageProperties().scalingToInternalType.second->as<double>() + value * getImageProperties().scalingToInternalType.first->as<double>();
+	contentChanged();
 
 	if( sync ) {
 		switch( chunk.getTypeID() ) {
@@ -391,14 +474,224 @@ void ImageHolder::setVoxel ( const size_t &first, const size_t &second, const si
 void ImageHolder::synchronize ()
 {
 	collectImageInfo();
+	contentChanged();
 
 	if( getImageProperties().isRGB ) {
 		copyImageToVector<InternalImageColorType>( *getISISImage() );
 	} else {
+		ingest();
+	}
+}
+
+template<typename TYPE>
+std::pair<double, double> ImageHolder::getVolumeMinMax( const size_t &timestep )
+{
+	boost::shared_ptr<MinMaxPyramid> pyramid = getMinMaxPyramid( timestep );
+
+	if( !pyramid ) {
+		pyramid.reset( new MinMaxPyramid( getTypedSegments<TYPE>( timestep ), m_ImageSize, m_IngestOptions.numberOfThreads ) );
+		setMinMaxPyramid( timestep, pyramid );
+	}
+
+	if( pyramid->isValid() ) {
+		return std::make_pair( pyramid->getMin(), pyramid->getMax() );
+	}
+
+	//the volume is not stored in whole rows, so the pyramid knows nothing about it
+	std::pair<double, double> minMax( std::numeric_limits<double>::max(), -std::numeric_limits<double>::max() );
+	const std::vector< TypedSegment<TYPE> > segments = getTypedSegments<TYPE>( timestep );
+	BOOST_FOREACH( typename std::vector< TypedSegment<TYPE> >::const_reference segment, segments ) {
+		//NaN fails both comparisons and is ignored
+		for( const TYPE *iter = segment.begin; iter < segment.begin + segment.length; iter++ ) {
+			const double value = static_cast<double>( *iter );
+			minMax.first = value < minMax.first ? value : minMax.first;
+			minMax.second = value > minMax.second ? value : minMax.second;
+		}
+	}
+	return minMax;
+}
+
+void ImageHolder::refreshVolumes( const std::vector< size_t > &timesteps, const std::pair< double, double > &minMax )
+{
+	switch( getImageProperties().majorTypeID ) {
+	case data::ValueArray<bool>::staticID:
+		refreshVolumes<bool>( timesteps, minMax );
+		break;
+	case data::ValueArray<int8_t>::staticID:
+		refreshVolumes<int8_t>( timesteps, minMax );
+		break;
+	case data::ValueArray<uint8_t>::staticID:
+		refreshVolumes<uint8_t>( timesteps, minMax );
+		break;
+	case data::ValueArray<int16_t>::staticID:
+		refreshVolumes<int16_t>( timesteps, minMax );
+		break;
+	case data::ValueArray<uint16_t>::staticID:
+		refreshVolumes<uint16_t>( timesteps, minMax );
+		break;
+	case data::ValueArray<int32_t>::staticID:
+		refreshVolumes<int32_t>( timesteps, minMax );
+		break;
+	case data::ValueArray<uint32_t>::staticID:
+		refreshVolumes<uint32_t>( timesteps, minMax );
+		break;
+	case data::ValueArray<int64_t>::staticID:
+		refreshVolumes<int64_t>( timesteps, minMax );
+		break;
+	case data::ValueArray<uint64_t>::staticID:
+		refreshVolumes<uint64_t>( timesteps, minMax );
+		break;
+	case data::ValueArray<float>::staticID:
+		refreshVolumes<float>( timesteps, minMax );
+		break;
+	case data::ValueArray<double>::staticID:
+		refreshVolumes<double>( timesteps, minMax );
+		break;
+	default:
+		//e.g. color images
+		synchronize();
+		break;
+	}
+}
+
+bool ImageHolder::canShareVolumes() const
+{
+	return m_ChunkVector.size() == 1
+		   && m_ChunkVector.front().getTypeID() == data::ValueArray<InternalImageType>::staticID
+		   && m_ChunkVector.front().getVolume() == m_ImageSize[0] * m_ImageSize[1] * m_ImageSize[2] * m_ImageSize[3]
+		   && getImageProperties().scalingToInternalType.first->as<double>() == 1
+		   && getImageProperties().scalingToInternalType.second->as<double>() == 0;
+}
+
+void ImageHolder::expandVolumes()
+{
+	if( !isRunLengthEncoded() ) {
+		return;
+	}
+
+	const size_t volume = m_ImageSize[0] * m_ImageSize[1] * m_ImageSize[2];
+	LOG( Dev, info ) << "Expanding the run length encoded volumes of " << getImageProperties().fileName << " ("
+					 << volume * m_ImageSize[3] * sizeof( InternalImageType ) / ( 1024.0 * 1024.0 ) << " mb).";
+	data::ValueArray<InternalImageType> imagePtr( ( InternalImageType * ) malloc( volume * m_ImageSize[3] * sizeof( InternalImageType ) ), volume * m_ImageSize[3] );
+
+	for( size_t t = 0; t < m_RunLengthVolumes.size(); t++ ) {
+		m_RunLengthVolumes[t]->expand( &imagePtr[t * volume] );
+	}
+
+	//readers that still hold an encoded volume keep it, all others find the uncompressed volumes
+	boost::mutex::scoped_lock lock( m_VolumesMutex );
+	m_VolumeVector.clear();
+	spliceToVolumes( imagePtr );
+	m_RunLengthVolumes.clear();
+	getImageProperties().memSizeInternal = volume * m_ImageSize[3] * sizeof( InternalImageType );
+}
+
+void ImageHolder::clearVolumes()
+{
+	boost::mutex::scoped_lock lock( m_VolumesMutex );
+	m_VolumeVector.clear();
+	m_RunLengthVolumes.clear();
+}
+
+void ImageHolder::separateVolumes()
+{
+	const size_t volume = m_ImageSize[0] * m_ImageSize[1] * m_ImageSize[2];
+	data::ValueArray<InternalImageType> imagePtr( ( InternalImageType * ) malloc( volume * m_ImageSize[3] * sizeof( InternalImageType ) ), volume * m_ImageSize[3] );
+	getImageProperties().memSizeInternal = volume * m_ImageSize[3] * sizeof( InternalImageType );
+	LOG( Dev, info ) << "The internal representation of " << getImageProperties().fileName << " gets its own memory ("
+					 << getImageProperties().memSizeInternal / ( 1024.0 * 1024.0 ) << " mb).";
+	m_VolumeVector.clear();
+	spliceToVolumes( imagePtr );
+	m_SharesVolumes = false;
+}
+
+void ImageHolder::ingest()
+{
+	switch( getImageProperties().majorTypeID ) {
+	case data::ValueArray<bool>::staticID:
+		ingest<bool>();
+		break;
+	case data::ValueArray<int8_t>::staticID:
+		ingest<int8_t>();
+		break;
+	case data::ValueArray<uint8_t>::staticID:
+		ingest<uint8_t>();
+		break;
+	case data::ValueArray<int16_t>::staticID:
+		ingest<int16_t>();
+		break;
+	case data::ValueArray<uint16_t>::staticID:
+		ingest<uint16_t>();
+		break;
+	case data::ValueArray<int32_t>::staticID:
+		ingest<int32_t>();
+		break;
+	case data::ValueArray<uint32_t>::staticID:
+		ingest<uint32_t>();
+		break;
+	case data::ValueArray<int64_t>::staticID:
+		ingest<int64_t>();
+		break;
+	case data::ValueArray<uint64_t>::staticID:
+		ingest<uint64_t>();
+		break;
+	case data::ValueArray<float>::staticID:
+		ingest<float>();
+		break;
+	case data::ValueArray<double>::staticID:
+		ingest<double>();
+		break;
+	default:
+		LOG( Dev, warning ) << "No single pass copy for type " << getImageProperties().majorTypeName << ". Falling back to isis conversion.";
 		copyImageToVector<InternalImageType>( *getISISImage() );
+
+		if( m_IngestOptions.trueZero ) {
+			LOG( Runtime, warning ) << "Can not reserve zero for images of type " << getImageProperties().majorTypeName;
+		}
 	}
 }
 
+bool ImageHolder::checkVoxelsUnlocked() const
+{
+	if( m_VoxelLocks ) {
+		LOG( Runtime, error ) << "The voxels of " << getImageProperties().fileName << " can not be changed while another operation reads them.";
+		return false;
+	}
+
+	return true;
+}
+
+void ImageHolder::contentChanged()
+{
+	m_ContentRevision = nextContentRevision();
+	//slices extracted ahead of time show the old content
+	util::Singletons::get<SliceCache, 10>().clear( this );
+	m_HistogramCache.clear();
+	m_MinMaxPyramids.clear();
+}
+
+const Histogram *ImageHolder::getCachedHistogram ( const size_t &timestep, const size_t &numberOfBins, const bool &omitZero ) const
+{
+	const HistogramCacheType::const_iterator iter = m_HistogramCache.find( boost::make_tuple( timestep, numberOfBins, omitZero ) );
+	return iter == m_HistogramCache.end() ? 0 : &iter->second;
+}
+
+void ImageHolder::cacheHistogram ( const size_t &timestep, const size_t &numberOfBins, const Histogram &histogram )
+{
+	m_HistogramCache[boost::make_tuple( timestep, numberOfBins, histogram.omitZero )] = histogram;
+}
+
+boost::shared_ptr< MinMaxPyramid > ImageHolder::getMinMaxPyramid ( const size_t &timestep ) const
+{
+	const std::map<size_t, boost::shared_ptr<MinMaxPyramid> >::const_iterator iter = m_MinMaxPyramids.find( timestep );
+	return iter == m_MinMaxPyramids.end() ? boost::shared_ptr<MinMaxPyramid>() : iter->second;
+}
+
+void ImageHolder::setMinMaxPyramid ( const size_t &timestep, boost::shared_ptr< MinMaxPyramid > pyramid )
+{
+	m_MinMaxPyramids[timestep] = pyramid;
+}
+
 void ImageHolder::phyisicalCoordsChanged ( const util::fvector3 &physicalCoords )
 {
 	getImageProperties().physicalCoords = physicalCoords;
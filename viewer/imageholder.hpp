@@ -31,8 +31,13 @@
 #include "common.hpp"
 #include "color.hpp"
 #include "geometrical.hpp"
+#include "parallel.hpp"
+#include "runlengthvolume.hpp"
 #include <boost/foreach.hpp>
+#include <boost/tuple/tuple.hpp>
+#include <boost/tuple/tuple_comparison.hpp>
 #include <vector>
+#include <set>
 #include <qapplication.h>
 #include <CoreUtils/propmap.hpp>
 #include <DataStorage/image.hpp>
@@ -64,6 +69,58 @@ namespace widget
 {
 class WidgetInterface;
 }
+class MinMaxPyramid;
+
+///a contiguous run of voxels of the original image data
+template<typename TYPE>
+struct TypedSegment {
+	boost::shared_ptr<const TYPE> memory;
+	const TYPE *begin;
+	size_t length;
+};
+
+///calls op( begin, length ) for every contiguous run of segments that lies in the range [first, last) of the concatenated segments
+template<typename TYPE, typename OP>
+void forEachRun( const std::vector< TypedSegment<TYPE> > &segments, const size_t &first, const size_t &last, OP &op )
+{
+	size_t offset = 0;
+	BOOST_FOREACH( typename std::vector< TypedSegment<TYPE> >::const_reference segment, segments ) {
+		if( offset >= last ) {
+			break;
+		}
+
+		if( offset + segment.length > first ) {
+			const size_t from = std::max( first, offset ) - offset;
+			const size_t to = std::min( last, offset + segment.length ) - offset;
+			op( segment.begin + from, to - from );
+		}
+
+		offset += segment.length;
+	}
+}
+
+///histogram of the original image data
+struct Histogram {
+	Histogram() : lowerBound( 0 ), binWidth( 1 ), omitZero( false ) {}
+	double lowerBound;
+	double binWidth;
+	bool omitZero;
+	std::vector<double> bins;
+	double getBinCenter( const size_t &bin ) const { return lowerBound + ( bin + 0.5 ) * binWidth; }
+
+	///lays out numberOfBins empty bins between min and max. Integer data gets an integer bin width, so there may be fewer bins.
+	void initialize( const double &min, const double &max, const size_t &numberOfBins, const bool &isInteger, const bool &_omitZero );
+	///false for NaN and omitted zeros
+	bool counts( const double &value ) const { return value == value && !( omitZero && value == 0 ); }
+	///inverseBinWidth is passed to avoid a division per voxel
+	size_t getBin( const double &value, const double &inverseBinWidth ) const {
+		const double bin = ( value - lowerBound ) * inverseBinWidth;
+		return bin <= 0 ? 0 : std::min( static_cast<size_t>( bin ), bins.size() - 1 );
+	}
+	///adds the first parts of the given per-thread histograms
+	void add( const std::vector< std::vector<size_t> > &subHistograms, const unsigned short &parts );
+};
+
 /**
  * Class that holds one image in a vector of data::ValuePtr's
  * It ensures the data is hold in continuous memory and only consists of one type.
@@ -122,13 +179,38 @@ public:
 
 	ImageHolder();
 
-	bool setImage( const data::Image &image, const ImageType &imageType, const std::string &filename );
+	///options that are applied while the image data is copied to the internal representation
+	struct IngestOptions {
+		IngestOptions() : trueZero( false ), histogramBins( 0 ), histogramOmitZero( true ), numberOfThreads( 1 ), isMask( false ) {}
+		///voxels that are 0 in the original data become 0 in the internal representation, which is reserved for them
+		bool trueZero;
+		///if not 0 the histogram of the first volume is created while copying
+		size_t histogramBins;
+		bool histogramOmitZero;
+		unsigned short numberOfThreads;
+		///the volumes of masks are kept run length encoded as long as their runs need less than a quarter of the memory of the uncompressed volumes
+		bool isMask;
+	};
+
+	bool setImage( const data::Image &image, const ImageType &imageType, const std::string &filename, const IngestOptions &ingestOptions = IngestOptions() );
+	///options used by every following synchronize()
+	IngestOptions &getIngestOptions() { return m_IngestOptions; }
 
 	const std::vector< data::Chunk > &getChunkVector() const { return m_ChunkVector; }
 	std::vector< data::Chunk > &getChunkVector() { return m_ChunkVector; }
 
+	///returns the uncompressed internal representation of every volume, which is empty while the volumes are run length encoded (see getRunLengthVolume)
 	const std::vector< data::Chunk > &getVolumeVector() const { return m_VolumeVector; }
 	std::vector< data::Chunk > &getVolumeVector() { return m_VolumeVector; }
+	///returns the internal representation of the volume timestep, run length encoded volumes are expanded into a copy
+	data::Chunk getVolume( const size_t &timestep ) const;
+
+	/**
+	 * Returns the run length encoded internal representation of the volume timestep or an empty pointer if the volumes are not encoded.
+	 * The returned volume is never changed, edits replace it by a new one. So it can be read by any thread.
+	 */
+	RunLengthVolume::Pointer getRunLengthVolume( const size_t &timestep ) const;
+	bool isRunLengthEncoded() const;
 
 	util::PropertyMap &getPropMap() { return m_PropMap; }
 	const util::PropertyMap &getPropMap() const { return m_PropMap; }
@@ -178,8 +260,14 @@ public:
 
 	template<typename TYPE>
 	void setTypedVoxel(  const size_t &first, const size_t &second, const size_t &third, const size_t &fourth, const TYPE &value, bool sync = true ) {
+		if( !checkVoxelsUnlocked() ) {
+			return;
+		}
+
+		expandVolumes();
 		m_VolumeVector[fourth].voxel<InternalImageType>( first, second, third )
 		= static_cast<double>( value ) * getImageProperties().scalingToInternalType.first->as<double>() + getImageProperties().scalingToInternalType.second->as<double>();
+		contentChanged();
 
 		if( sync ) {
 			getISISImage()->voxel<TYPE>( first, second, third, fourth ) = value;
@@ -192,6 +280,187 @@ public:
 		}
 	}
 
+	/**
+	 * Prevents changing the voxels in place while another thread reads the memory of the chunks, e.g. a registration.
+	 * Every lockVoxels() needs an unlockVoxels(), in between all functions writing voxels fail.
+	 */
+	void lockVoxels() { m_VoxelLocks++; }
+	void unlockVoxels() { m_VoxelLocks--; }
+	bool areVoxelsLocked() const { return m_VoxelLocks; }
+
+	///has to be called whenever the voxel data of this image has been changed. Increases the content revision and drops all cached histograms.
+	void contentChanged();
+	///returns a number that changes whenever the content of the image changes and is unique among all images
+	size_t getContentRevision() const { return m_ContentRevision; }
+
+	///returns a pointer to the cached histogram of timestep or NULL if there is none for the current content revision
+	const Histogram *getCachedHistogram( const size_t &timestep, const size_t &numberOfBins, const bool &omitZero ) const;
+	void cacheHistogram( const size_t &timestep, const size_t &numberOfBins, const Histogram &histogram );
+
+	///returns the min/max pyramid of timestep or an empty pointer if there is none for the current content revision
+	boost::shared_ptr<MinMaxPyramid> getMinMaxPyramid( const size_t &timestep ) const;
+	void setMinMaxPyramid( const size_t &timestep, boost::shared_ptr<MinMaxPyramid> pyramid );
+
+	/**
+	 * Writes values to the voxels [first, last) (in memory order) of the volume timestep,
+	 * both to the original image and to the internal representation.
+	 * All chunks of the original image have to be of TYPE (see hasChunksOfType). The min/max of the image is not updated and contentChanged()
+	 * has to be called (e.g. via ViewerCoreBase::emitImageContentChanged) when all voxels are written.
+	 */
+	template<typename TYPE>
+	bool setTypedVoxels( const size_t &timestep, const size_t &first, const size_t &last, const TYPE *values ) {
+		if( !checkVoxelsUnlocked() ) {
+			return false;
+		}
+
+		if( !hasChunksOfType<TYPE>() ) {
+			LOG( Dev, error ) << "Can not write voxels of type " << util::Value<TYPE>::staticName() << " to an image of type " << getImageProperties().majorTypeName;
+			return false;
+		}
+
+		//the segments point to the memory of the chunks, as no conversion is necessary
+		WriteOp<TYPE> writeOp = { values };
+		forEachRun( getTypedSegments<TYPE>( timestep ), first, last, writeOp );
+
+		if( isRunLengthEncoded() ) {
+			const size_t sliceSize = m_ImageSize[0] * m_ImageSize[1];
+
+			if( first < last ) {
+				reencodeSlices<TYPE>( timestep, first / sliceSize, ( last - 1 ) / sliceSize + 1 );
+			}
+
+			return true;
+		}
+
+		InternalImageType *internal = &m_VolumeVector[timestep].voxel<InternalImageType>( 0, 0, 0 );
+		const double scaling = getImageProperties().scalingToInternalType.first->as<double>();
+		const double offset = getImageProperties().scalingToInternalType.second->as<double>();
+
+		for( size_t i = first; i < last; i++ ) {
+			internal[i] = toInternalType( static_cast<double>( values[i - first] ), scaling, offset, m_IngestOptions.trueZero );
+		}
+
+		return true;
+	}
+
+	/**
+	 * Sets the voxels of each run [first, last) (in memory order) of the volume timestep to value,
+	 * both in the original image and in the internal representation.
+	 * Like setTypedVoxels all chunks of the original image have to be of TYPE and contentChanged() has to be called afterwards.
+	 */
+	template<typename TYPE>
+	bool fillTypedVoxels( const size_t &timestep, const std::vector< std::pair<size_t, size_t> > &runs, const TYPE &value ) {
+		if( !checkVoxelsUnlocked() ) {
+			return false;
+		}
+
+		if( !hasChunksOfType<TYPE>() ) {
+			LOG( Dev, error ) << "Can not write voxels of type " << util::Value<TYPE>::staticName() << " to an image of type " << getImageProperties().majorTypeName;
+			return false;
+		}
+
+		const std::vector< TypedSegment<TYPE> > segments = getTypedSegments<TYPE>( timestep );
+
+		if( isRunLengthEncoded() ) {
+			const size_t sliceSize = m_ImageSize[0] * m_ImageSize[1];
+			size_t firstSlice = m_ImageSize[2];
+			size_t lastSlice = 0;
+			FillOp<TYPE> fillOp = { value };
+			typedef std::vector< std::pair<size_t, size_t> >::const_reference RunReference;
+			BOOST_FOREACH( RunReference run, runs ) {
+				forEachRun( segments, run.first, run.second, fillOp );
+				firstSlice = std::min( firstSlice, run.first / sliceSize );
+				lastSlice = std::max( lastSlice, ( run.second - 1 ) / sliceSize + 1 );
+			}
+
+			//only the slices that were painted are encoded again
+			if( firstSlice < lastSlice ) {
+				reencodeSlices<TYPE>( timestep, firstSlice, lastSlice );
+			}
+
+			return true;
+		}
+
+		InternalImageType *internal = &m_VolumeVector[timestep].voxel<InternalImageType>( 0, 0, 0 );
+		const InternalImageType internalValue = toInternalType( static_cast<double>( value ), getImageProperties().scalingToInternalType.first->as<double>(),
+												getImageProperties().scalingToInternalType.second->as<double>(), m_IngestOptions.trueZero );
+		FillOp<TYPE> fillOp = { value };
+		typedef std::vector< std::pair<size_t, size_t> >::const_reference RunReference;
+		BOOST_FOREACH( RunReference run, runs ) {
+			forEachRun( segments, run.first, run.second, fillOp );
+			std::fill( internal + run.first, internal + run.second, internalValue );
+		}
+		return true;
+	}
+
+	/**
+	 * Returns true if all chunks are of TYPE. Only then getTypedSegments<TYPE>() points to the memory of the image
+	 * instead of a converted copy, so writing to the segments changes the image.
+	 */
+	template<typename TYPE>
+	bool hasChunksOfType() const {
+		BOOST_FOREACH( std::vector<data::Chunk>::const_reference chunk, m_ChunkVector ) {
+			if( chunk.getTypeID() != data::ValueArray<TYPE>::staticID ) {
+				return false;
+			}
+		}
+		return !m_ChunkVector.empty();
+	}
+
+	///rounds and clamps the original value to the internal type like the conversion of the whole image does
+	static InternalImageType toInternalType( const double &value, const double &scaling, const double &offset, const bool &trueZero ) {
+		const double max = std::numeric_limits<InternalImageType>::max();
+		const double scaled = value * scaling + offset + 0.5;
+		return ( value != value || ( trueZero && value == 0 ) || scaled <= 0 ) ? 0 : scaled >= max ? max : static_cast<InternalImageType>( scaled );
+	}
+
+	/**
+	 * Converts the volumes timesteps to the internal representation again after their original voxels were changed in place.
+	 * minMax is the min/max of the changed volumes, so unlike synchronize() the image is not searched for it.
+	 * The min/max of the other volumes is taken from their min/max pyramids, which are built if necessary and kept.
+	 * The other volumes are only converted if the scaling to the internal type changes.
+	 */
+	void refreshVolumes( const std::vector<size_t> &timesteps, const std::pair<double, double> &minMax );
+
+	/**
+	 * Returns the original data of the volume at timestep as a list of contiguous runs in memory order.
+	 * No voxel is copied unless the type of a chunk differs from TYPE.
+	 */
+	template<typename TYPE>
+	std::vector< TypedSegment<TYPE> > getTypedSegments( const size_t &timestep ) const {
+		const size_t volume = m_ImageSize[0] * m_ImageSize[1] * m_ImageSize[2];
+		return getTypedSegments<TYPE>( timestep * volume, ( timestep + 1 ) * volume );
+	}
+
+	///returns the original data of the voxels [first, last) of the whole image in memory order as getTypedSegments( timestep ) does
+	template<typename TYPE>
+	std::vector< TypedSegment<TYPE> > getTypedSegments( const size_t &first, const size_t &last ) const {
+		std::vector< TypedSegment<TYPE> > segments;
+		size_t offset = 0;
+		BOOST_FOREACH( std::vector<data::Chunk>::const_reference chunk, m_ChunkVector ) {
+			const size_t length = chunk.getVolume();
+
+			if( offset + length > first && offset < last ) {
+				const size_t from = std::max( first, offset ) - offset;
+				const size_t to = std::min( last, offset + length ) - offset;
+				TypedSegment<TYPE> segment;
+
+				if( chunk.getTypeID() == data::ValueArray<TYPE>::staticID ) {
+					segment.memory = boost::shared_static_cast<const TYPE>( chunk.getValueArray<TYPE>().getRawAddress() );
+				} else {
+					segment.memory = boost::shared_static_cast<const TYPE>( data::MemChunk<TYPE>( chunk ).template getValueArray<TYPE>().getRawAddress() );
+				}
+
+				segment.begin = segment.memory.get() + from;
+				segment.length = to - from;
+				segments.push_back( segment );
+			}
+
+			offset += length;
+		}
+		return segments;
+	}
+
 	void phyisicalCoordsChanged( const util::fvector3 &physicalCoords );
 	void voxelCoordsChanged( const util::ivector4 &voxelCoords );
 	void timestepChanged( const size_t &timestep );
@@ -213,21 +482,49 @@ private:
 
 	std::vector< data::Chunk > m_ChunkVector;
 	std::vector< data::Chunk > m_VolumeVector;
+	std::vector<RunLengthVolume::Pointer> m_RunLengthVolumes;
+	//guards switching between the encoded and the uncompressed volumes against readers on other threads
+	mutable boost::mutex m_VolumesMutex;
+	//the volumes of m_VolumeVector point to the memory of m_ChunkVector
+	bool m_SharesVolumes;
 
 	boost::shared_ptr<color::Color> m_ColorHandler;
 
 	ImageProperties m_ImageProperties;
 
+	size_t m_ContentRevision;
+	unsigned short m_VoxelLocks;
+	///logs an error and returns false if the voxels are locked
+	bool checkVoxelsUnlocked() const;
+	//images are also created by several threads at once, e.g. by the SnapshotBatch
+	static size_t nextContentRevision();
+	static size_t s_ContentRevisionCounter;
+	static boost::mutex s_ContentRevisionMutex;
+	typedef std::map<boost::tuple<size_t, size_t, bool>, Histogram > HistogramCacheType;
+	HistogramCacheType m_HistogramCache;
+	std::map<size_t, boost::shared_ptr<MinMaxPyramid> > m_MinMaxPyramids;
+
+	IngestOptions m_IngestOptions;
+
 	template<typename TYPE>
-	void copyImageToVector( const data::Image &image ) {
-		m_VolumeVector.clear();
-		m_ChunkVector = image.copyChunksToVector();
-		data::ValueArray<TYPE> imagePtr( ( TYPE * ) calloc( image.getVolume(), sizeof( TYPE ) ), image.getVolume() );
-		getImageProperties().memSizeInternal = image.getVolume() * sizeof( TYPE );
-		LOG( Dev, info ) << "Needed memory: " << getImageProperties().memSizeInternal / ( 1024.0 * 1024.0 ) << " mb.";
+	struct WriteOp {
+		const TYPE *values;
+		void operator()( const TYPE *begin, const size_t &length ) {
+			std::copy( values, values + length, const_cast<TYPE *>( begin ) );
+			values += length;
+		}
+	};
+
+	template<typename TYPE>
+	struct FillOp {
+		TYPE value;
+		void operator()( const TYPE *begin, const size_t &length ) {
+			std::fill( const_cast<TYPE *>( begin ), const_cast<TYPE *>( begin ) + length, value );
+		}
+	};
 
+	void setScalingToInternalType( const data::scaling_pair &scalingPair ) {
 		if( getImageProperties().zeroIsReserved ) {
-			data::scaling_pair scalingPair = image.getScalingTo( data::ValueArray<TYPE>::staticID, data::upscale );
 			double scaling = scalingPair.first->as<double>();
 			double offset = scalingPair.second->as<double>();
 			scaling /= static_cast<double>( getInternalExtent() + 1 ) / getInternalExtent();
@@ -235,13 +532,14 @@ private:
 			const data::scaling_pair newScaling( std::make_pair< util::ValueReference, util::ValueReference>( util::Value<double>( scaling ), util::Value<double>( offset ) ) ) ;
 			getImageProperties().scalingToInternalType = newScaling;
 		} else {
-			getImageProperties().scalingToInternalType = image.getScalingTo( data::ValueArray<TYPE>::staticID, data::upscale );
+			getImageProperties().scalingToInternalType = scalingPair;
 		}
 
 		LOG( Dev, info ) << "scalingToInternalType: " << getImageProperties().scalingToInternalType.first->as<double>() << " : " << getImageProperties().scalingToInternalType.second->as<double>();
-		image.copyToMem<TYPE>( &imagePtr[0], image.getVolume(), getImageProperties().scalingToInternalType );
-		LOG( Dev, verbose_info ) << "Copied image to continuous memory space.";
+	}
 
+	template<typename TYPE>
+	void spliceToVolumes( const data::ValueArray<TYPE> &imagePtr ) {
 		//splice the image in its volumes -> we get a vector of t volumes
 		if( m_ImageSize[dim_time] > 1 ) { //splicing is only necessary if we got more than 1 timestep
 			std::vector< data::ValueArrayReference > refVec = imagePtr.splice( m_ImageSize[0] * m_ImageSize[1] * m_ImageSize[2] );
@@ -254,6 +552,312 @@ private:
 		}
 	}
 
+	///returns true if the original data can be used as internal representation without any conversion
+	bool canShareVolumes() const;
+	///replaces the run length encoded volumes by uncompressed ones
+	void expandVolumes();
+	///drops the internal representation before it is created again
+	void clearVolumes();
+	///gives the internal representation its own memory if it was shared with the original data
+	void separateVolumes();
+
+	template<typename TYPE>
+	void copyImageToVector( const data::Image &image ) {
+		clearVolumes();
+		m_SharesVolumes = false;
+		m_ChunkVector = image.copyChunksToVector();
+		data::ValueArray<TYPE> imagePtr( ( TYPE * ) calloc( image.getVolume(), sizeof( TYPE ) ), image.getVolume() );
+		getImageProperties().memSizeInternal = image.getVolume() * sizeof( TYPE );
+		LOG( Dev, info ) << "Needed memory: " << getImageProperties().memSizeInternal / ( 1024.0 * 1024.0 ) << " mb.";
+		setScalingToInternalType( image.getScalingTo( data::ValueArray<TYPE>::staticID, data::upscale ) );
+		image.copyToMem<TYPE>( &imagePtr[0], image.getVolume(), getImageProperties().scalingToInternalType );
+		LOG( Dev, verbose_info ) << "Copied image to continuous memory space.";
+		spliceToVolumes( imagePtr );
+	}
+
+	///converts a run of original voxels to the internal type, masks the true zero and fills the histogram in one go
+	template<typename TYPE>
+	struct IngestOp {
+		IngestOp( const std::vector< TypedSegment<TYPE> > &_segments, InternalImageType *_destination, const double &_scaling, const double &_offset,
+				  const bool &_trueZero, const Histogram *_histogram, const unsigned short &numberOfThreads )
+			: segments( _segments ), destination( _destination ), scaling( _scaling ), offset( _offset ), trueZero( _trueZero ), histogram( _histogram ),
+			  inverseBinWidth( _histogram ? 1. / _histogram->binWidth : 1 ),
+			  subHistograms( _histogram ? numberOfThreads : 0, std::vector<size_t>( _histogram ? _histogram->bins.size() : 0, 0 ) ) {}
+		void operator()( const size_t &first, const size_t &last, const unsigned short &threadIndex ) {
+			RunOp runOp = { this, destination + first, histogram ? &subHistograms[threadIndex][0] : 0 };
+			forEachRun( segments, first, last, runOp );
+		}
+		struct RunOp {
+			IngestOp *parent;
+			InternalImageType *destination;
+			size_t *histogram;
+			void operator()( const TYPE *begin, const size_t &length ) {
+				for( size_t i = 0; i < length; i++ ) {
+					const double value = static_cast<double>( begin[i] );
+					destination[i] = toInternalType( value, parent->scaling, parent->offset, parent->trueZero );
+
+					if( histogram && parent->histogram->counts( value ) ) {
+						histogram[parent->histogram->getBin( value, parent->inverseBinWidth )]++;
+					}
+				}
+
+				destination += length;
+			}
+		};
+		const std::vector< TypedSegment<TYPE> > &segments;
+		InternalImageType *destination;
+		const double scaling;
+		const double offset;
+		const bool trueZero;
+		const Histogram *histogram;
+		const double inverseBinWidth;
+		std::vector< std::vector<size_t> > subHistograms;
+	};
+
+	/**
+	 * Copies the original data into the internal representation in a single pass per chunk.
+	 * The true zero mask and the histogram of the first volume are created on the fly.
+	 */
+	template<typename TYPE>
+	void ingest() {
+		clearVolumes();
+		m_ChunkVector = getISISImage()->copyChunksToVector();
+		const size_t volume = m_ImageSize[0] * m_ImageSize[1] * m_ImageSize[2];
+		//the min/max is already known from collectImageInfo, so it is not searched again
+		setScalingToInternalType( m_ChunkVector.front().asValueArrayBase().getScalingTo(
+					data::ValueArray<InternalImageType>::staticID, getImageProperties().minMax, data::upscale ) );
+		m_SharesVolumes = false;
+
+		if( m_IngestOptions.isMask && encodeVolumes<TYPE>() ) {
+			return;
+		}
+
+		//e.g. 8 bit masks are displayed as they are, so they are not copied at all
+		if( canShareVolumes() ) {
+			getImageProperties().memSizeInternal = 0;
+			LOG( Dev, info ) << "The internal representation shares the memory of the image.";
+			spliceToVolumes( m_ChunkVector.front().getValueArray<InternalImageType>() );
+			m_SharesVolumes = true;
+			return;
+		}
+
+		//every voxel is written, so there is no need to clear the memory
+		data::ValueArray<InternalImageType> imagePtr( ( InternalImageType * ) malloc( volume * m_ImageSize[3] * sizeof( InternalImageType ) ), volume * m_ImageSize[3] );
+		getImageProperties().memSizeInternal = volume * m_ImageSize[3] * sizeof( InternalImageType );
+		LOG( Dev, info ) << "Needed memory: " << getImageProperties().memSizeInternal / ( 1024.0 * 1024.0 ) << " mb.";
+
+		for( size_t t = 0; t < m_ImageSize[3]; t++ ) {
+			convertVolume<TYPE>( t, &imagePtr[t * volume] );
+		}
+
+		LOG( Dev, verbose_info ) << "Copied image to continuous memory space.";
+		spliceToVolumes( imagePtr );
+	}
+
+	///converts a run of original voxels to the internal type and appends it to the runs of a slice
+	template<typename TYPE>
+	struct EncodeOp {
+		RunLengthVolume::Encoder *encoder;
+		double scaling;
+		double offset;
+		bool trueZero;
+		void operator()( const TYPE *begin, const size_t &length ) {
+			for( size_t i = 0; i < length; i++ ) {
+				encoder->push( toInternalType( static_cast<double>( begin[i] ), scaling, offset, trueZero ) );
+			}
+		}
+	};
+
+	/**
+	 * Encodes the slices [firstSlice, lastSlice) of the volume timestep into volume with the current scaling.
+	 * Returns false as soon as volume consists of more than maxRuns runs.
+	 */
+	template<typename TYPE>
+	bool encodeSlices( RunLengthVolume &volume, const size_t &timestep, const size_t &firstSlice, const size_t &lastSlice, const size_t &maxRuns ) {
+		const size_t sliceSize = m_ImageSize[0] * m_ImageSize[1];
+		const std::vector< TypedSegment<TYPE> > segments = getTypedSegments<TYPE>( timestep );
+		EncodeOp<TYPE> op = { 0, getImageProperties().scalingToInternalType.first->as<double>(),
+							  getImageProperties().scalingToInternalType.second->as<double>(), m_IngestOptions.trueZero
+							};
+
+		for( size_t z = firstSlice; z < lastSlice; z++ ) {
+			RunLengthVolume::Encoder encoder( volume, z );
+			op.encoder = &encoder;
+			forEachRun( segments, z * sliceSize, ( z + 1 ) * sliceSize, op );
+
+			if( volume.getNumberOfRuns() > maxRuns ) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	///returns the number of runs of a volume that need a quarter of the memory of the uncompressed volume
+	size_t getMaxRuns() const {
+		return m_ImageSize[0] * m_ImageSize[1] * m_ImageSize[2] * sizeof( InternalImageType ) / ( 4 * sizeof( RunLengthVolume::Run ) );
+	}
+
+	/**
+	 * Encodes the slices [firstSlice, lastSlice) of the volume timestep again after its original voxels were changed.
+	 * Readers on other threads may still hold the old volume, so the slices are encoded into a copy that replaces it.
+	 * If the volume needs more runs than getMaxRuns() all volumes are stored uncompressed instead.
+	 */
+	template<typename TYPE>
+	void reencodeSlices( const size_t &timestep, const size_t &firstSlice, const size_t &lastSlice ) {
+		RunLengthVolume::Pointer volume( new RunLengthVolume( *getRunLengthVolume( timestep ) ) );
+
+		if( !encodeSlices<TYPE>( *volume, timestep, firstSlice, lastSlice, getMaxRuns() ) ) {
+			decodeVolumes<TYPE>();
+			return;
+		}
+
+		boost::mutex::scoped_lock lock( m_VolumesMutex );
+		m_RunLengthVolumes[timestep] = volume;
+	}
+
+	///replaces the run length encoded volumes by uncompressed ones converted from the original data
+	template<typename TYPE>
+	void decodeVolumes() {
+		const size_t volume = m_ImageSize[0] * m_ImageSize[1] * m_ImageSize[2];
+		LOG( Dev, info ) << "The runs of " << getImageProperties().fileName << " exceed their memory budget. Storing the volumes uncompressed.";
+		data::ValueArray<InternalImageType> imagePtr( ( InternalImageType * ) malloc( volume * m_ImageSize[3] * sizeof( InternalImageType ) ), volume * m_ImageSize[3] );
+
+		for( size_t t = 0; t < m_ImageSize[3]; t++ ) {
+			convertVolume<TYPE>( t, &imagePtr[t * volume] );
+		}
+
+		boost::mutex::scoped_lock lock( m_VolumesMutex );
+		m_VolumeVector.clear();
+		spliceToVolumes( imagePtr );
+		m_RunLengthVolumes.clear();
+		getImageProperties().memSizeInternal = volume * m_ImageSize[3] * sizeof( InternalImageType );
+	}
+
+	/**
+	 * Stores all volumes run length encoded if their runs need less than a quarter of the memory of the uncompressed volumes.
+	 * Returns false and leaves the volumes empty otherwise.
+	 */
+	template<typename TYPE>
+	bool encodeVolumes() {
+		const size_t maxRuns = getMaxRuns();
+		size_t memory = 0;
+		std::vector<RunLengthVolume::Pointer> volumes;
+
+		for( size_t t = 0; t < m_ImageSize[3]; t++ ) {
+			volumes.push_back( RunLengthVolume::Pointer( new RunLengthVolume( m_ImageSize[0], m_ImageSize[1], m_ImageSize[2] ) ) );
+
+			if( !encodeSlices<TYPE>( *volumes.back(), t, 0, m_ImageSize[2], maxRuns ) ) {
+				return false;
+			}
+
+			memory += volumes.back()->getMemorySize();
+		}
+
+		boost::mutex::scoped_lock lock( m_VolumesMutex );
+		m_RunLengthVolumes = volumes;
+		getImageProperties().memSizeInternal = memory;
+		LOG( Dev, info ) << "The internal representation is run length encoded (" << memory / ( 1024.0 * 1024.0 ) << " mb).";
+		return true;
+	}
+
+	///converts the volume timestep to the internal type using the current scaling
+	template<typename TYPE>
+	void convertVolume( const size_t &timestep, InternalImageType *destination ) {
+		const size_t volume = m_ImageSize[0] * m_ImageSize[1] * m_ImageSize[2];
+		const double scaling = getImageProperties().scalingToInternalType.first->as<double>();
+		const double offset = getImageProperties().scalingToInternalType.second->as<double>();
+		const std::vector< TypedSegment<TYPE> > segments = getTypedSegments<TYPE>( timestep );
+		Histogram histogram;
+		const bool withHistogram = !timestep && m_IngestOptions.histogramBins;
+
+		if( withHistogram ) {
+			histogram.initialize( getImageProperties().minMax.first->as<double>(), getImageProperties().minMax.second->as<double>(),
+								  m_IngestOptions.histogramBins, std::numeric_limits<TYPE>::is_integer, m_IngestOptions.histogramOmitZero );
+		}
+
+		IngestOp<TYPE> op( segments, destination, scaling, offset, m_IngestOptions.trueZero, withHistogram ? &histogram : 0, m_IngestOptions.numberOfThreads );
+		const unsigned short parts = parallel::forEachRange( 0, volume, op, m_IngestOptions.numberOfThreads, 1 << 16 );
+
+		if( withHistogram ) {
+			histogram.add( op.subHistograms, parts );
+			cacheHistogram( timestep, m_IngestOptions.histogramBins, histogram );
+		}
+	}
+
+	///returns the min/max of the original data of the volume timestep, which is only defined in imageholder.cpp
+	template<typename TYPE>
+	std::pair<double, double> getVolumeMinMax( const size_t &timestep );
+
+	template<typename TYPE>
+	void refreshVolumes( const std::vector<size_t> &timesteps, const std::pair<double, double> &minMax ) {
+		std::pair<double, double> newMinMax = minMax;
+		const std::set<size_t> changed( timesteps.begin(), timesteps.end() );
+
+		//the range of the volumes that were not changed is taken from their own data, as the old range may include values that were overwritten
+		for( size_t t = 0; t < m_ImageSize[3]; t++ ) {
+			if( !changed.count( t ) ) {
+				const std::pair<double, double> volumeMinMax = getVolumeMinMax<TYPE>( t );
+				newMinMax.first = std::min( newMinMax.first, volumeMinMax.first );
+				newMinMax.second = std::max( newMinMax.second, volumeMinMax.second );
+			}
+		}
+
+		//the pyramids of the volumes that were not changed stay valid
+		std::map<size_t, boost::shared_ptr<MinMaxPyramid> > pyramids = m_MinMaxPyramids;
+		BOOST_FOREACH( std::set<size_t>::const_reference t, changed ) {
+			pyramids.erase( t );
+		}
+
+		getImageProperties().minMax.first = util::Value<TYPE>( newMinMax.first );
+		getImageProperties().minMax.second = util::Value<TYPE>( newMinMax.second );
+		getImageProperties().extent = fabs( newMinMax.second - newMinMax.first );
+		getImageProperties().scalingMinMax = newMinMax;
+		getImageProperties().zeroIsReserved = getImageProperties().zeroIsReserved || ( getImageProperties().imageType == statistical_image && newMinMax.first < 0 );
+		const double scaling = getImageProperties().scalingToInternalType.first->as<double>();
+		const double offset = getImageProperties().scalingToInternalType.second->as<double>();
+		setScalingToInternalType( m_ChunkVector.front().asValueArrayBase().getScalingTo(
+					data::ValueArray<InternalImageType>::staticID, getImageProperties().minMax, data::upscale ) );
+		contentChanged();
+		m_MinMaxPyramids = pyramids;
+
+		if( isRunLengthEncoded() ) {
+			const bool rescaled = scaling != getImageProperties().scalingToInternalType.first->as<double>() || offset != getImageProperties().scalingToInternalType.second->as<double>();
+
+			for( size_t t = 0; t < m_RunLengthVolumes.size(); t++ ) {
+				if( rescaled || changed.count( t ) ) {
+					reencodeSlices<TYPE>( t, 0, m_ImageSize[2] );
+				}
+			}
+
+			return;
+		}
+
+		//the internal representation already holds the new values
+		if( m_SharesVolumes && canShareVolumes() ) {
+			return;
+		}
+
+		const bool separated = m_SharesVolumes;
+
+		if( separated ) {
+			separateVolumes();
+		}
+
+		if( separated || scaling != getImageProperties().scalingToInternalType.first->as<double>() || offset != getImageProperties().scalingToInternalType.second->as<double>() ) {
+			LOG( Dev, info ) << "The scaling of " << getImageProperties().fileName << " changed. Converting all volumes.";
+
+			for( size_t t = 0; t < m_VolumeVector.size(); t++ ) {
+				convertVolume<TYPE>( t, &m_VolumeVector[t].voxel<InternalImageType>( 0, 0, 0 ) );
+			}
+		} else {
+			BOOST_FOREACH( std::vector<size_t>::const_reference t, timesteps ) {
+				convertVolume<TYPE>( t, &m_VolumeVector[t].voxel<InternalImageType>( 0, 0, 0 ) );
+			}
+		}
+	}
+
+	void ingest();
 
 };
 
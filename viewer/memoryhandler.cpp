@@ -50,6 +50,67 @@ util::ivector4 MemoryHandler::get32BitAlignedSize ( const util::ivector4 &origSi
 	return retSize;
 }
 
+int32_t MemoryHandler::getSliceIndex ( const ImageHolder::Pointer image, const PlaneOrientation &orientation, const util::ivector4 &trueVoxelCoords )
+{
+	return mapCoordsToOrientation( trueVoxelCoords, image->getImageProperties().latchedOrientation, orientation )[2];
+}
+
+void SliceCache::store ( const data::Chunk &slice, const KeyType &key )
+{
+	boost::mutex::scoped_lock lock( m_Mutex );
+
+	if( m_Slices.size() >= m_MaxSize ) {
+		LOG( Dev, verbose_info ) << "SliceCache is full (" << m_MaxSize << " slices). Dropping slice of timestep " << key.get<2>();
+		return;
+	}
+
+	m_Slices.insert( std::make_pair( key, slice ) );
+}
+
+bool SliceCache::contains ( const ImageHolder::Pointer image, const PlaneOrientation &orientation, const size_t &timestep, const int32_t &slicePosition ) const
+{
+	boost::mutex::scoped_lock lock( m_Mutex );
+	return m_Slices.find( getKey( image, orientation, timestep, slicePosition ) ) != m_Slices.end();
+}
+
+void SliceCache::retain ( const std::set<KeyType> &keys )
+{
+	boost::mutex::scoped_lock lock( m_Mutex );
+
+	for( MapType::iterator iter = m_Slices.begin(); iter != m_Slices.end(); ) {
+		if( keys.find( iter->first ) == keys.end() ) {
+			m_Slices.erase( iter++ );
+		} else {
+			iter++;
+		}
+	}
+}
+
+void SliceCache::clear()
+{
+	boost::mutex::scoped_lock lock( m_Mutex );
+	m_Slices.clear();
+}
+
+void SliceCache::clear ( const ImageHolder *image )
+{
+	boost::mutex::scoped_lock lock( m_Mutex );
+
+	for( MapType::iterator iter = m_Slices.begin(); iter != m_Slices.end(); ) {
+		if( iter->first.get<0>() == image ) {
+			m_Slices.erase( iter++ );
+		} else {
+			iter++;
+		}
+	}
+}
+
+size_t SliceCache::size() const
+{
+	boost::mutex::scoped_lock lock( m_Mutex );
+	return m_Slices.size();
+}
+
 
 
 }
@@ -33,56 +33,155 @@
 #include <common.hpp>
 #include "imageholder.hpp"
 #include <boost/timer.hpp>
+#include <CoreUtils/singletons.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/tuple/tuple.hpp>
+#include <boost/tuple/tuple_comparison.hpp>
+#include <set>
 
 namespace isis
 {
 namespace viewer
 {
 
+/**
+ * Holds slices that were extracted ahead of time (e.g. by the TimePlayer while playing a timecourse).
+ * MemoryHandler::fillSliceChunk looks up this cache before extracting a slice from the volume.
+ * Entries are consumed on lookup, so the cache never serves the same slice twice.
+ * Slices are stored with the content revision of their image, so a slice extracted before the image was changed is never served.
+ * Entries that are no longer wanted (skipped timesteps, an old cursor position) have to be dropped with retain().
+ */
+class SliceCache
+{
+public:
+	///image, orientation, timestep, slice position and content revision of a slice
+	typedef boost::tuple<const ImageHolder *, PlaneOrientation, size_t, int32_t, size_t> KeyType;
+
+	SliceCache() : m_MaxSize( 256 ) {}
+
+	static KeyType getKey( const ImageHolder::Pointer image, const PlaneOrientation &orientation, const size_t &timestep, const int32_t &slicePosition ) {
+		return KeyType( image.get(), orientation, timestep, slicePosition, image->getContentRevision() );
+	}
+
+	///stores slice under key, which has to be taken before the slice was extracted
+	void store( const data::Chunk &slice, const KeyType &key );
+	bool contains( const ImageHolder::Pointer image, const PlaneOrientation &orientation, const size_t &timestep, const int32_t &slicePosition ) const;
+	///drops all slices whose key is not in keys
+	void retain( const std::set<KeyType> &keys );
+	void clear();
+	void clear( const ImageHolder *image );
+	void clear( const ImageHolder::Pointer image ) { clear( image.get() ); }
+	size_t size() const;
+
+	void setMaxSize( const size_t &maxSize ) { m_MaxSize = maxSize; }
+
+	template<typename TYPE>
+	bool take( data::MemChunk<TYPE> &sliceChunk, const ImageHolder::Pointer image, const PlaneOrientation &orientation, const size_t &timestep, const int32_t &slicePosition ) {
+		boost::mutex::scoped_lock lock( m_Mutex );
+
+		if( m_Slices.empty() ) {
+			return false;
+		}
+
+		const MapType::iterator iter = m_Slices.find( getKey( image, orientation, timestep, slicePosition ) );
+
+		if( iter == m_Slices.end() ) {
+			return false;
+		}
+
+		data::Chunk &dest = static_cast<data::Chunk &>( sliceChunk );
+		const bool fits = iter->second.getTypeID() == dest.getTypeID() && iter->second.getVolume() == dest.getVolume();
+
+		if( fits ) {
+			std::memcpy( &dest.voxel<TYPE>( 0 ), &iter->second.voxel<TYPE>( 0 ), dest.getVolume() * sizeof( TYPE ) );
+		}
+
+		m_Slices.erase( iter );
+		return fits;
+	}
+
+private:
+	typedef std::map<KeyType, data::Chunk> MapType;
+
+	MapType m_Slices;
+	size_t m_MaxSize;
+	mutable boost::mutex m_Mutex;
+};
+
 class MemoryHandler
 {
 public:
 	static util::ivector4 get32BitAlignedSize( const util::ivector4 &origSize );
 
+	///returns the index of voxel (x, y, z) of a volume of the given size in memory order
+	static size_t getLinearIndex( const util::ivector4 &size, const int32_t &x, const int32_t &y, const int32_t &z ) {
+		return x + size[0] * ( y + size[1] * static_cast<size_t>( z ) );
+	}
+
+	///returns the index of the slice that is perpendicular to orientation and goes through trueVoxelCoords
+	static int32_t getSliceIndex( const ImageHolder::Pointer image, const PlaneOrientation &orientation, const util::ivector4 &trueVoxelCoords );
+
 	template< typename TYPE>
 	static void fillSliceChunk( data::MemChunk<TYPE> &sliceChunk, const ImageHolder::Pointer image, const PlaneOrientation &orientation ) {
+		const size_t timestep = image->getImageProperties().timestep;
+		const util::ivector4 &trueVoxelCoords = image->getImageProperties().trueVoxelCoords;
+
+		if( !util::Singletons::get<SliceCache, 10>().take( sliceChunk, image, orientation, timestep, getSliceIndex( image, orientation, trueVoxelCoords ) ) ) {
+			fillSliceChunk<TYPE>( sliceChunk, image, orientation, timestep, trueVoxelCoords );
+		}
+	}
 
-		const util::ivector4 trueVoxelCoords = image->getImageProperties().trueVoxelCoords;
+	///fills the sliceChunk with the slice of the given timestep that goes through trueVoxelCoords. Bypasses the SliceCache.
+	template< typename TYPE>
+	static void fillSliceChunk( data::MemChunk<TYPE> &sliceChunk, const ImageHolder::Pointer image, const PlaneOrientation &orientation, const size_t &timestep, const util::ivector4 &trueVoxelCoords ) {
 
 		const util::ivector4 mappedSize = mapCoordsToOrientation( image->getImageSize(), image->getImageProperties().latchedOrientation, orientation );
 		const util::ivector4 mappedCoords = mapCoordsToOrientation( trueVoxelCoords, image->getImageProperties().latchedOrientation, orientation );
 		const util::ivector4 mapping = mapCoordsToOrientation( util::ivector4( 0, 1, 2, 3 ), image->getImageProperties().latchedOrientation, orientation, true );
 		const util::ivector4 _mapping = mapCoordsToOrientation( util::ivector4( 0, 1, 2, 3 ), image->getImageProperties().latchedOrientation, orientation, false );
-		const data::Chunk &chunk = image->getVolumeVector()[image->getImageProperties().timestep];
+		const util::ivector4 size = image->getImageSize();
 
 		const bool sliceIsInside = trueVoxelCoords[_mapping[2]] >= 0 && trueVoxelCoords[_mapping[2]] < mappedSize[2];
 
-		TYPE *dest = &static_cast<data::Chunk &>( sliceChunk ).voxel<TYPE>( 0 );
+		if( !sliceIsInside ) {
+			return;
+		}
 
-		const util::ivector4 coords( 0, 0, mappedCoords[2] );
-		const TYPE *src = &chunk.voxel<TYPE>( coords[mapping[0]], coords[mapping[1]], coords[mapping[2]] );
+		TYPE *dest = &static_cast<data::Chunk &>( sliceChunk ).voxel<TYPE>( 0 );
 
 		const util::ivector4 sizeAligned = static_cast<data::Chunk &>( sliceChunk ).getSizeAsVector();
 
-		const util::ivector4::value_type coords1x[3] = {0, 0, mappedCoords[2] };
+		const util::ivector4::value_type coords1[3] = {0, 0, mappedCoords[2] };
+		const size_t lin1 = getLinearIndex( size, coords1[mapping[0]], coords1[mapping[1]], coords1[mapping[2]] );
+
 		const util::ivector4::value_type coords2x[3] = {1, 0, mappedCoords[2] };
-		const size_t lin1x = chunk.getLinearIndex( util::ivector4( coords1x[mapping[0]], coords1x[mapping[1]], coords1x[mapping[2]] ) );
-		const size_t lin2x = chunk.getLinearIndex( util::ivector4( coords2x[mapping[0]], coords2x[mapping[1]], coords2x[mapping[2]] ) );
-		const size_t linx = lin2x - lin1x;
+		const size_t lin2x = getLinearIndex( size, coords2x[mapping[0]], coords2x[mapping[1]], coords2x[mapping[2]] );
+		const size_t linx = lin2x - lin1;
 
-		const util::ivector4::value_type coords1y[3] = {0, 0, mappedCoords[2] };
 		const util::ivector4::value_type coords2y[3] = {0, 1, mappedCoords[2] };
-		const size_t lin1y = chunk.getLinearIndex( util::ivector4( coords1y[mapping[0]], coords1y[mapping[1]], coords1y[mapping[2]] ) );
-		const size_t lin2y = chunk.getLinearIndex( util::ivector4( coords2y[mapping[0]], coords2y[mapping[1]], coords2y[mapping[2]] ) );
-		const size_t liny = lin2y - lin1y;
+		const size_t lin2y = getLinearIndex( size, coords2y[mapping[0]], coords2y[mapping[1]], coords2y[mapping[2]] );
+		const size_t liny = lin2y - lin1;
+
+		//masks are read from their runs, so they are never expanded for rendering
+		const RunLengthVolume::Pointer runs = image->getRunLengthVolume( timestep );
+
+		if( runs ) {
+			for ( util::ivector4::value_type y = 0; y < mappedSize[1]; y++ ) {
+				for ( util::ivector4::value_type x = 0; x < mappedSize[0]; x++ ) {
+					dest[x + sizeAligned[0] * y] = getEncodedVoxel<TYPE>( *runs, lin1 + x * linx + y * liny );
+				}
+			}
+
+			return;
+		}
+
+		const TYPE *src = &image->getVolumeVector()[timestep].voxel<TYPE>( 0 ) + lin1;
 
 		for ( util::ivector4::value_type y = 0; y < mappedSize[1]; y++ ) {
 			for ( util::ivector4::value_type x = 0; x < mappedSize[0]; x++ ) {
-				if( sliceIsInside ) {
-					std::memcpy( dest + x + sizeAligned[0] * y,
-								 src + x * linx + y * liny,
-								 sizeof( TYPE ) );
-				}
+				std::memcpy( dest + x + sizeAligned[0] * y,
+							 src + x * linx + y * liny,
+							 sizeof( TYPE ) );
 			}
 		}
 	}
@@ -92,7 +191,7 @@ public:
 		if( image->getImageProperties().latchedOrientation == image->getImageProperties().orientation ) {
 			fillSliceChunk<TYPE>( sliceChunk, image, orientation );
 		} else {
-			const data::Chunk &chunk = image->getVolumeVector()[image->getImageProperties().timestep];
+			const RunLengthVolume::Pointer runs = image->getRunLengthVolume( image->getImageProperties().timestep );
 			boost::shared_ptr< _internal::__Image > isisImage = image->getISISImage();
 			const geometrical::BoundingBoxType &bb = image->getImageProperties().boundingBox;
 			const util::ivector4 mapping = mapCoordsToOrientation( util::fvector4( 0, 1, 2 ), image->getImageProperties().latchedOrientation, orientation );
@@ -103,9 +202,9 @@ public:
 			const float stepJ = factor * image->getImageProperties().voxelSize[mapping[1]];
 
 			const util::ivector4 sizeSliceChunk = static_cast<data::Chunk &>( sliceChunk ).getSizeAsVector();
-			const util::ivector4 sizeChunk = chunk.getSizeAsVector();
+			const util::ivector4 sizeChunk = image->getImageSize();
 
-			const TYPE *src = &chunk.voxel<TYPE>( 0 );
+			const TYPE *src = runs ? 0 : &image->getVolumeVector()[image->getImageProperties().timestep].voxel<TYPE>( 0 );
 			TYPE *dest = &static_cast<data::Chunk &>( sliceChunk ).voxel<TYPE>( 0 );
 			int32_t voxCoords[3];
 
@@ -122,8 +221,8 @@ public:
 // 						memcpy( dest + sliceCoords[0] + sizeSliceChunk[0] * sliceCoords[1],
 // 									 src + chunkCoords[0] + sizeChunk[0] * chunkCoords[1] + sizeChunk[0] * sizeChunk[1] * chunkCoords[2],
 // 									 sizeof( TYPE ) );
-						dest[sliceCoords[0] + sizeSliceChunk[0] * sliceCoords[1]]
-							= src[chunkCoords[0] + sizeChunk[0] * chunkCoords[1] + sizeChunk[0] * sizeChunk[1] * chunkCoords[2]];
+						const size_t index = chunkCoords[0] + sizeChunk[0] * chunkCoords[1] + sizeChunk[0] * sizeChunk[1] * chunkCoords[2];
+						dest[sliceCoords[0] + sizeSliceChunk[0] * sliceCoords[1]] = runs ? getEncodedVoxel<TYPE>( *runs, index ) : src[index];
 					}
 				}
 			}
@@ -0,0 +1,63 @@
+/****************************************************************
+ *
+ * <Copyright information>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *
+ * minmaxpyramid.cpp
+ *
+ * Description:
+ *
+ *  Created on: Oct 19, 2026
+ ******************************************************************/
+#include "minmaxpyramid.hpp"
+
+namespace isis
+{
+namespace viewer
+{
+
+void MinMaxPyramid::buildCoarserLevels()
+{
+	while( m_Levels.back().numberOfBricks[0] > 1 || m_Levels.back().numberOfBricks[1] > 1 || m_Levels.back().numberOfBricks[2] > 1 ) {
+		const Level &fine = m_Levels.back();
+		Level coarse;
+
+		for( unsigned short i = 0; i < 3; i++ ) {
+			coarse.numberOfBricks[i] = ( fine.numberOfBricks[i] + 1 ) / 2;
+		}
+
+		const size_t numberOfBricks = coarse.numberOfBricks[0] * coarse.numberOfBricks[1] * coarse.numberOfBricks[2];
+		coarse.minima.resize( numberOfBricks, std::numeric_limits<double>::max() );
+		coarse.maxima.resize( numberOfBricks, -std::numeric_limits<double>::max() );
+
+		for( int32_t z = 0; z < fine.numberOfBricks[2]; z++ ) {
+			for( int32_t y = 0; y < fine.numberOfBricks[1]; y++ ) {
+				for( int32_t x = 0; x < fine.numberOfBricks[0]; x++ ) {
+					const size_t fineIndex = fine.getIndex( x, y, z );
+					const size_t coarseIndex = coarse.getIndex( x / 2, y / 2, z / 2 );
+					coarse.minima[coarseIndex] = std::min( coarse.minima[coarseIndex], fine.minima[fineIndex] );
+					coarse.maxima[coarseIndex] = std::max( coarse.maxima[coarseIndex], fine.maxima[fineIndex] );
+				}
+			}
+		}
+
+		m_Levels.push_back( coarse );
+	}
+}
+
+}
+}
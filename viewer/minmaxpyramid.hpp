@@ -0,0 +1,368 @@
+/****************************************************************
+ *
+ * <Copyright information>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *
+ * minmaxpyramid.hpp
+ *
+ * Description:
+ *
+ *  Created on: Oct 19, 2026
+ ******************************************************************/
+#ifndef VAST_MINMAXPYRAMID_HPP
+#define VAST_MINMAXPYRAMID_HPP
+
+#include "imageholder.hpp"
+#include "parallel.hpp"
+#include <algorithm>
+#include <deque>
+#include <limits>
+
+namespace isis
+{
+namespace viewer
+{
+
+/**
+ * Searches contiguous runs of voxels for their extremum. Each run is split into blocks whose extremum is found
+ * with a branchless loop the compiler can vectorize, its position is only looked for if it can beat the current best.
+ * Ties are resolved in favour of the smaller index. position is the index of the first voxel of the next run.
+ */
+template<typename TYPE, bool MAXIMUM>
+struct ExtremumRunOp {
+	size_t position;
+	TYPE &best;
+	size_t &bestIndex;
+	bool &found;
+	static bool isBetter( const TYPE &value, const TYPE &than ) { return MAXIMUM ? value > than : value < than; }
+	void operator()( const TYPE *begin, const size_t &length ) {
+		static const size_t blockSize = 1024;
+
+		for( size_t b = 0; b < length; b += blockSize ) {
+			const size_t n = std::min( blockSize, length - b );
+			const TYPE *block = begin + b;
+			TYPE blockBest = block[0];
+
+			for( size_t i = 1; i < n; i++ ) {
+				blockBest = isBetter( block[i], blockBest ) ? block[i] : blockBest;
+			}
+
+			if( blockBest != blockBest ) { //NaN at the beginning of the block
+				for( size_t i = 1; i < n; i++ ) {
+					if( block[i] == block[i] && ( blockBest != blockBest || isBetter( block[i], blockBest ) ) ) {
+						blockBest = block[i];
+					}
+				}
+
+				if( blockBest != blockBest ) {
+					continue;
+				}
+			}
+
+			if( !found || isBetter( blockBest, best ) || ( blockBest == best && position + b < bestIndex ) ) {
+				size_t i = 0;
+
+				while( block[i] != blockBest ) {
+					i++;
+				}
+
+				if( found && blockBest == best && position + b + i >= bestIndex ) {
+					continue;
+				}
+
+				best = blockBest;
+				bestIndex = position + b + i;
+				found = true;
+			}
+		}
+
+		position += length;
+	}
+};
+
+/**
+ * Hierarchical min/max summary of one volume of an image.
+ * The finest level holds the minimum and maximum of every brick of brickSize^3 voxels,
+ * every coarser level merges 2x2x2 bricks of the level below until one brick covers the whole volume.
+ * It is used to find extrema by only visiting bricks that can contain a better value than the current one.
+ */
+class MinMaxPyramid
+{
+public:
+	typedef boost::shared_ptr<MinMaxPyramid> Pointer;
+
+	///edge length of the bricks of the finest level in voxels
+	static const int32_t brickSize = 8;
+
+	struct Level {
+		util::ivector4 numberOfBricks;
+		std::vector<double> minima;
+		std::vector<double> maxima;
+		size_t getIndex( const int32_t &x, const int32_t &y, const int32_t &z ) const { return x + numberOfBricks[0] * ( y + numberOfBricks[1] * z ); }
+	};
+
+	template<typename TYPE>
+	MinMaxPyramid( const std::vector< TypedSegment<TYPE> > &segments, const util::ivector4 &size, const unsigned short &numberOfThreads )
+		: m_Size( size ) {
+		const std::vector<const TYPE *> rows = getRows( segments, size );
+		Level level;
+
+		for( unsigned short i = 0; i < 3; i++ ) {
+			level.numberOfBricks[i] = ( size[i] + brickSize - 1 ) / brickSize;
+		}
+
+		const size_t numberOfBricks = level.numberOfBricks[0] * level.numberOfBricks[1] * level.numberOfBricks[2];
+		m_Valid = !rows.empty();
+
+		if( m_Valid ) {
+			level.minima.resize( numberOfBricks, std::numeric_limits<double>::max() );
+			level.maxima.resize( numberOfBricks, -std::numeric_limits<double>::max() );
+			BuildOp<TYPE> op( rows, size, level );
+			parallel::forEachRange( 0, level.numberOfBricks[2], op, numberOfThreads );
+		} else {
+			//nothing is known about the bricks, so they have to be assumed to contain every value
+			level.minima.resize( numberOfBricks, -std::numeric_limits<double>::max() );
+			level.maxima.resize( numberOfBricks, std::numeric_limits<double>::max() );
+		}
+
+		m_Levels.push_back( level );
+		buildCoarserLevels();
+	}
+
+	/**
+	 * Returns false if the pyramid could not be built because a row of the volume is split among two chunks.
+	 * Then every brick claims to contain every value and findExtremum can not be used.
+	 */
+	bool isValid() const { return m_Valid; }
+
+	size_t getNumberOfLevels() const { return m_Levels.size(); }
+	const Level &getLevel( const size_t &level ) const { return m_Levels[level]; }
+	///returns the edge length of the bricks of level in voxels
+	int32_t getBrickSize( const size_t &level ) const { return brickSize << level; }
+
+	double getMin() const { return m_Levels.back().minima.front(); }
+	double getMax() const { return m_Levels.back().maxima.front(); }
+
+	/**
+	 * Searches the box [start, end) for a value better than best (if found is true), using numberOfThreads threads along z.
+	 * indexOffset is added to the linear index inside the volume, e.g. to get indices in the whole image.
+	 * Ties are resolved in favour of the smaller index. On success best, bestIndex and found are set and true is returned.
+	 */
+	template<typename TYPE, bool MAXIMUM>
+	bool findExtremum( const std::vector< TypedSegment<TYPE> > &segments, const util::ivector4 &start, const util::ivector4 &end,
+					   TYPE &best, size_t &bestIndex, bool &found, const size_t &indexOffset, const unsigned short &numberOfThreads ) const {
+		const std::vector<const TYPE *> rows = getRows( segments, m_Size );
+
+		if( rows.empty() ) {
+			return false;
+		}
+
+		SearchOp<TYPE, MAXIMUM> op( this, rows, start, end, indexOffset, best, bestIndex, found, numberOfThreads );
+		const unsigned short parts = parallel::forEachRange( start[2], end[2], op, numberOfThreads, brickSize );
+		bool improved = false;
+
+		for( unsigned short i = 0; i < parts; i++ ) {
+			if( op.found[i] && ( !found || ExtremumRunOp<TYPE, MAXIMUM>::isBetter( op.bestValues[i], best )
+								 || ( op.bestValues[i] == best && op.bestIndices[i] < bestIndex ) ) ) {
+				best = op.bestValues[i];
+				bestIndex = op.bestIndices[i];
+				found = true;
+				improved = true;
+			}
+		}
+
+		return improved;
+	}
+
+private:
+	util::ivector4 m_Size;
+	std::vector<Level> m_Levels;
+	bool m_Valid;
+
+	void buildCoarserLevels();
+
+	///returns a pointer to the beginning of every row (y,z) of the volume or an empty vector if a row is split among two segments
+	template<typename TYPE>
+	static std::vector<const TYPE *> getRows( const std::vector< TypedSegment<TYPE> > &segments, const util::ivector4 &size ) {
+		std::vector<const TYPE *> rows;
+		rows.reserve( size[1] * size[2] );
+		BOOST_FOREACH( typename std::vector< TypedSegment<TYPE> >::const_reference segment, segments ) {
+			if( segment.length % size[0] ) {
+				LOG( Dev, warning ) << "Segment of length " << segment.length << " does not consist of whole rows of length " << size[0];
+				return std::vector<const TYPE *>();
+			}
+
+			for( size_t offset = 0; offset < segment.length; offset += size[0] ) {
+				rows.push_back( segment.begin + offset );
+			}
+		}
+		return rows;
+	}
+
+	template<typename TYPE>
+	struct BuildOp {
+		BuildOp( const std::vector<const TYPE *> &_rows, const util::ivector4 &_size, Level &_level ) : rows( _rows ), size( _size ), level( _level ) {}
+		///every thread processes a slab of bricks along z, so no brick is written by two threads
+		void operator()( const size_t &first, const size_t &last, const unsigned short & ) {
+			for( int32_t z = first * brickSize; z < std::min<int32_t>( last * brickSize, size[2] ); z++ ) {
+				for( int32_t y = 0; y < size[1]; y++ ) {
+					const TYPE *row = rows[y + z * size[1]];
+
+					for( int32_t bx = 0; bx < level.numberOfBricks[0]; bx++ ) {
+						const size_t index = level.getIndex( bx, y / brickSize, z / brickSize );
+						double min = level.minima[index];
+						double max = level.maxima[index];
+
+						//NaN fails both comparisons and is ignored
+						for( int32_t x = bx * brickSize; x < std::min( ( bx + 1 ) * brickSize, size[0] ); x++ ) {
+							const double value = static_cast<double>( row[x] );
+							min = value < min ? value : min;
+							max = value > max ? value : max;
+						}
+
+						level.minima[index] = min;
+						level.maxima[index] = max;
+					}
+				}
+			}
+		}
+		const std::vector<const TYPE *> &rows;
+		const util::ivector4 size;
+		Level &level;
+	};
+
+	template<typename TYPE, bool MAXIMUM>
+	struct Search {
+		const MinMaxPyramid *pyramid;
+		const std::vector<const TYPE *> &rows;
+		const util::ivector4 &start;
+		const util::ivector4 &end;
+		const size_t indexOffset;
+		TYPE &best;
+		size_t &bestIndex;
+		bool &found;
+
+		static bool isBetter( const double &value, const double &than ) { return MAXIMUM ? value > than : value < than; }
+
+		struct Candidate {
+			double bound;
+			size_t firstIndex;
+			int32_t x, y, z;
+			bool operator<( const Candidate &other ) const { return isBetter( bound, other.bound ) || ( bound == other.bound && firstIndex < other.firstIndex ); }
+		};
+
+		///returns the index of the first voxel of the brick inside the search box
+		size_t getFirstIndex( const size_t &level, const int32_t &x, const int32_t &y, const int32_t &z ) const {
+			const int32_t size = pyramid->getBrickSize( level );
+			return indexOffset + std::max( x * size, start[0] )
+				   + pyramid->m_Size[0] * ( std::max( y * size, start[1] ) + pyramid->m_Size[1] * static_cast<size_t>( std::max( z * size, start[2] ) ) );
+		}
+
+		void visit( const size_t &level, const int32_t &x, const int32_t &y, const int32_t &z ) {
+			const int32_t size = pyramid->getBrickSize( level );
+			int32_t from[3] = { x * size, y * size, z * size };
+			int32_t to[3] = { from[0] + size, from[1] + size, from[2] + size };
+
+			for( unsigned short i = 0; i < 3; i++ ) {
+				from[i] = std::max( from[i], start[i] );
+				to[i] = std::min( to[i], end[i] );
+
+				if( from[i] >= to[i] ) {
+					return;
+				}
+			}
+
+			if( level == 0 ) {
+				//the rows of the brick are scanned in memory order, so the first of equal values wins
+				ExtremumRunOp<TYPE, MAXIMUM> runOp = { 0, best, bestIndex, found };
+
+				for( int32_t vz = from[2]; vz < to[2]; vz++ ) {
+					for( int32_t vy = from[1]; vy < to[1]; vy++ ) {
+						runOp.position = indexOffset + from[0] + pyramid->m_Size[0] * ( vy + pyramid->m_Size[1] * static_cast<size_t>( vz ) );
+						runOp( rows[vy + vz * pyramid->m_Size[1]] + from[0], to[0] - from[0] );
+					}
+				}
+
+				return;
+			}
+
+			//visit the most promising children first, so the others can most likely be skipped
+			const Level &children = pyramid->m_Levels[level - 1];
+			Candidate candidates[8];
+			unsigned short numberOfCandidates = 0;
+
+			for( int32_t cz = 2 * z; cz < std::min( 2 * z + 2, children.numberOfBricks[2] ); cz++ ) {
+				for( int32_t cy = 2 * y; cy < std::min( 2 * y + 2, children.numberOfBricks[1] ); cy++ ) {
+					for( int32_t cx = 2 * x; cx < std::min( 2 * x + 2, children.numberOfBricks[0] ); cx++ ) {
+						const size_t index = children.getIndex( cx, cy, cz );
+						const Candidate candidate = { MAXIMUM ? children.maxima[index] : children.minima[index], getFirstIndex( level - 1, cx, cy, cz ), cx, cy, cz };
+						candidates[numberOfCandidates++] = candidate;
+					}
+				}
+			}
+
+			std::sort( candidates, candidates + numberOfCandidates );
+
+			for( unsigned short i = 0; i < numberOfCandidates; i++ ) {
+				//as the bound of a brick is only reached if the brick lies completely in the search box, these checks are conservative
+				if( found ) {
+					if( isBetter( best, candidates[i].bound ) ) {
+						break;
+					}
+
+					//a brick can only win a tie if it starts before the current best
+					if( candidates[i].bound == best && candidates[i].firstIndex >= bestIndex ) {
+						continue;
+					}
+				}
+
+				visit( level - 1, candidates[i].x, candidates[i].y, candidates[i].z );
+			}
+		}
+	};
+
+	///every thread searches a slab of the box along z with its own best value, which starts with the best value of the caller
+	template<typename TYPE, bool MAXIMUM>
+	struct SearchOp {
+		SearchOp( const MinMaxPyramid *_pyramid, const std::vector<const TYPE *> &_rows, const util::ivector4 &_start, const util::ivector4 &_end,
+				  const size_t &_indexOffset, const TYPE &best, const size_t &bestIndex, const bool &found, const unsigned short &numberOfThreads )
+			: pyramid( _pyramid ), rows( _rows ), start( _start ), end( _end ), indexOffset( _indexOffset ),
+			  bestValues( numberOfThreads, best ), bestIndices( numberOfThreads, bestIndex ), found( numberOfThreads, found ) {}
+		void operator()( const size_t &first, const size_t &last, const unsigned short &threadIndex ) {
+			util::ivector4 slabStart = start;
+			util::ivector4 slabEnd = end;
+			slabStart[2] = first;
+			slabEnd[2] = last;
+			Search<TYPE, MAXIMUM> search = { pyramid, rows, slabStart, slabEnd, indexOffset, bestValues[threadIndex], bestIndices[threadIndex], found[threadIndex] };
+			search.visit( pyramid->m_Levels.size() - 1, 0, 0, 0 );
+		}
+		const MinMaxPyramid *pyramid;
+		const std::vector<const TYPE *> &rows;
+		const util::ivector4 start;
+		const util::ivector4 end;
+		const size_t indexOffset;
+		//deques, because std::vector<bool> has no references to its elements
+		std::deque<TYPE> bestValues;
+		std::vector<size_t> bestIndices;
+		std::deque<bool> found;
+	};
+};
+
+}
+}
+
+#endif // VAST_MINMAXPYRAMID_HPP
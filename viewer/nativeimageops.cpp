@@ -53,173 +53,250 @@ std::pair< double, double > isis::viewer::operation::NativeImageOps::getScalingO
 }
 
 
-isis::util::ivector4 isis::viewer::operation::NativeImageOps::getGlobalMin( const boost::shared_ptr< isis::viewer::ImageHolder > image, const util::ivector4 &startPos, const unsigned short &radius )
+namespace
 {
+///shows the progress of a search in the progress bar of the viewer
+struct ProgressBarCallback {
+	ProgressBarCallback( isis::viewer::QViewerCore *_core, const std::string &_header ) : core( _core ), header( _header ), reported( 0 ) {}
+	bool operator()( size_t done, size_t total ) {
+		if( !reported ) {
+			core->getProgressFeedback()->show( total, header );
+		}
+
+		core->getProgressFeedback()->progress( "", done - reported );
+		reported = done;
+		return true;
+	}
+	isis::viewer::QViewerCore *core;
+	const std::string header;
+	size_t reported;
+};
+}
+
+isis::viewer::operation::NativeImageOps::Extremum isis::viewer::operation::NativeImageOps::getGlobalMin( const boost::shared_ptr< isis::viewer::ImageHolder > image, const util::ivector4 &startPos, const unsigned short &radius, const ProgressCallback &progress )
+{
+	return getGlobalExtremum( image, startPos, radius, progress, false );
+}
+
+isis::viewer::operation::NativeImageOps::Extremum isis::viewer::operation::NativeImageOps::getGlobalMax( const boost::shared_ptr< isis::viewer::ImageHolder > image, const util::ivector4 &startPos, const unsigned short &radius, const ProgressCallback &progress )
+{
+	return getGlobalExtremum( image, startPos, radius, progress, true );
+}
+
+isis::viewer::operation::NativeImageOps::Extremum isis::viewer::operation::NativeImageOps::getGlobalExtremum( const boost::shared_ptr< isis::viewer::ImageHolder > image, const util::ivector4 &startPos, const unsigned short &radius, const ProgressCallback &progress, const bool &maximum )
+{
+	Extremum extremum;
+
+	if( image->getImageProperties().isRGB ) {
+		LOG( Runtime, error ) << "Search of min/max is not supported for RGB images!";
+		return extremum;
+	}
+
 	if( image->getISISImage()->getVolume() >= 1e6 ) {
 		m_ViewerCore->getUICore()->toggleLoadingIcon( true );
 	}
 
-	switch ( image->getISISImage()->getMajorTypeID() ) {
+	ProgressBarCallback feedback( m_ViewerCore, maximum ? "Searching maximum..." : "Searching minimum..." );
+
+	switch ( image->getImageProperties().majorTypeID ) {
 	case data::ValueArray<bool>::staticID:
-		return internGetMax<bool>( image, startPos, radius );
+		extremum = internGetExtremum<bool>( image, startPos, radius, progress ? progress : ProgressCallback( boost::ref( feedback ) ), maximum );
 		break;
 	case data::ValueArray<int8_t>::staticID:
-		return internGetMin<int8_t>( image, startPos, radius );
+		extremum = internGetExtremum<int8_t>( image, startPos, radius, progress ? progress : ProgressCallback( boost::ref( feedback ) ), maximum );
 		break;
 	case data::ValueArray<uint8_t>::staticID:
-		return internGetMin<uint8_t>( image, startPos, radius );
+		extremum = internGetExtremum<uint8_t>( image, startPos, radius, progress ? progress : ProgressCallback( boost::ref( feedback ) ), maximum );
 		break;
 	case data::ValueArray<int16_t>::staticID:
-		return internGetMin<int16_t>( image, startPos, radius );
+		extremum = internGetExtremum<int16_t>( image, startPos, radius, progress ? progress : ProgressCallback( boost::ref( feedback ) ), maximum );
 		break;
 	case data::ValueArray<uint16_t>::staticID:
-		return internGetMin<uint16_t>( image, startPos, radius );
+		extremum = internGetExtremum<uint16_t>( image, startPos, radius, progress ? progress : ProgressCallback( boost::ref( feedback ) ), maximum );
 		break;
 	case data::ValueArray<int32_t>::staticID:
-		return internGetMin<int32_t>( image, startPos, radius );
+		extremum = internGetExtremum<int32_t>( image, startPos, radius, progress ? progress : ProgressCallback( boost::ref( feedback ) ), maximum );
 		break;
 	case data::ValueArray<uint32_t>::staticID:
-		return internGetMin<uint32_t>( image, startPos, radius );
+		extremum = internGetExtremum<uint32_t>( image, startPos, radius, progress ? progress : ProgressCallback( boost::ref( feedback ) ), maximum );
 		break;
 	case data::ValueArray<int64_t>::staticID:
-		return internGetMin<int64_t>( image, startPos, radius );
+		extremum = internGetExtremum<int64_t>( image, startPos, radius, progress ? progress : ProgressCallback( boost::ref( feedback ) ), maximum );
 		break;
 	case data::ValueArray<uint64_t>::staticID:
-		return internGetMin<uint64_t>( image, startPos, radius );
+		extremum = internGetExtremum<uint64_t>( image, startPos, radius, progress ? progress : ProgressCallback( boost::ref( feedback ) ), maximum );
 		break;
 	case data::ValueArray<float>::staticID:
-		return internGetMin<float>( image, startPos, radius );
+		extremum = internGetExtremum<float>( image, startPos, radius, progress ? progress : ProgressCallback( boost::ref( feedback ) ), maximum );
 		break;
 	case data::ValueArray<double>::staticID:
-		return internGetMin<double>( image, startPos, radius );
+		extremum = internGetExtremum<double>( image, startPos, radius, progress ? progress : ProgressCallback( boost::ref( feedback ) ), maximum );
 		break;
 	default:
-		LOG( Runtime, error ) << "Search of min/max is not suported for " << image->getISISImage()->getMajorTypeID() << " !";
-		return isis::util::ivector4();
+		LOG( Runtime, error ) << "Search of min/max is not suported for " << image->getImageProperties().majorTypeName << " !";
 		break;
 	}
 
+	if( !progress ) {
+		m_ViewerCore->getProgressFeedback()->close();
+	}
+
+	m_ViewerCore->getUICore()->toggleLoadingIcon( false );
+	return extremum;
 }
 
-isis::util::ivector4 isis::viewer::operation::NativeImageOps::getGlobalMax( const boost::shared_ptr< isis::viewer::ImageHolder > image, const util::ivector4 &startPos, const unsigned short &radius )
+isis::viewer::MinMaxPyramid::Pointer isis::viewer::operation::NativeImageOps::getMinMaxPyramid ( const isis::viewer::ImageHolder::Pointer image, const size_t &timestep )
 {
-	if( image->getISISImage()->getVolume() >= 1e6 ) {
-		m_ViewerCore->getUICore()->toggleLoadingIcon( true );
-	}
-
-	switch ( image->getISISImage()->getMajorTypeID() ) {
+	switch ( image->getImageProperties().majorTypeID ) {
 	case data::ValueArray<bool>::staticID:
-		return internGetMax<bool>( image, startPos, radius );
-		break;
+		return internGetMinMaxPyramid<bool>( image, timestep );
 	case data::ValueArray<int8_t>::staticID:
-		return internGetMax<int8_t>( image, startPos, radius );
-		break;
+		return internGetMinMaxPyramid<int8_t>( image, timestep );
 	case data::ValueArray<uint8_t>::staticID:
-		return internGetMax<uint8_t>( image, startPos, radius );
-		break;
+		return internGetMinMaxPyramid<uint8_t>( image, timestep );
 	case data::ValueArray<int16_t>::staticID:
-		return internGetMax<int16_t>( image, startPos, radius );
-		break;
+		return internGetMinMaxPyramid<int16_t>( image, timestep );
 	case data::ValueArray<uint16_t>::staticID:
-		return internGetMax<uint16_t>( image, startPos, radius );
-		break;
+		return internGetMinMaxPyramid<uint16_t>( image, timestep );
 	case data::ValueArray<int32_t>::staticID:
-		return internGetMax<int32_t>( image, startPos, radius );
-		break;
+		return internGetMinMaxPyramid<int32_t>( image, timestep );
 	case data::ValueArray<uint32_t>::staticID:
-		return internGetMax<uint32_t>( image, startPos, radius );
-		break;
+		return internGetMinMaxPyramid<uint32_t>( image, timestep );
 	case data::ValueArray<int64_t>::staticID:
-		return internGetMax<int64_t>( image, startPos, radius );
-		break;
+		return internGetMinMaxPyramid<int64_t>( image, timestep );
 	case data::ValueArray<uint64_t>::staticID:
-		return internGetMax<uint64_t>( image, startPos, radius );
-		break;
+		return internGetMinMaxPyramid<uint64_t>( image, timestep );
 	case data::ValueArray<float>::staticID:
-		return internGetMax<float>( image, startPos, radius );
-		break;
+		return internGetMinMaxPyramid<float>( image, timestep );
 	case data::ValueArray<double>::staticID:
-		return internGetMax<double>( image, startPos, radius );
-		break;
+		return internGetMinMaxPyramid<double>( image, timestep );
 	default:
-		LOG( Runtime, error ) << "Search of min/max is not suported for " << image->getISISImage()->getMajorTypeID() << " !";
-		return isis::util::ivector4();
-		break;
+		LOG( Runtime, error ) << "Min/max pyramids are not supported for " << image->getImageProperties().majorTypeName << " !";
+		return MinMaxPyramid::Pointer();
 	}
 }
 
 void isis::viewer::operation::NativeImageOps::setTrueZero ( boost::shared_ptr< isis::viewer::ImageHolder > image )
 {
-	if( !image->getImageProperties().isRGB ) {
+	if( !image->getImageProperties().isRGB && !image->getIngestOptions().trueZero ) {
+		LOG( Dev, info ) << "Setting true zero for " << image->getImageProperties().fileName;
 		m_ViewerCore->getUICore()->toggleLoadingIcon( true );
-
-		switch ( image->getImageProperties().majorTypeID ) {
-		case data::ValueArray<bool>::staticID:
-			_setTrueZero<bool>( image );
-			break;
-		case data::ValueArray<int8_t>::staticID:
-			_setTrueZero<int8_t>( image );
-			break;
-		case data::ValueArray<uint8_t>::staticID:
-			_setTrueZero<uint8_t>( image );
-			break;
-		case data::ValueArray<int16_t>::staticID:
-			_setTrueZero<int16_t>( image );
-			break;
-		case data::ValueArray<uint16_t>::staticID:
-			_setTrueZero<uint16_t>( image );
-			break;
-		case data::ValueArray<int32_t>::staticID:
-			_setTrueZero<int32_t>( image );
-			break;
-		case data::ValueArray<uint32_t>::staticID:
-			_setTrueZero<uint32_t>( image );
-			break;
-		case data::ValueArray<int64_t>::staticID:
-			_setTrueZero<int64_t>( image );
-			break;
-		case data::ValueArray<uint64_t>::staticID:
-			_setTrueZero<uint64_t>( image );
-			break;
-		case data::ValueArray<float>::staticID:
-			_setTrueZero<float>( image );
-			break;
-		case data::ValueArray<double>::staticID:
-			_setTrueZero<double>( image );
-			break;
-		}
+		//the zero mask is applied while the image is copied to its internal representation
+		image->getIngestOptions().trueZero = true;
+		image->getIngestOptions().numberOfThreads = parallel::getNumberOfThreads( *m_ViewerCore->getSettings() );
+		image->synchronize();
+		image->updateColorMap();
+		m_ViewerCore->getUICore()->toggleLoadingIcon( false );
+		m_ViewerCore->emitImageContentChanged( image );
 	}
-
-	m_ViewerCore->getUICore()->toggleLoadingIcon( false );
 }
 
-std::vector<double> isis::viewer::operation::NativeImageOps::getHistogramFromImage ( const isis::viewer::ImageHolder::Pointer image )
+isis::viewer::Histogram isis::viewer::operation::NativeImageOps::getHistogramFromImage ( const isis::viewer::ImageHolder::Pointer image, const size_t &numberOfBins, const bool &omitZero )
 {
-	std::vector<double> histogram;
-	const size_t volume = image->getImageSize()[0] * image->getImageSize()[1] * image->getImageSize()[2];
-	const double extent = image->getInternalExtent();
+	const size_t timestep = image->getImageProperties().timestep;
+	const Histogram *cachedHistogram = image->getCachedHistogram( timestep, numberOfBins, omitZero );
 
-	const int32_t timestep = image->getImageProperties().voxelCoords[dim_time];
+	if( cachedHistogram ) {
+		return *cachedHistogram;
+	}
 
-	histogram.resize( extent );
+	if( image->getImageProperties().isRGB ) {
+		LOG( Runtime, warning ) << "Histograms of RGB images are not supported!";
+		return Histogram();
+	}
 
-	const InternalImageType *dataPtr = boost::shared_static_cast<const InternalImageType>( image->getRawAdress( timestep ) ).get();
+	const size_t volume = image->getImageSize()[0] * image->getImageSize()[1] * image->getImageSize()[2];
 
-	if( extent > 1e6 ) {
+	if( volume > 1e7 ) {
 		m_ViewerCore->getUICore()->toggleLoadingIcon( true, QString( "Calculating histogram for image " ) + image->getImageProperties().fileName.c_str() );
 	}
 
-	//create the histogram
-	for( size_t i = 0; i < volume; i++ ) {
-		if( dataPtr[i] > 0 ) {
-			histogram[dataPtr[i] - 1]++;
-		}
+	Histogram histogram;
+
+	switch( image->getImageProperties().majorTypeID ) {
+	case data::ValueArray<bool>::staticID:
+		histogram = internGetHistogram<bool>( image, timestep, numberOfBins, omitZero );
+		break;
+	case data::ValueArray<int8_t>::staticID:
+		histogram = internGetHistogram<int8_t>( image, timestep, numberOfBins, omitZero );
+		break;
+	case data::ValueArray<uint8_t>::staticID:
+		histogram = internGetHistogram<uint8_t>( image, timestep, numberOfBins, omitZero );
+		break;
+	case data::ValueArray<int16_t>::staticID:
+		histogram = internGetHistogram<int16_t>( image, timestep, numberOfBins, omitZero );
+		break;
+	case data::ValueArray<uint16_t>::staticID:
+		histogram = internGetHistogram<uint16_t>( image, timestep, numberOfBins, omitZero );
+		break;
+	case data::ValueArray<int32_t>::staticID:
+		histogram = internGetHistogram<int32_t>( image, timestep, numberOfBins, omitZero );
+		break;
+	case data::ValueArray<uint32_t>::staticID:
+		histogram = internGetHistogram<uint32_t>( image, timestep, numberOfBins, omitZero );
+		break;
+	case data::ValueArray<int64_t>::staticID:
+		histogram = internGetHistogram<int64_t>( image, timestep, numberOfBins, omitZero );
+		break;
+	case data::ValueArray<uint64_t>::staticID:
+		histogram = internGetHistogram<uint64_t>( image, timestep, numberOfBins, omitZero );
+		break;
+	case data::ValueArray<float>::staticID:
+		histogram = internGetHistogram<float>( image, timestep, numberOfBins, omitZero );
+		break;
+	case data::ValueArray<double>::staticID:
+		histogram = internGetHistogram<double>( image, timestep, numberOfBins, omitZero );
+		break;
+	default:
+		LOG( Runtime, error ) << "Histograms are not supported for " << image->getImageProperties().majorTypeName << " !";
 	}
 
+	image->cacheHistogram( timestep, numberOfBins, histogram );
 	m_ViewerCore->getUICore()->toggleLoadingIcon( false );
 	return histogram;
 }
 
+void isis::viewer::operation::NativeImageOps::addChunkToHistogram ( const unsigned short &typeID, const isis::viewer::ImageHolder::Pointer image, isis::viewer::Histogram &histogram, const size_t &first, const size_t &last )
+{
+	switch( typeID ) {
+	case data::ValueArray<bool>::staticID:
+		addToHistogram<bool>( image, histogram, first, last );
+		break;
+	case data::ValueArray<int8_t>::staticID:
+		addToHistogram<int8_t>( image, histogram, first, last );
+		break;
+	case data::ValueArray<uint8_t>::staticID:
+		addToHistogram<uint8_t>( image, histogram, first, last );
+		break;
+	case data::ValueArray<int16_t>::staticID:
+		addToHistogram<int16_t>( image, histogram, first, last );
+		break;
+	case data::ValueArray<uint16_t>::staticID:
+		addToHistogram<uint16_t>( image, histogram, first, last );
+		break;
+	case data::ValueArray<int32_t>::staticID:
+		addToHistogram<int32_t>( image, histogram, first, last );
+		break;
+	case data::ValueArray<uint32_t>::staticID:
+		addToHistogram<uint32_t>( image, histogram, first, last );
+		break;
+	case data::ValueArray<int64_t>::staticID:
+		addToHistogram<int64_t>( image, histogram, first, last );
+		break;
+	case data::ValueArray<uint64_t>::staticID:
+		addToHistogram<uint64_t>( image, histogram, first, last );
+		break;
+	case data::ValueArray<float>::staticID:
+		addToHistogram<float>( image, histogram, first, last );
+		break;
+	case data::ValueArray<double>::staticID:
+		addToHistogram<double>( image, histogram, first, last );
+		break;
+	default:
+		LOG( Runtime, error ) << "Histograms are not supported for chunks of type " << isis::util::getTypeMap( false, true ).at( typeID ) << " !";
+	}
+}
+
 
 
 void isis::viewer::operation::NativeImageOps::setViewerCore ( isis::viewer::QViewerCore *core )
@@ -36,6 +36,11 @@
 #include "qviewercore.hpp"
 #include "imageholder.hpp"
 #include "uicore.hpp"
+#include "parallel.hpp"
+#include "minmaxpyramid.hpp"
+#include <boost/function.hpp>
+#include <deque>
+#include <QAtomicInt>
 #include <DataStorage/image.hpp>
 
 namespace isis
@@ -50,10 +55,39 @@ class NativeImageOps
 	static isis::viewer::QViewerCore *m_ViewerCore;
 public:
 
-	static util::ivector4 getGlobalMin( const ImageHolder::Pointer image, const util::ivector4 &startPos, const unsigned short &radius );
-	static util::ivector4 getGlobalMax( const ImageHolder::Pointer image, const util::ivector4 &startPos, const unsigned short &radius );
+	///position and value of the minimum or maximum of the original image data
+	struct Extremum {
+		Extremum() : value( 0 ), valid( false ) {}
+		util::ivector4 position;
+		double value;
+		bool valid;
+	};
+	/**
+	 * Is called with the number of processed and the total number of steps.
+	 * Returning false cancels the search.
+	 */
+	typedef boost::function<bool ( size_t, size_t )> ProgressCallback;
+
+	/**
+	 * Searches the minimum of image in all timesteps. If radius is not 0 only a box of that radius around startPos is searched.
+	 * Only bricks of the min/max pyramids that may contain a better value are visited. If a pyramid can not be built, all voxels are scanned.
+	 * Ties are resolved in favour of the first voxel in memory order.
+	 * If progress is empty the progress is shown in the progress bar of the viewer.
+	 */
+	static Extremum getGlobalMin( const ImageHolder::Pointer image, const util::ivector4 &startPos, const unsigned short &radius, const ProgressCallback &progress = ProgressCallback() );
+	static Extremum getGlobalMax( const ImageHolder::Pointer image, const util::ivector4 &startPos, const unsigned short &radius, const ProgressCallback &progress = ProgressCallback() );
 	static void setTrueZero( ImageHolder::Pointer image );
-	static std::vector<double> getHistogramFromImage( const ImageHolder::Pointer image );
+	/**
+	 * Computes the histogram of the original data of the current volume of image.
+	 * Integer images get at most one bin per value. The result is cached until the content of the image changes.
+	 */
+	static Histogram getHistogramFromImage( const ImageHolder::Pointer image, const size_t &numberOfBins, const bool &omitZero );
+
+	/**
+	 * Returns the min/max pyramid of the volume timestep of image. It is built on first request and kept until the content of the image changes.
+	 * Besides the extremum search it can be used to skip bricks without visible values when rendering.
+	 */
+	static MinMaxPyramid::Pointer getMinMaxPyramid( const ImageHolder::Pointer image, const size_t &timestep );
 
 	static std::pair<double, double> getMinMaxFromScalingOffset( const std::pair<double, double> &scalingOffset, const ImageHolder::Pointer image );
 	static std::pair<double, double> getScalingOffsetFromMinMax( const std::pair<double, double> &minMax, const ImageHolder::Pointer image );
@@ -63,125 +97,246 @@ public:
 private:
 
 	template<typename TYPE>
-	static util::ivector4 internGetMin( const ImageHolder::Pointer image, const util::ivector4 &startPos, const unsigned short &radius ) {
-		const util::ivector4 size = image->getImageSize();
-		util::ivector4 start;
-		util::ivector4 end;
+	struct HistogramOp {
+		HistogramOp( const std::vector< TypedSegment<TYPE> > &_segments, const Histogram &_histogram, const unsigned short &numberOfThreads )
+			: segments( _segments ),
+			  histogram( _histogram ),
+			  inverseBinWidth( 1. / _histogram.binWidth ),
+			  subHistograms( numberOfThreads, std::vector<size_t>( _histogram.bins.size(), 0 ) ) {}
+		void operator()( const size_t &first, const size_t &last, const unsigned short &threadIndex ) {
+			RunOp runOp = { this, &subHistograms[threadIndex][0] };
+			forEachRun( segments, first, last, runOp );
+		}
+		struct RunOp {
+			HistogramOp *parent;
+			size_t *histogram;
+			void operator()( const TYPE *begin, const size_t &length ) {
+				for( const TYPE *iter = begin; iter < begin + length; iter++ ) {
+					const double value = static_cast<double>( *iter );
+
+					if( parent->histogram.counts( value ) ) {
+						histogram[parent->histogram.getBin( value, parent->inverseBinWidth )]++;
+					}
+				}
+			}
+		};
+		const std::vector< TypedSegment<TYPE> > &segments;
+		const Histogram &histogram;
+		const double inverseBinWidth;
+		std::vector< std::vector<size_t> > subHistograms;
+	};
 
-		if( radius ) {
-			for( size_t i = 0; i < 3; i++ ) {
-				start[i] = ( startPos[i] - radius ) < 0 ? 0 : startPos[i] - radius;
-				end[i] = ( startPos[i] + radius ) > size[i] ? size[i] : startPos[i] + radius;
+	template<typename TYPE>
+	static Histogram internGetHistogram( const ImageHolder::Pointer image, const size_t &timestep, const size_t &numberOfBins, const bool &omitZero ) {
+		Histogram histogram;
+		histogram.initialize( image->getImageProperties().minMax.first->as<double>(), image->getImageProperties().minMax.second->as<double>(),
+							  numberOfBins, std::numeric_limits<TYPE>::is_integer, omitZero );
+		const size_t volume = image->getImageSize()[0] * image->getImageSize()[1] * image->getImageSize()[2];
+
+		if( image->hasChunksOfType<TYPE>() ) {
+			addToHistogram<TYPE>( image, histogram, timestep * volume, ( timestep + 1 ) * volume );
+			return histogram;
+		}
+
+		//every chunk is read in its own type, so the volume is never converted into a copy
+		size_t offset = 0;
+		BOOST_FOREACH( std::vector<data::Chunk>::const_reference chunk, image->getChunkVector() ) {
+			const size_t first = std::max( offset, timestep * volume );
+			const size_t last = std::min( offset + chunk.getVolume(), ( timestep + 1 ) * volume );
+
+			if( first < last ) {
+				addChunkToHistogram( chunk.getTypeID(), image, histogram, first, last );
 			}
 
-			end[3] = size[3];
-			start[3] = 0;
-		} else {
-			start = util::ivector4( 0, 0, 0, 0 );
-			end = size;
+			offset += chunk.getVolume();
 		}
+		return histogram;
+	}
 
-		util::ivector4 currentPos;
-		TYPE currentValue;
-		data::TypedImage<TYPE> typedImage = *image->getISISImage();
-		TYPE currentMin = std::numeric_limits<TYPE>::max();
-		m_ViewerCore->getProgressFeedback()->show( ( end[2] - start[2] ) * ( end[3] - start[3] ), "Searching minimum..." );
+	///adds the voxels [first, last) of the whole image to histogram. The chunks of these voxels have to be of TYPE.
+	template<typename TYPE>
+	static void addToHistogram( const ImageHolder::Pointer image, Histogram &histogram, const size_t &first, const size_t &last ) {
+		const std::vector< TypedSegment<TYPE> > segments = image->getTypedSegments<TYPE>( first, last );
+		//every thread fills its own histogram which are summed up afterwards
+		HistogramOp<TYPE> op( segments, histogram, parallel::getNumberOfThreads( *m_ViewerCore->getSettings() ) );
+		histogram.add( op.subHistograms, parallel::forEachRange( 0, last - first, op, op.subHistograms.size(), 1 << 16 ) );
+	}
+	///calls addToHistogram for the type typeID of the chunk holding the voxels [first, last)
+	static void addChunkToHistogram( const unsigned short &typeID, const ImageHolder::Pointer image, Histogram &histogram, const size_t &first, const size_t &last );
 
-		for( int32_t t = start[3]; t < end[3]; t++ ) {
-			for( int32_t z = start[2]; z < end[2]; z++ ) {
-				m_ViewerCore->getProgressFeedback()->progress();
+	template<typename TYPE>
+	static MinMaxPyramid::Pointer internGetMinMaxPyramid( const ImageHolder::Pointer image, const size_t &timestep ) {
+		MinMaxPyramid::Pointer pyramid = image->getMinMaxPyramid( timestep );
 
-				for( int32_t y = start[1]; y < end[1]; y++ ) {
-					for( int32_t x = start[0]; x < end[0]; x++ ) {
-						currentValue = static_cast<data::Image &>( typedImage ).voxel<TYPE>( x, y, z, t );
+		if( !pyramid ) {
+			pyramid.reset( new MinMaxPyramid( image->getTypedSegments<TYPE>( timestep ), image->getImageSize(), parallel::getNumberOfThreads( *m_ViewerCore->getSettings() ) ) );
+			image->setMinMaxPyramid( timestep, pyramid );
+		}
 
-						if( currentValue < currentMin ) {
-							currentPos = util::ivector4( x, y, z, t );
-							currentMin = currentValue;
-						}
+		return pyramid;
+	}
+
+	///scans every voxel of the search box, which is used if the volumes are not stored in whole rows and no pyramid can be built
+	template<typename TYPE, bool MAXIMUM>
+	struct ExtremumOp {
+		ExtremumOp( const std::vector< std::vector< TypedSegment<TYPE> > > &_segments, const util::ivector4 &_start, const util::ivector4 &_end,
+					const util::ivector4 &_size, const ProgressCallback &_progress, const unsigned short &numberOfThreads )
+			: segments( _segments ), start( _start ), end( _end ), size( _size ), progress( _progress ),
+			  bestValues( numberOfThreads ), bestIndices( numberOfThreads ), found( numberOfThreads, false ),
+			  numberOfItems( ( _end[2] - _start[2] ) * ( _end[3] - _start[3] ) ), callerIndex( numberOfThreads - 1 ) {}
+
+		///every item is one slice (z,t) of the search box
+		void operator()( const size_t &first, const size_t &last, const unsigned short &threadIndex ) {
+			const size_t sliceSize = size[0] * size[1];
+			const int32_t slices = end[2] - start[2];
+			const bool wholeRows = start[0] == 0 && end[0] == size[0];
+			ExtremumRunOp<TYPE, MAXIMUM> runOp = { 0, bestValues[threadIndex], bestIndices[threadIndex], found[threadIndex] };
+
+			for( size_t item = first; item < last && !cancelled; item++ ) {
+				const int32_t t = start[3] + item / slices;
+				const int32_t z = start[2] + item % slices;
+				const size_t volumeOffset = t * sliceSize * size[2];
+
+				if( wholeRows ) {
+					const size_t from = z * sliceSize + start[1] * size[0];
+					runOp.position = volumeOffset + from;
+					forEachRun( segments[t], from, from + ( end[1] - start[1] ) * size[0], runOp );
+				} else {
+					for( int32_t y = start[1]; y < end[1]; y++ ) {
+						const size_t from = z * sliceSize + y * size[0] + start[0];
+						runOp.position = volumeOffset + from;
+						forEachRun( segments[t], from, from + end[0] - start[0], runOp );
 					}
 				}
+
+				done.ref();
+
+				//only the calling thread reports the progress
+				if( threadIndex == callerIndex && progress && !progress( done, numberOfItems ) ) {
+					cancelled = 1;
+				}
 			}
 		}
 
-		m_ViewerCore->getUICore()->toggleLoadingIcon( false );
-		return currentPos;
-	}
-
-	template<typename TYPE>
-	static util::ivector4 internGetMax( const ImageHolder::Pointer image, const util::ivector4 &startPos, const unsigned short &radius ) {
+		const std::vector< std::vector< TypedSegment<TYPE> > > &segments;
+		const util::ivector4 start;
+		const util::ivector4 end;
+		const util::ivector4 size;
+		const ProgressCallback &progress;
+		std::deque<TYPE> bestValues;
+		std::vector<size_t> bestIndices;
+		std::deque<bool> found;
+		const size_t numberOfItems;
+		const unsigned short callerIndex;
+		QAtomicInt done;
+		QAtomicInt cancelled;
+	};
+
+	template<typename TYPE, bool MAXIMUM>
+	static Extremum internGetExtremum( const ImageHolder::Pointer image, const util::ivector4 &startPos, const unsigned short &radius, const ProgressCallback &progress ) {
 		const util::ivector4 size = image->getImageSize();
-		util::ivector4 start;
-		util::ivector4 end;
+		const size_t volume = size[0] * size[1] * size[2];
+		const unsigned short numberOfThreads = parallel::getNumberOfThreads( *m_ViewerCore->getSettings() );
+		util::ivector4 start( 0, 0, 0, 0 );
+		util::ivector4 end = size;
 
 		if( radius ) {
 			for( size_t i = 0; i < 3; i++ ) {
 				start[i] = ( startPos[i] - radius ) < 0 ? 0 : startPos[i] - radius;
 				end[i] = ( startPos[i] + radius ) > size[i] ? size[i] : startPos[i] + radius;
 			}
+		}
 
-			end[3] = size[3];
-			start[3] = 0;
-		} else {
-			start = util::ivector4( 0, 0, 0, 0 );
-			end = size;
+		//the pyramids are built once per content revision, afterwards a search only visits a few bricks
+		std::vector< std::pair<double, int32_t> > volumes;
+		bool pyramidsValid = true;
+
+		for( int32_t t = 0; t < size[3]; t++ ) {
+			const MinMaxPyramid::Pointer pyramid = internGetMinMaxPyramid<TYPE>( image, t );
+			pyramidsValid = pyramidsValid && pyramid->isValid();
+			volumes.push_back( std::make_pair( MAXIMUM ? -pyramid->getMax() : pyramid->getMin(), t ) );
+
+			if( progress && !progress( t + 1, 2 * size[3] ) ) {
+				LOG( Runtime, info ) << "Search of " << ( MAXIMUM ? "maximum" : "minimum" ) << " has been cancelled.";
+				return Extremum();
+			}
 		}
 
-		util::ivector4 currentPos;
-		TYPE currentValue;
-		data::TypedImage<TYPE> typedImage = *image->getISISImage();
-		TYPE currentMax = -std::numeric_limits<TYPE>::max();
+		TYPE best = TYPE();
+		size_t bestIndex = 0;
+		bool found = false;
 
-		m_ViewerCore->getProgressFeedback()->show( ( end[2] - start[2] ) * ( end[3] - start[3] ), "Searching maximum..." );
+		if( pyramidsValid ) {
+			//search the volumes with the most promising extremum first
+			std::sort( volumes.begin(), volumes.end() );
 
-		for( int32_t t = start[3]; t < end[3]; t++ ) {
-			for( int32_t z = start[2]; z < end[2]; z++ ) {
-				m_ViewerCore->getProgressFeedback()->progress();
+			for( size_t i = 0; i < volumes.size(); i++ ) {
+				const int32_t t = volumes[i].second;
+				const MinMaxPyramid::Pointer pyramid = image->getMinMaxPyramid( t );
+				const double bound = MAXIMUM ? pyramid->getMax() : pyramid->getMin();
 
-				for( int32_t y = start[1]; y < end[1]; y++ ) {
-					for( int32_t x = start[0]; x < end[0]; x++ ) {
-						currentValue = static_cast<data::Image &>( typedImage ).voxel<TYPE>( x, y, z, t );
+				if( found && ExtremumRunOp<double, MAXIMUM>::isBetter( best, bound ) ) {
+					break;
+				}
 
-						if( currentValue > currentMax ) {
-							currentPos = util::ivector4( x, y, z, t );
-							currentMax = currentValue;
-						}
-					}
+				//an equal value only wins if it comes first in memory order
+				if( !found || bound != best || t * volume < bestIndex ) {
+					pyramid->findExtremum<TYPE, MAXIMUM>( image->getTypedSegments<TYPE>( t ), start, end, best, bestIndex, found, t * volume, numberOfThreads );
+				}
+
+				if( progress && !progress( size[3] + i + 1, 2 * size[3] ) ) {
+					LOG( Runtime, info ) << "Search of " << ( MAXIMUM ? "maximum" : "minimum" ) << " has been cancelled.";
+					return Extremum();
 				}
 			}
-		}
+		} else {
+			LOG( Dev, info ) << "No min/max pyramid available, scanning all voxels";
+			std::vector< std::vector< TypedSegment<TYPE> > > segments;
 
-		m_ViewerCore->getUICore()->toggleLoadingIcon( false );
-		return currentPos;
-	}
+			for( int32_t t = 0; t < size[3]; t++ ) {
+				segments.push_back( image->getTypedSegments<TYPE>( t ) );
+			}
 
+			ExtremumOp<TYPE, MAXIMUM> op( segments, start, end, size, progress, numberOfThreads );
+			const unsigned short parts = parallel::forEachRange( 0, op.numberOfItems, op, op.bestValues.size() );
 
-	template<typename TYPE>
-	static void _setTrueZero( ImageHolder::Pointer image ) {
-		LOG( Dev, info ) << "Setting true zero for " << image->getImageProperties().fileName;
-		image->getImageProperties().zeroIsReserved = true;
-		// first make shure the images datatype is consistent
-		data::TypedImage<TYPE> tImage ( *image->getISISImage() );
-		//now set all voxels to the m_ReservedValue that are 0 in the origin image
-		m_ViewerCore->getProgressFeedback()->show( image->getImageSize()[2] * image->getImageSize()[3], "Setting 0 to black..." );
-
-		for( size_t t = 0; t < image->getImageSize()[3]; t++ ) {
-			for( size_t z = 0; z < image->getImageSize()[2]; z++ ) {
-				m_ViewerCore->getProgressFeedback()->progress();
-
-				for( size_t y = 0; y < image->getImageSize()[1]; y++ ) {
-					for( size_t x = 0; x < image->getImageSize()[0]; x++ ) {
-						if( static_cast<data::Image &>( tImage ).voxel<TYPE>( x, y, z, t ) == static_cast<TYPE>( 0 ) ) {
-							image->getVolumeVector()[t].voxel<InternalImageType>( x, y, z ) = 0;
-						}
-					}
+			if( op.cancelled ) {
+				LOG( Runtime, info ) << "Search of " << ( MAXIMUM ? "maximum" : "minimum" ) << " has been cancelled.";
+				return Extremum();
+			}
+
+			//ties are resolved in favour of the first voxel in memory order
+			for( unsigned short t = 0; t < parts; t++ ) {
+				if( op.found[t] && ( !found || ExtremumRunOp<TYPE, MAXIMUM>::isBetter( op.bestValues[t], best )
+									 || ( op.bestValues[t] == best && op.bestIndices[t] < bestIndex ) ) ) {
+					best = op.bestValues[t];
+					bestIndex = op.bestIndices[t];
+					found = true;
 				}
 			}
 		}
 
-		m_ViewerCore->emitImageContentChanged( image );
+		Extremum extremum;
+
+		if( found ) {
+			extremum.valid = true;
+			extremum.value = static_cast<double>( best );
+			extremum.position[0] = bestIndex % size[0];
+			extremum.position[1] = ( bestIndex / size[0] ) % size[1];
+			extremum.position[2] = ( bestIndex / ( size[0] * size[1] ) ) % size[2];
+			extremum.position[3] = bestIndex / volume;
+		}
+
+		return extremum;
+	}
 
+	template<typename TYPE>
+	static Extremum internGetExtremum( const ImageHolder::Pointer image, const util::ivector4 &startPos, const unsigned short &radius, const ProgressCallback &progress, const bool &maximum ) {
+		return maximum ? internGetExtremum<TYPE, true>( image, startPos, radius, progress ) : internGetExtremum<TYPE, false>( image, startPos, radius, progress );
 	}
+
+	static Extremum getGlobalExtremum( const ImageHolder::Pointer image, const util::ivector4 &startPos, const unsigned short &radius, const ProgressCallback &progress, const bool &maximum );
+
 };
 
 
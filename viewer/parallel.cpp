@@ -0,0 +1,53 @@
+/****************************************************************
+ *
+ * <Copyright information>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *
+ * parallel.cpp
+ *
+ * Description:
+ *
+ *  Created on: Oct 19, 2026
+ ******************************************************************/
+#include "parallel.hpp"
+#include "settings.hpp"
+
+namespace isis
+{
+namespace viewer
+{
+namespace parallel
+{
+
+unsigned short getNumberOfThreads ( const Settings &settings )
+{
+	if( !settings.getPropertyAs<bool>( "enableMultithreading" ) ) {
+		return 1;
+	}
+
+	const uint16_t numberOfThreads = settings.getPropertyAs<uint16_t>( "numberOfThreads" );
+
+	if( settings.getPropertyAs<bool>( "useAllAvailableThreads" ) || !numberOfThreads ) {
+		return std::max<unsigned short>( 1, boost::thread::hardware_concurrency() );
+	}
+
+	return numberOfThreads;
+}
+
+}
+}
+}
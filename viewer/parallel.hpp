@@ -0,0 +1,75 @@
+/****************************************************************
+ *
+ * <Copyright information>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *
+ * parallel.hpp
+ *
+ * Description:
+ *
+ *  Created on: Oct 19, 2026
+ ******************************************************************/
+#ifndef VAST_PARALLEL_HPP
+#define VAST_PARALLEL_HPP
+
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include <algorithm>
+
+namespace isis
+{
+namespace viewer
+{
+class Settings;
+namespace parallel
+{
+
+///returns the number of threads according to the settings "enableMultithreading", "useAllAvailableThreads" and "numberOfThreads"
+unsigned short getNumberOfThreads( const Settings &settings );
+
+/**
+ * Splits the range [begin, end) in at most numberOfThreads contiguous parts and calls op( partBegin, partEnd, threadIndex )
+ * for each part in its own thread. The last part is processed by the calling thread.
+ * Returns the number of parts, so the caller knows how many per-thread results it has to merge.
+ */
+template<typename OP>
+unsigned short forEachRange( const size_t &begin, const size_t &end, OP &op, const unsigned short &numberOfThreads, const size_t &minRangeSize = 1 )
+{
+	if( end <= begin ) {
+		return 0;
+	}
+
+	const size_t length = end - begin;
+	const size_t maxParts = std::max<size_t>( 1, length / std::max<size_t>( 1, minRangeSize ) );
+	const unsigned short parts = static_cast<unsigned short>( std::min<size_t>( std::max<unsigned short>( 1, numberOfThreads ), maxParts ) );
+	const size_t partSize = length / parts;
+	boost::thread_group threads;
+
+	for( unsigned short i = 0; i < parts - 1; i++ ) {
+		threads.create_thread( boost::bind<void>( boost::ref( op ), begin + i * partSize, begin + ( i + 1 ) * partSize, i ) );
+	}
+
+	op( begin + ( parts - 1 ) * partSize, end, parts - 1 );
+	threads.join_all();
+	return parts;
+}
+
+}
+}
+}
+
+#endif // VAST_PARALLEL_HPP
@@ -29,6 +29,7 @@
 #include <DataStorage/io_factory.hpp>
 #include <DataStorage/fileptr.hpp>
 #include "nativeimageops.hpp"
+#include "editjournal.hpp"
 #include "uicore.hpp"
 #include "mainwindow.hpp"
 
@@ -456,6 +457,7 @@ void QViewerCore::closeImage ( ImageHolder::Pointer image, bool refreshUI )
 		ensemble->removeImage( image );
 	}
 
+	util::Singletons::get<EditJournal, 10>().forget( image.get() );
 	const bool ok = removeImage( image );
 
 	if( ok ) {
@@ -0,0 +1,95 @@
+/****************************************************************
+ *
+ * <Copyright information>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *
+ * runlengthvolume.cpp
+ *
+ * Description:
+ *
+ *  Created on: Oct 19, 2026
+ ******************************************************************/
+#include "runlengthvolume.hpp"
+#include <boost/foreach.hpp>
+#include <algorithm>
+
+namespace isis
+{
+namespace viewer
+{
+namespace
+{
+bool startsBefore( const size_t &index, const RunLengthVolume::Run &run ) { return index < run.first; }
+}
+
+RunLengthVolume::Encoder::Encoder( RunLengthVolume &volume, const size_t &z )
+	: m_Volume( volume ), m_Slice( volume.m_Slices[z] ), m_Index( 0 )
+{
+	m_Volume.m_NumberOfRuns -= m_Slice.size();
+	m_Slice.clear();
+}
+
+RunLengthVolume::Encoder::~Encoder()
+{
+	//the slices are kept for a long time, so they should not waste memory
+	Slice( m_Slice ).swap( m_Slice );
+}
+
+RunLengthVolume::RunLengthVolume( const size_t &sizeX, const size_t &sizeY, const size_t &sizeZ )
+	: m_SliceSize( sizeX * sizeY ), m_Slices( sizeZ ), m_NumberOfRuns( 0 )
+{}
+
+InternalImageType RunLengthVolume::getVoxel( const size_t &index ) const
+{
+	const Slice &slice = m_Slices[index / m_SliceSize];
+	const size_t indexInSlice = index % m_SliceSize;
+	Slice::const_iterator run = std::upper_bound( slice.begin(), slice.end(), indexInSlice, startsBefore );
+
+	if( run == slice.begin() ) {
+		return 0;
+	}
+
+	--run;
+	return indexInSlice < run->first + run->length ? run->value : 0;
+}
+
+void RunLengthVolume::expandSlice( const size_t &z, InternalImageType *dest ) const
+{
+	std::fill( dest, dest + m_SliceSize, 0 );
+	BOOST_FOREACH( Slice::const_reference run, m_Slices[z] ) {
+		std::fill( dest + run.first, dest + run.first + run.length, run.value );
+	}
+}
+
+void RunLengthVolume::expand( InternalImageType *dest ) const
+{
+	for( size_t z = 0; z < m_Slices.size(); z++ ) {
+		expandSlice( z, dest + z * m_SliceSize );
+	}
+}
+
+size_t RunLengthVolume::getMemorySize() const
+{
+	size_t size = m_Slices.capacity() * sizeof( Slice );
+	BOOST_FOREACH( std::vector<Slice>::const_reference slice, m_Slices ) {
+		size += slice.capacity() * sizeof( Run );
+	}
+	return size;
+}
+
+}
+}
@@ -0,0 +1,121 @@
+/****************************************************************
+ *
+ * <Copyright information>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *
+ * runlengthvolume.hpp
+ *
+ * Description: run length encoded internal representation of sparse volumes like masks
+ *
+ *  Created on: Oct 19, 2026
+ ******************************************************************/
+#ifndef VAST_RUNLENGTHVOLUME_HPP
+#define VAST_RUNLENGTHVOLUME_HPP
+
+#include "common.hpp"
+#include <boost/shared_ptr.hpp>
+#include <vector>
+
+namespace isis
+{
+namespace viewer
+{
+
+/**
+ * Internal representation of a volume that consists of a few runs of equal voxels, e.g. a mask.
+ * Every slice (z) holds the runs of its non-zero voxels in memory order, so single voxels and slices
+ * of any orientation can be read without expanding the volume.
+ */
+class RunLengthVolume
+{
+public:
+	typedef boost::shared_ptr<RunLengthVolume> Pointer;
+
+	///a run of equal voxels, first is the index of its first voxel inside the slice
+	struct Run {
+		uint32_t first;
+		uint32_t length;
+		InternalImageType value;
+	};
+	typedef std::vector<Run> Slice;
+
+	///replaces the runs of slice z by the voxels pushed in memory order, voxels that are 0 are not stored
+	class Encoder
+	{
+	public:
+		Encoder( RunLengthVolume &volume, const size_t &z );
+		~Encoder();
+		void push( const InternalImageType &value ) {
+			if( value ) {
+				if( !m_Slice.empty() && m_Slice.back().value == value && m_Slice.back().first + m_Slice.back().length == m_Index ) {
+					m_Slice.back().length++;
+				} else {
+					const Run run = { m_Index, 1, value };
+					m_Slice.push_back( run );
+					m_Volume.m_NumberOfRuns++;
+				}
+			}
+
+			m_Index++;
+		}
+	private:
+		RunLengthVolume &m_Volume;
+		Slice &m_Slice;
+		uint32_t m_Index;
+	};
+
+	RunLengthVolume( const size_t &sizeX, const size_t &sizeY, const size_t &sizeZ );
+
+	///returns the voxel at index (in memory order) of the volume
+	InternalImageType getVoxel( const size_t &index ) const;
+	///writes the m_SliceSize voxels of slice z to dest
+	void expandSlice( const size_t &z, InternalImageType *dest ) const;
+	///writes all voxels to dest
+	void expand( InternalImageType *dest ) const;
+
+	size_t getSliceSize() const { return m_SliceSize; }
+	size_t getNumberOfRuns() const { return m_NumberOfRuns; }
+	///returns the memory used by the runs in bytes
+	size_t getMemorySize() const;
+
+private:
+	size_t m_SliceSize;
+	std::vector<Slice> m_Slices;
+	size_t m_NumberOfRuns;
+};
+
+/**
+ * Returns the voxel at index of runs as TYPE. Only images of InternalImageType are run length encoded,
+ * the other types are only needed to instantiate readers that handle both kinds of volumes.
+ */
+template<typename TYPE>
+TYPE getEncodedVoxel( const RunLengthVolume &/*runs*/, const size_t &/*index*/ )
+{
+	LOG( Dev, error ) << "Only volumes of the internal type are run length encoded.";
+	return TYPE();
+}
+
+template<>
+inline InternalImageType getEncodedVoxel<InternalImageType>( const RunLengthVolume &runs, const size_t &index )
+{
+	return runs.getVoxel( index );
+}
+
+}
+}
+
+#endif // VAST_RUNLENGTHVOLUME_HPP
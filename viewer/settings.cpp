@@ -67,8 +67,10 @@ void Settings::save()
 	m_QSettings->setValue ( "showCrashMessage", getPropertyAs<bool> ( "showCrashMessage" ) );
 	m_QSettings->setValue ( "numberOfThreads", getPropertyAs<uint16_t> ( "numberOfThreads" ) );
 	m_QSettings->setValue ( "enableMultithreading", getPropertyAs<bool> ( "enableMultithreading" ) );
-	m_QSettings->setValue ( "useAllAvailablethreads", getPropertyAs<bool> ( "useAllAvailableThreads" ) );
+	m_QSettings->setValue ( "useAllAvailableThreads", getPropertyAs<bool> ( "useAllAvailableThreads" ) );
 	m_QSettings->setValue ( "histogramOmitZero", getPropertyAs<bool> ( "histogramOmitZero" ) );
+	m_QSettings->setValue ( "histogramBins", getPropertyAs<uint16_t> ( "histogramBins" ) );
+	m_QSettings->setValue ( "histogramLogScale", getPropertyAs<bool> ( "histogramLogScale" ) );
 	m_QSettings->setValue ( "defaultViewWidgetIdentifier", getPropertyAs<std::string>( "defaultViewWidgetIdentifier" ).c_str() );
 	m_QSettings->setValue ( "styleSheet", getPropertyAs<std::string>( "styleSheet" ).c_str() );
 	//screenshot stuff
@@ -113,10 +115,12 @@ void Settings::load()
 	setPropertyAs<bool> ( "showFavoriteFileList", m_QSettings->value ( "showFavoriteFileList", false ).toBool() );
 	setPropertyAs<bool> ( "showStartWidget", m_QSettings->value ( "showStartWidget", true ).toBool() );
 	setPropertyAs<bool> ( "showCrashMessage", m_QSettings->value ( "showCrashMessage", true ).toBool() );
-	setPropertyAs<uint16_t> ( "numberOfThreads", m_QSettings->value ( "numberOfThreads" ).toUInt() );
-	setPropertyAs<bool> ( "enableMultithreading", m_QSettings->value ( "enableMultithreading" ).toBool() );
-	setPropertyAs<bool> ( "useAllAvailablethreads", m_QSettings->value ( "useAllAvailableThreads" ).toBool() );
-	setPropertyAs<bool> ( "histogramOmitZero", m_QSettings->value ( "histogramOmitZero" ).toBool() );
+	setPropertyAs<uint16_t> ( "numberOfThreads", m_QSettings->value ( "numberOfThreads", getPropertyAs<uint16_t>( "numberOfThreads" ) ).toUInt() );
+	setPropertyAs<bool> ( "enableMultithreading", m_QSettings->value ( "enableMultithreading", getPropertyAs<bool>( "enableMultithreading" ) ).toBool() );
+	setPropertyAs<bool> ( "useAllAvailableThreads", m_QSettings->value ( "useAllAvailableThreads", getPropertyAs<bool>( "useAllAvailableThreads" ) ).toBool() );
+	setPropertyAs<bool> ( "histogramOmitZero", m_QSettings->value ( "histogramOmitZero", getPropertyAs<bool>( "histogramOmitZero" ) ).toBool() );
+	setPropertyAs<uint16_t> ( "histogramBins", m_QSettings->value ( "histogramBins", getPropertyAs<uint16_t>( "histogramBins" ) ).toUInt() );
+	setPropertyAs<bool> ( "histogramLogScale", m_QSettings->value ( "histogramLogScale", getPropertyAs<bool>( "histogramLogScale" ) ).toBool() );
 	setPropertyAs<bool>( "visualizeOnlyFirstVista", m_QSettings->value( "visualizeOnlyFirstVista", getPropertyAs<bool>( "visualizeOnlyFirstVista" ) ).toBool() );
 	setPropertyAs<std::string>( "defaultViewWidgetIdentifier", m_QSettings->value( "defaultViewWidgetIdentifier", getPropertyAs<std::string>( "defaultViewWidgetIdentifier" ).c_str() ).toString().toStdString() );
 	setPropertyAs<std::string>( "styleSheet", m_QSettings->value( "styleSheet", getPropertyAs<std::string>( "styleSheet" ).c_str() ).toString().toStdString() );
@@ -183,8 +187,15 @@ void Settings::initializeWithDefaultSettings()
 	setPropertyAs<std::string>( "lutStructural", "standard_grey_values" );
 	setPropertyAs<std::string>( "lutZMap", "standard_zmap" );
 	//misc
-	setPropertyAs<uint16_t>( "timeseriesPlayDelayTime", 50 );
+	setPropertyAs<uint16_t>( "timeseriesPlayFPS", 20 );
+	setPropertyAs<uint16_t>( "timeseriesPrefetchSteps", 2 );
 	setPropertyAs<bool>( "histogramOmitZero", true );
+	setPropertyAs<uint16_t>( "histogramBins", 256 );
+	setPropertyAs<bool>( "histogramLogScale", false );
+	//multithreading
+	setPropertyAs<bool>( "enableMultithreading", true );
+	setPropertyAs<bool>( "useAllAvailableThreads", true );
+	setPropertyAs<uint16_t>( "numberOfThreads", 0 );
 	setPropertyAs<uint16_t>( "maxRecentOpenListSize", 10 );
 
 	setPropertyAs<std::string>( "vastSymbol", std::string( ":/common/vast.png" ) );
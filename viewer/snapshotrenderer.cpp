@@ -0,0 +1,303 @@
+/****************************************************************
+ *
+ * <Copyright information>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *
+ * snapshotrenderer.cpp
+ *
+ * Description:
+ *
+ *  Created on: Oct 19, 2026
+ ******************************************************************/
+#include "snapshotrenderer.hpp"
+#include "memoryhandler.hpp"
+#include <DataStorage/io_factory.hpp>
+#include <boost/filesystem.hpp>
+#include <numeric>
+#include <QTime>
+
+namespace isis
+{
+namespace viewer
+{
+
+bool SnapshotRenderer::parseView( const std::string &spec, View &view )
+{
+	const std::string::size_type colon = spec.find( ':' );
+	const std::string orientation = spec.substr( 0, colon );
+
+	if( orientation == "axial" ) {
+		view.orientation = axial;
+	} else if( orientation == "sagittal" ) {
+		view.orientation = sagittal;
+	} else if( orientation == "coronal" ) {
+		view.orientation = coronal;
+	} else {
+		return false;
+	}
+
+	view.name = orientation;
+	view.center = colon == std::string::npos;
+
+	if( !view.center ) {
+		const std::list<float> coords = util::stringToList<float>( spec.substr( colon + 1 ), boost::regex( "," ) );
+
+		if( coords.size() != 3 ) {
+			return false;
+		}
+
+		std::copy( coords.begin(), coords.end(), &view.physicalCoords[0] );
+		BOOST_FOREACH( std::list<float>::const_reference coord, coords ) {
+			std::stringstream name;
+			name << "_" << coord;
+			view.name += name.str();
+		}
+	}
+
+	return true;
+}
+
+QImage SnapshotRenderer::render( const ImageHolder::Vector &images, const PlaneOrientation &orientation ) const
+{
+	if( images.empty() ) {
+		return QImage();
+	}
+
+	//the snapshot has the physical aspect ratio of the slice of the first image
+	const ImageHolder::Pointer reference = images.front();
+	const util::ivector4 size = reference->getImageSize();
+	const util::fvector3 mappedSize = mapCoordsToOrientation( util::fvector3( size[0], size[1], size[2] ), reference->getImageProperties().latchedOrientation, orientation );
+	const util::fvector3 mappedScaling = mapCoordsToOrientation( reference->getImageProperties().voxelSize, reference->getImageProperties().latchedOrientation, orientation );
+	const util::fvector3 physSize = mappedScaling * mappedSize;
+	const float scale = m_Size / std::max( physSize[0], physSize[1] );
+
+	QImage snapshot( std::max<int>( 1, round( physSize[0] * scale ) ), std::max<int>( 1, round( physSize[1] * scale ) ), QImage::Format_RGB32 );
+	snapshot.fill( qRgb( 0, 0, 0 ) );
+	QPainter painter( &snapshot );
+	const ImageHolder::ImageType order[] = { ImageHolder::structural_image, ImageHolder::statistical_image };
+
+	for( unsigned short i = 0; i < 2; i++ ) {
+		BOOST_FOREACH( ImageHolder::Vector::const_reference image, images ) {
+			if( image->getImageProperties().imageType == order[i] && image->getImageProperties().isVisible ) {
+				paintSlice( painter, image, orientation );
+			}
+		}
+	}
+
+	painter.end();
+	return snapshot;
+}
+
+void SnapshotRenderer::paintSlice( QPainter &painter, const ImageHolder::Pointer image, const PlaneOrientation &orientation )
+{
+	const util::Matrix3x3<float> &latchedOrientation = image->getImageProperties().latchedOrientation;
+	const util::ivector4 mappedSize = mapCoordsToOrientation( image->getImageSize(), latchedOrientation, orientation );
+	const util::ivector4 mappedSizeAligned = mapCoordsToOrientation( image->getImageProperties().alignedSize32, latchedOrientation, orientation );
+	const util::fvector3 mappedScaling = mapCoordsToOrientation( image->getImageProperties().voxelSize, latchedOrientation, orientation );
+	const util::fvector4 flipVec = mapCoordsToOrientation( util::fvector4( 1, 1, 1 ), latchedOrientation, orientation, false, false );
+
+	//centered and scaled to fit like QOrientationHandler::getViewPort and getTransform do it for the widgets
+	const float width = painter.device()->width();
+	const float height = painter.device()->height();
+	const float scale = std::min( width / ( mappedScaling[0] * mappedSize[0] ), height / ( mappedScaling[1] * mappedSize[1] ) );
+	const float scaleX = mappedScaling[0] * scale;
+	const float scaleY = mappedScaling[1] * scale;
+	QTransform transform( flipVec[0], 0, 0, flipVec[1], 0, 0 );
+	transform.translate( flipVec[0] * ( width - mappedSize[0] * scaleX ) / 2, flipVec[1] * ( height - mappedSize[1] * scaleY ) / 2 );
+	transform.scale( scaleX, scaleY );
+	transform.translate( flipVec[0] < 0 ? -mappedSize[0] : 0, flipVec[1] < 0 ? -mappedSize[1] : 0 );
+
+	painter.setTransform( transform );
+	painter.setOpacity( image->getImageProperties().opacity );
+	painter.setRenderHint( QPainter::SmoothPixmapTransform, image->getImageProperties().interpolationType == lin );
+
+	//the slice chunks are 32 bit aligned, only their first mappedSize voxels are part of the image
+	const QRectF source( 0, 0, mappedSize[0], mappedSize[1] );
+	const size_t timestep = image->getImageProperties().timestep;
+	const util::ivector4 &trueVoxelCoords = image->getImageProperties().trueVoxelCoords;
+
+	if ( !image->getImageProperties().isRGB ) {
+		data::MemChunk<InternalImageType> sliceChunk( mappedSizeAligned[0], mappedSizeAligned[1] );
+		MemoryHandler::fillSliceChunk<InternalImageType>( sliceChunk, image, orientation, timestep, trueVoxelCoords );
+		QImage slice( ( InternalImageType * ) sliceChunk.asValueArray<InternalImageType>().getRawAddress().get(),
+					  mappedSizeAligned[0], mappedSizeAligned[1], QImage::Format_Indexed8 );
+		slice.setColorTable( image->getImageProperties().colorMap );
+		painter.drawImage( source, slice, source );
+	} else {
+		data::MemChunk<InternalImageColorType> sliceChunk( mappedSizeAligned[0], mappedSizeAligned[1] );
+		MemoryHandler::fillSliceChunk<InternalImageColorType>( sliceChunk, image, orientation, timestep, trueVoxelCoords );
+		QImage slice( ( InternalImageType * ) sliceChunk.asValueArray<InternalImageColorType>().getRawAddress().get(),
+					  mappedSizeAligned[0], mappedSizeAligned[1], QImage::Format_RGB888 );
+		painter.drawImage( source, slice, source );
+	}
+}
+
+std::vector<SnapshotBatch::Subject> SnapshotBatch::createSubjects( const util::slist &structural, const util::slist &statistical )
+{
+	std::vector<Subject> subjects;
+	const bool paired = structural.size() == statistical.size();
+	util::slist::const_iterator statisticalIter = statistical.begin();
+	BOOST_FOREACH( util::slist::const_reference file, structural ) {
+		Subject subject;
+		subject.structural.push_back( file );
+
+		if( paired ) {
+			subject.statistical.push_back( *statisticalIter++ );
+		} else {
+			subject.statistical = statistical;
+		}
+
+		subjects.push_back( subject );
+	}
+
+	if( structural.empty() ) {
+		BOOST_FOREACH( util::slist::const_reference file, statistical ) {
+			Subject subject;
+			subject.statistical.push_back( file );
+			subjects.push_back( subject );
+		}
+	}
+
+	//e.g. sub01/t1.nii and sub02/t1.nii
+	std::map<std::string, size_t> names;
+	BOOST_FOREACH( std::vector<Subject>::reference subject, subjects ) {
+		const std::string file = subject.structural.empty() ? subject.statistical.front() : subject.structural.front();
+		subject.name = boost::filesystem::basename( boost::filesystem::path( file ) );
+		const size_t count = names[subject.name]++;
+
+		if( count ) {
+			std::stringstream name;
+			name << subject.name << "_" << count;
+			subject.name = name.str();
+		}
+	}
+	return subjects;
+}
+
+SnapshotBatch::SnapshotBatch( const Options &options, const std::vector<SnapshotRenderer::View> &views )
+	: m_Options( options ),
+	  m_Views( views ),
+	  m_Renderer( options.size )
+{}
+
+struct SnapshotBatch::SubjectOp {
+	SnapshotBatch *batch;
+	const std::vector<Subject> *subjects;
+	std::vector<size_t> failed;
+	void operator()( const size_t &first, const size_t &last, const unsigned short &threadIndex ) {
+		for( size_t i = first; i < last; i++ ) {
+			if( !batch->process( ( *subjects )[i] ) ) {
+				failed[threadIndex]++;
+			}
+		}
+	}
+};
+
+size_t SnapshotBatch::run( const std::vector<Subject> &subjects, const unsigned short &numberOfThreads )
+{
+	QTime timer;
+	timer.start();
+	SubjectOp op = { this, &subjects, std::vector<size_t>( std::max<unsigned short>( 1, numberOfThreads ), 0 ) };
+	const unsigned short parts = parallel::forEachRange( 0, subjects.size(), op, numberOfThreads );
+	const size_t failed = std::accumulate( op.failed.begin(), op.failed.begin() + parts, size_t( 0 ) );
+	LOG( Runtime, info ) << "Rendered " << subjects.size() - failed << " of " << subjects.size() << " subjects with "
+						 << parts << " threads in " << timer.elapsed() << " ms.";
+	return failed;
+}
+
+bool SnapshotBatch::process( const Subject &subject )
+{
+	ImageHolder::Vector images;
+	BOOST_FOREACH( util::slist::const_reference file, subject.structural ) {
+		if( !load( file, ImageHolder::structural_image, images ) ) {
+			return false;
+		}
+	}
+	BOOST_FOREACH( util::slist::const_reference file, subject.statistical ) {
+		if( !load( file, ImageHolder::statistical_image, images ) ) {
+			return false;
+		}
+	}
+
+	if( images.empty() ) {
+		return false;
+	}
+
+	const util::fvector3 center = images.front()->getImageProperties().physicalCoords;
+	bool success = true;
+	BOOST_FOREACH( std::vector<SnapshotRenderer::View>::const_reference view, m_Views ) {
+		BOOST_FOREACH( ImageHolder::Vector::const_reference image, images ) {
+			image->phyisicalCoordsChanged( view.center ? center : view.physicalCoords );
+		}
+		const boost::filesystem::path path = boost::filesystem::path( m_Options.outputDirectory ) / ( subject.name + "_" + view.name + ".png" );
+
+		if( !m_Renderer.render( images, view.orientation ).save( path.string().c_str(), "PNG" ) ) {
+			LOG( Runtime, error ) << "Could not save the snapshot " << path.string() << ".";
+			success = false;
+		}
+	}
+	LOG_IF( success, Runtime, info ) << "Saved the snapshots of " << subject.name << ".";
+	return success;
+}
+
+bool SnapshotBatch::load( const std::string &path, const ImageHolder::ImageType &imageType, ImageHolder::Vector &images )
+{
+	std::list<data::Image> loaded;
+	{
+		//the image io plugins are not meant to be used by several threads at once
+		boost::mutex::scoped_lock lock( m_IOMutex );
+		loaded = data::IOFactory::load( path, m_Options.readFormat, m_Options.dialect );
+	}
+
+	if( loaded.empty() ) {
+		LOG( Runtime, error ) << "Could not load " << path << ".";
+		return false;
+	}
+
+	const bool statistical = imageType == ImageHolder::statistical_image;
+	ImageHolder::IngestOptions ingestOptions;
+	ingestOptions.trueZero = statistical ? m_Options.trueZeroStatistical : m_Options.trueZeroStructural;
+	//the subjects are already processed in parallel
+	ingestOptions.numberOfThreads = 1;
+
+	BOOST_FOREACH( std::list<data::Image>::const_reference image, loaded ) {
+		const ImageHolder::Pointer holder( new ImageHolder );
+
+		if( !holder->setImage( image, imageType, path, ingestOptions ) ) {
+			return false;
+		}
+
+		const std::string &lut = statistical ? m_Options.lutStatistical : m_Options.lutStructural;
+
+		if( !lut.empty() ) {
+			holder->getImageProperties().lut = lut;
+		}
+
+		if( statistical ) {
+			holder->getImageProperties().lowerThreshold = m_Options.lowerThreshold;
+			holder->getImageProperties().upperThreshold = m_Options.upperThreshold;
+			holder->getImageProperties().opacity = m_Options.opacity;
+		}
+
+		holder->updateColorMap();
+		images.push_back( holder );
+	}
+	return true;
+}
+
+}
+}
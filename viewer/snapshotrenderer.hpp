@@ -0,0 +1,136 @@
+/****************************************************************
+ *
+ * <Copyright information>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *
+ * snapshotrenderer.hpp
+ *
+ * Description:
+ *
+ *  Created on: Oct 19, 2026
+ ******************************************************************/
+#ifndef VAST_SNAPSHOTRENDERER_HPP
+#define VAST_SNAPSHOTRENDERER_HPP
+
+#include "common.hpp"
+#include "imageholder.hpp"
+#include <QImage>
+#include <QPainter>
+#include <boost/thread/mutex.hpp>
+
+namespace isis
+{
+namespace viewer
+{
+
+/**
+ * Renders slices of images into QImages without any widget, e.g. for the snapshots of the headless mode.
+ * The slices are extracted by MemoryHandler::fillSliceChunk and composited with the colormaps and opacities
+ * of the images the same way the qt image widget paints them.
+ * Only QImages are painted on, so renderers can be used by several threads at once.
+ */
+class SnapshotRenderer
+{
+public:
+	struct View {
+		View() : orientation( axial ), center( true ) {}
+		PlaneOrientation orientation;
+		///physical coordinates the slice goes through
+		util::fvector3 physicalCoords;
+		///if true, the slice goes through the center of the first image instead of physicalCoords
+		bool center;
+		///used in the file names of the snapshots
+		std::string name;
+	};
+
+	///parses "axial", "sagittal" or "coronal", optionally followed by ":x,y,z" in mm, returns false for an invalid spec
+	static bool parseView( const std::string &spec, View &view );
+
+	///size is the length of the longer side of the rendered images in pixels
+	SnapshotRenderer( const unsigned short &size ) : m_Size( size ) {}
+
+	/**
+	 * Renders the slices through the current physical coordinates of images with the given orientation.
+	 * The geometry of the snapshot is given by the first image. The structural images are painted first, followed by the statistical ones.
+	 */
+	QImage render( const ImageHolder::Vector &images, const PlaneOrientation &orientation ) const;
+
+private:
+	static void paintSlice( QPainter &painter, const ImageHolder::Pointer image, const PlaneOrientation &orientation );
+
+	unsigned short m_Size;
+};
+
+/**
+ * The batch job of the headless mode. Every subject is loaded, rendered for all views and saved to png files
+ * named <subject>_<view>.png. The subjects are processed by several threads in parallel.
+ */
+class SnapshotBatch
+{
+public:
+	struct Subject {
+		std::string name;
+		util::slist structural;
+		util::slist statistical;
+	};
+
+	struct Options {
+		Options() : size( 512 ), lowerThreshold( 0 ), upperThreshold( 0 ), opacity( 1 ), trueZeroStructural( false ), trueZeroStatistical( false ) {}
+		util::istring readFormat;
+		util::istring dialect;
+		std::string outputDirectory;
+		unsigned short size;
+		std::string lutStructural;
+		std::string lutStatistical;
+		///thresholds of the statistical images, like in the viewer
+		double lowerThreshold;
+		double upperThreshold;
+		///opacity of the statistical images
+		double opacity;
+		bool trueZeroStructural;
+		bool trueZeroStatistical;
+	};
+
+	/**
+	 * Creates one subject per structural file. The statistical files are assigned by position if there are as many of them
+	 * as structural files, otherwise all statistical files are shown on every subject.
+	 * Without structural files every statistical file is a subject. The names of the subjects are the file names
+	 * without extension, made unique by a suffix.
+	 */
+	static std::vector<Subject> createSubjects( const util::slist &structural, const util::slist &statistical );
+
+	SnapshotBatch( const Options &options, const std::vector<SnapshotRenderer::View> &views );
+
+	///processes all subjects with numberOfThreads threads and returns the number of subjects that failed
+	size_t run( const std::vector<Subject> &subjects, const unsigned short &numberOfThreads );
+
+private:
+	struct SubjectOp;
+
+	bool process( const Subject &subject );
+	bool load( const std::string &path, const ImageHolder::ImageType &imageType, ImageHolder::Vector &images );
+
+	Options m_Options;
+	std::vector<SnapshotRenderer::View> m_Views;
+	SnapshotRenderer m_Renderer;
+	boost::mutex m_IOMutex;
+};
+
+}
+}
+
+#endif // VAST_SNAPSHOTRENDERER_HPP
@@ -0,0 +1,238 @@
+/****************************************************************
+ *
+ * <Copyright information>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *
+ * timeplayer.cpp
+ *
+ * Description:
+ *
+ *  Created on: Oct 19, 2026
+ ******************************************************************/
+#include "timeplayer.hpp"
+#include "qviewercore.hpp"
+
+namespace isis
+{
+namespace viewer
+{
+
+TimePlayer::TimePlayer ( QViewerCore *core, QObject *parent )
+	: QObject( parent ),
+	  m_ViewerCore( core ),
+	  m_Timer( new QTimer( this ) ),
+	  m_PrefetchThread( new PrefetchThread( this ) ),
+	  m_IsPlaying( false ),
+	  m_Start( 0 ),
+	  m_End( 0 ),
+	  m_LastFrame( 0 ),
+	  m_ShownFrames( 0 ),
+	  m_DroppedFrames( 0 ),
+	  m_PlayTime( 0 )
+{
+	setTargetFPS( m_ViewerCore->getSettings()->getPropertyAs<uint16_t>( "timeseriesPlayFPS" ) );
+	m_Timer->setSingleShot( true );
+	connect( m_Timer, SIGNAL( timeout() ), this, SLOT( nextFrame() ) );
+}
+
+TimePlayer::~TimePlayer()
+{
+	//the receivers may already be destroyed, e.g. if the player is deleted with its parent widget
+	blockSignals( true );
+	stop();
+	m_PrefetchThread->requestStop();
+	m_PrefetchThread->wait();
+}
+
+void TimePlayer::setTargetFPS ( const float &fps )
+{
+	m_TargetFPS = fps > 0 ? fps : 1;
+}
+
+void TimePlayer::play ( const size_t &start, const size_t &end )
+{
+	if( m_IsPlaying ) {
+		stop();
+	}
+
+	if( !end ) {
+		LOG( Dev, warning ) << "Trying to play a timecourse without any timestep.";
+		return;
+	}
+
+	m_Start = start < end ? start : 0;
+	m_End = end;
+	m_LastFrame = 0;
+	m_ShownFrames = 0;
+	m_DroppedFrames = 0;
+	m_PlayTime = 0;
+	m_IsPlaying = true;
+	m_Clock.start();
+	nextFrame();
+}
+
+void TimePlayer::stop()
+{
+	if( !m_IsPlaying ) {
+		return;
+	}
+
+	m_Timer->stop();
+	m_PlayTime = m_Clock.elapsed();
+	m_IsPlaying = false;
+	m_PrefetchThread->requestStop();
+	m_PrefetchThread->wait();
+	util::Singletons::get<SliceCache, 10>().clear();
+	LOG( Dev, info ) << "Played " << m_ShownFrames << " frames with " << getAchievedFPS()
+					 << " fps (target was " << m_TargetFPS << " fps). Dropped " << m_DroppedFrames << " frames.";
+	emitStopped();
+}
+
+float TimePlayer::getAchievedFPS() const
+{
+	const int playTime = m_IsPlaying ? m_Clock.elapsed() : m_PlayTime;
+
+	if( playTime <= 0 ) {
+		return 0;
+	}
+
+	return m_ShownFrames * 1000. / playTime;
+}
+
+void TimePlayer::nextFrame()
+{
+	if( !m_IsPlaying ) {
+		return;
+	}
+
+	// the frame that is due now. Everything between the last shown frame and this one was too late.
+	const size_t frame = static_cast<size_t>( m_Clock.elapsed() * m_TargetFPS / 1000. );
+
+	if( m_ShownFrames && frame <= m_LastFrame ) {
+		scheduleNextFrame();
+		return;
+	}
+
+	if( m_ShownFrames ) {
+		m_DroppedFrames += frame - m_LastFrame - 1;
+	}
+
+	m_LastFrame = frame;
+	m_ShownFrames++;
+	const size_t timestep = ( m_Start + frame ) % m_End;
+	emitTimestepChanged( timestep );
+	prefetch( timestep );
+	scheduleNextFrame();
+}
+
+void TimePlayer::scheduleNextFrame()
+{
+	const int nextFrameTime = static_cast<int>( ( m_LastFrame + 1 ) * 1000. / m_TargetFPS );
+	m_Timer->start( std::max( 0, nextFrameTime - m_Clock.elapsed() ) );
+}
+
+void TimePlayer::prefetch ( const size_t &currentTimestep )
+{
+	const uint16_t steps = m_ViewerCore->getSettings()->getPropertyAs<uint16_t>( "timeseriesPrefetchSteps" );
+	const std::string geometricalWidget = m_ViewerCore->getSettings()->getPropertyAs<std::string>( "widgetGeometrical" );
+	SliceCache &cache = util::Singletons::get<SliceCache, 10>();
+	PrefetchThread::JobList jobs;
+	//slices of the current and the upcoming timesteps at the current position, everything else is outdated
+	std::set<SliceCache::KeyType> wanted;
+
+	for( uint16_t step = 0; step <= steps; step++ ) {
+		const size_t timestep = ( currentTimestep + step ) % m_End;
+		BOOST_FOREACH( WidgetEnsemble::Vector::const_reference ensemble, m_ViewerCore->getUICore()->getEnsembleList() ) {
+			BOOST_FOREACH( WidgetEnsemble::const_reference component, *ensemble ) {
+				if( !component->isNeeded() || !component->getDockWidget()->isVisible() ) {
+					continue;
+				}
+
+				const PlaneOrientation orientation = component->getWidgetInterface()->getPlaneOrientation();
+
+				if( orientation == not_specified ) {
+					continue;
+				}
+
+				BOOST_FOREACH( ImageHolder::Vector::const_reference image, ensemble->getImageVector() ) {
+					const util::ivector4 &trueVoxelCoords = image->getImageProperties().trueVoxelCoords;
+
+					// the geometrical widget only uses extracted slices if the image is not rotated
+					const bool usesSliceChunk = component->getWidgetInterface()->getWidgetIdent() != geometricalWidget
+												|| image->getImageProperties().latchedOrientation == image->getImageProperties().orientation;
+
+					if( !image->getImageProperties().isVisible || !usesSliceChunk || timestep >= image->getImageSize()[dim_time] ) {
+						continue;
+					}
+
+					const SliceCache::KeyType key = SliceCache::getKey( image, orientation, timestep, MemoryHandler::getSliceIndex( image, orientation, trueVoxelCoords ) );
+					wanted.insert( key );
+
+					if( step && !cache.contains( image, orientation, timestep, key.get<3>() ) ) {
+						PrefetchThread::Job job;
+						job.image = image;
+						job.orientation = orientation;
+						job.timestep = timestep;
+						job.trueVoxelCoords = trueVoxelCoords;
+						job.key = key;
+						jobs.push_back( job );
+					}
+				}
+			}
+		}
+	}
+
+	cache.retain( wanted );
+
+	// the last prefetch is still running so we are behind anyway
+	if( m_PrefetchThread->isRunning() ) {
+		return;
+	}
+
+	if( !jobs.empty() ) {
+		m_PrefetchThread->setJobs( jobs );
+		m_PrefetchThread->start( QThread::LowPriority );
+	}
+}
+
+void TimePlayer::PrefetchThread::run()
+{
+	BOOST_FOREACH( JobList::const_reference job, m_Jobs ) {
+		if( m_Stop ) {
+			break;
+		}
+
+		if( job.image->getImageProperties().isRGB ) {
+			extractSlice<InternalImageColorType>( job );
+		} else {
+			extractSlice<InternalImageType>( job );
+		}
+	}
+	m_Jobs.clear();
+}
+
+template<typename TYPE>
+void TimePlayer::PrefetchThread::extractSlice ( const Job &job )
+{
+	const util::ivector4 mappedSizeAligned = mapCoordsToOrientation( job.image->getImageProperties().alignedSize32, job.image->getImageProperties().latchedOrientation, job.orientation );
+	data::MemChunk<TYPE> sliceChunk( mappedSizeAligned[0], mappedSizeAligned[1] );
+	MemoryHandler::fillSliceChunk<TYPE>( sliceChunk, job.image, job.orientation, job.timestep, job.trueVoxelCoords );
+	util::Singletons::get<SliceCache, 10>().store( sliceChunk, job.key );
+}
+
+}
+} // end namespace
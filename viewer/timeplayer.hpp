@@ -0,0 +1,128 @@
+/****************************************************************
+ *
+ * <Copyright information>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+ *
+ *
+ * timeplayer.hpp
+ *
+ * Description:
+ *
+ *  Created on: Oct 19, 2026
+ ******************************************************************/
+#ifndef VAST_TIMEPLAYER_HPP
+#define VAST_TIMEPLAYER_HPP
+
+#include <QObject>
+#include <QThread>
+#include <QTimer>
+#include <QTime>
+#include <QAtomicInt>
+#include "common.hpp"
+#include "memoryhandler.hpp"
+
+namespace isis
+{
+namespace viewer
+{
+class QViewerCore;
+
+/**
+ * Plays a timecourse with a fixed target frame rate.
+ * The TimePlayer only acts as the clock. Every time a new frame is due it emits emitTimestepChanged.
+ * If painting a frame takes longer than the frame period, the timesteps that could not be shown in time are skipped
+ * and counted as dropped frames.
+ * While playing, the slices of the upcoming timesteps are extracted in a background thread for all visible widgets
+ * and put into the SliceCache.
+ */
+class TimePlayer : public QObject
+{
+	Q_OBJECT
+
+	class PrefetchThread : public QThread
+	{
+	public:
+		struct Job {
+			ImageHolder::Pointer image;
+			PlaneOrientation orientation;
+			size_t timestep;
+			util::ivector4 trueVoxelCoords;
+			//taken before the slice is extracted, so a slice of changed content is never served
+			SliceCache::KeyType key;
+		};
+		typedef std::list<Job> JobList;
+
+		PrefetchThread( QObject *parent ) : QThread( parent ), m_Stop( 0 ) {}
+		///has to be called before the thread is started. A stop requested after that is not lost even if the thread has not run yet.
+		void setJobs( const JobList &jobs ) { m_Jobs = jobs; m_Stop.fetchAndStoreOrdered( 0 ); }
+		void requestStop() { m_Stop.fetchAndStoreOrdered( 1 ); }
+		void run();
+	private:
+		template<typename TYPE>
+		void extractSlice( const Job &job );
+
+		JobList m_Jobs;
+		QAtomicInt m_Stop;
+	};
+
+public:
+	TimePlayer( QViewerCore *core, QObject *parent = 0 );
+	///stops the playback and waits for the prefetch thread, which must not be destroyed while it is running
+	~TimePlayer();
+
+	///starts playing from timestep start. After timestep end - 1 playback continues with timestep 0.
+	void play( const size_t &start, const size_t &end );
+	///stops the playback. The frame that is currently painted will be finished.
+	void stop();
+	bool isPlaying() const { return m_IsPlaying; }
+
+	void setTargetFPS( const float &fps );
+	float getTargetFPS() const { return m_TargetFPS; }
+
+	float getAchievedFPS() const;
+	size_t getShownFrames() const { return m_ShownFrames; }
+	size_t getDroppedFrames() const { return m_DroppedFrames; }
+
+Q_SIGNALS:
+	void emitTimestepChanged( int timestep );
+	void emitStopped();
+
+private Q_SLOTS:
+	void nextFrame();
+
+private:
+	void prefetch( const size_t &currentTimestep );
+	void scheduleNextFrame();
+
+	QViewerCore *m_ViewerCore;
+	QTimer *m_Timer;
+	QTime m_Clock;
+	PrefetchThread *m_PrefetchThread;
+
+	bool m_IsPlaying;
+	float m_TargetFPS;
+	size_t m_Start;
+	size_t m_End;
+	size_t m_LastFrame;
+	size_t m_ShownFrames;
+	size_t m_DroppedFrames;
+	int m_PlayTime;
+};
+
+}
+} // end namespace
+
+#endif // VAST_TIMEPLAYER_HPP
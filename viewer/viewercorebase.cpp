@@ -29,6 +29,7 @@
 #include "common.hpp"
 #include "geometrical.hpp"
 #include "nativeimageops.hpp"
+#include "parallel.hpp"
 
 #define STR(s) _xstr_(s)
 #define _xstr_(s) std::string(#s)
@@ -44,6 +45,7 @@ ViewerCoreBase::ViewerCoreBase( )
 	  m_Mode( default_mode )
 {
 	util::Singletons::get<color::Color, 10>().initStandardColormaps();
+	emitImageContentChanged.connect( boost::bind( &ImageHolder::contentChanged, _1 ) );
 }
 
 ImageHolder::Vector ViewerCoreBase::addImageList( const std::list< data::Image > imageList, const ImageHolder::ImageType &imageType )
@@ -75,6 +77,14 @@ ImageHolder::Pointer ViewerCoreBase::addImage( const isis::data::Image &image, c
 	ImageHolder::Pointer  retImage = ImageHolder::Pointer( new ImageHolder );
 	m_imageVector.push_back( retImage );
 
+	//zero masking and the first histogram are done while the image is copied
+	ImageHolder::IngestOptions ingestOptions;
+	ingestOptions.trueZero = ( imageType == ImageHolder::structural_image && getSettings()->getPropertyAs<bool>( "setZeroToBlackStructural" ) )
+							 || ( imageType == ImageHolder::statistical_image && getSettings()->getPropertyAs<bool>( "setZeroToBlackStatistical" ) );
+	ingestOptions.histogramBins = getSettings()->getPropertyAs<uint16_t>( "histogramBins" );
+	ingestOptions.histogramOmitZero = getSettings()->getPropertyAs<bool>( "histogramOmitZero" );
+	ingestOptions.numberOfThreads = parallel::getNumberOfThreads( *getSettings() );
+
 	//look if this filename already exists.
 	if( m_ImageMap.find( fileName ) != m_ImageMap.end() ) {
 		unsigned short index = 0;
@@ -86,10 +96,10 @@ ImageHolder::Pointer ViewerCoreBase::addImage( const isis::data::Image &image, c
 			newFileName = ss.str();
 		}
 
-		retImage->setImage( image, imageType, newFileName );
+		retImage->setImage( image, imageType, newFileName, ingestOptions );
 		m_ImageMap[newFileName] = retImage;
 	} else {
-		retImage->setImage( image, imageType, fileName );
+		retImage->setImage( image, imageType, fileName, ingestOptions );
 		m_ImageMap[fileName] = retImage;
 	}
 
@@ -120,20 +130,10 @@ ImageHolder::Pointer ViewerCoreBase::addImage( const isis::data::Image &image, c
 		retImage->getImageProperties().isVisible = false;
 	}
 
-	retImage->getImageProperties().boundingBox = geometrical::getPhysicalBoundingBox( retImage );
-
 	if( getSettings()->getPropertyAs<bool>( "checkCACP" ) ) {
 		checkForCaCp( retImage );
 	}
 
-	if( getSettings()->getPropertyAs<bool>( "setZeroToBlackStructural" ) && retImage->getImageProperties().imageType == ImageHolder::structural_image ) {
-		operation::NativeImageOps::setTrueZero( retImage );
-	}
-
-	if( getSettings()->getPropertyAs<bool>( "setZeroToBlackStatistical" ) && retImage->getImageProperties().imageType == ImageHolder::statistical_image ) {
-		operation::NativeImageOps::setTrueZero( retImage );
-	}
-
 	//connect signals to image
 	emitGlobalPhysicalCoordsChanged.connect( boost::bind( &ImageHolder::phyisicalCoordsChanged, retImage, _1 ) );
 	emitGlobalVoxelCoordsChanged.connect( boost::bind( &ImageHolder::voxelCoordsChanged, retImage, _1 ) );
@@ -32,6 +32,7 @@
 #include "uicore.hpp"
 #include <qviewercore.hpp>
 #include "fileinformation.hpp"
+#include "editjournal.hpp"
 #include "scalingWidget.hpp"
 
 
@@ -101,6 +102,9 @@ MainWindow::MainWindow( QViewerCore *core ) :
 	connect( m_Interface.action_Preferences, SIGNAL( triggered() ), preferencesDialog, SLOT( show() ) );
 	connect( m_Interface.actionFind_Global_Min, SIGNAL( triggered() ), this, SLOT( findGlobalMin() ) );
 	connect( m_Interface.actionFind_Global_Max, SIGNAL( triggered() ), this, SLOT( findGlobalMax() ) );
+	connect( m_Interface.actionUndo, SIGNAL( triggered() ), this, SLOT( undo() ) );
+	connect( m_Interface.actionRedo, SIGNAL( triggered() ), this, SLOT( redo() ) );
+	connect( m_Interface.menu_Edit, SIGNAL( aboutToShow() ), this, SLOT( updateEditMenu() ) );
 	connect( m_Interface.actionShow_Labels, SIGNAL( triggered( bool ) ), m_ViewerCore, SLOT( setShowLabels( bool ) ) );
 	connect( m_RadiusSpin, SIGNAL( valueChanged( int ) ), this, SLOT( spinRadiusChanged( int ) ) );
 	connect( m_Interface.actionShow_scaling_option, SIGNAL( triggered() ), this, SLOT( showScalingOption() ) );
@@ -560,14 +564,47 @@ void MainWindow::closeEvent( QCloseEvent * )
 }
 
 
+void MainWindow::undo()
+{
+	const ImageHolder::Pointer image = util::Singletons::get<EditJournal, 10>().undo();
+
+	if( image ) {
+		m_ViewerCore->emitImageContentChanged( image );
+		m_ViewerCore->updateScene();
+	}
+}
+
+void MainWindow::redo()
+{
+	const ImageHolder::Pointer image = util::Singletons::get<EditJournal, 10>().redo();
+
+	if( image ) {
+		m_ViewerCore->emitImageContentChanged( image );
+		m_ViewerCore->updateScene();
+	}
+}
+
+void MainWindow::updateEditMenu()
+{
+	const EditJournal &journal = util::Singletons::get<EditJournal, 10>();
+	m_Interface.actionUndo->setEnabled( journal.canUndo() );
+	m_Interface.actionUndo->setText( journal.canUndo() ? tr( "&Undo %1" ).arg( journal.getUndoDescription().c_str() ) : tr( "&Undo" ) );
+	m_Interface.actionRedo->setEnabled( journal.canRedo() );
+	m_Interface.actionRedo->setText( journal.canRedo() ? tr( "&Redo %1" ).arg( journal.getRedoDescription().c_str() ) : tr( "&Redo" ) );
+}
+
 void MainWindow::findGlobalMin()
 {
 	if( m_ViewerCore->hasImage() ) {
 		const int radius = m_RadiusSpin->value();
-		const util::ivector4 minVoxel = operation::NativeImageOps::getGlobalMin( m_ViewerCore->getCurrentImage(),
-										m_ViewerCore->getCurrentImage()->getImageProperties().voxelCoords,
-										radius );
-		m_ViewerCore->physicalCoordsChanged( m_ViewerCore->getCurrentImage()->getISISImage()->getPhysicalCoordsFromIndex( minVoxel ) );
+		const operation::NativeImageOps::Extremum min = operation::NativeImageOps::getGlobalMin( m_ViewerCore->getCurrentImage(),
+				m_ViewerCore->getCurrentImage()->getImageProperties().voxelCoords,
+				radius );
+
+		if( min.valid ) {
+			LOG( Runtime, info ) << "Found minimum " << min.value << " at " << min.position;
+			m_ViewerCore->physicalCoordsChanged( m_ViewerCore->getCurrentImage()->getISISImage()->getPhysicalCoordsFromIndex( min.position ) );
+		}
 	}
 }
 
@@ -575,13 +612,14 @@ void MainWindow::findGlobalMax()
 {
 	if( m_ViewerCore->hasImage() ) {
 		const int radius = m_RadiusSpin->value();
+		const operation::NativeImageOps::Extremum max = operation::NativeImageOps::getGlobalMax( m_ViewerCore->getCurrentImage(),
+				m_ViewerCore->getCurrentImage()->getImageProperties().voxelCoords,
+				radius );
 
-
-		const util::ivector4 maxVoxel = operation::NativeImageOps::getGlobalMax( m_ViewerCore->getCurrentImage(),
-										m_ViewerCore->getCurrentImage()->getImageProperties().voxelCoords,
-										radius );
-
-		m_ViewerCore->physicalCoordsChanged( m_ViewerCore->getCurrentImage()->getISISImage()->getPhysicalCoordsFromIndex( maxVoxel ) );
+		if( max.valid ) {
+			LOG( Runtime, info ) << "Found maximum " << max.value << " at " << max.position;
+			m_ViewerCore->physicalCoordsChanged( m_ViewerCore->getCurrentImage()->getISISImage()->getPhysicalCoordsFromIndex( max.position ) );
+		}
 	}
 }
 
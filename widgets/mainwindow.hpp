@@ -91,6 +91,9 @@ public Q_SLOTS:
 	void closeEvent( QCloseEvent * );
 	void findGlobalMin();
 	void findGlobalMax();
+	void undo();
+	void redo();
+	void updateEditMenu();
 	void spinRadiusChanged( int );
 	void showScalingOption();
 	void ignoreOrientation( bool );
@@ -66,7 +66,7 @@ VoxelInformationWidget::VoxelInformationWidget( QWidget *parent, QViewerCore *co
 	m_Interface.sliceBox->setMinimum( 0 );
 	m_UpperHalfColormapLabel->setMaximumHeight( 20 );
 	m_Interface.playButton->setIcon( QIcon( ":/common/play.png" ) );
-	m_tThread = new TimePlayThread( this, m_ViewerCore, &m_Interface );
+	m_TimePlayer = new TimePlayer( m_ViewerCore, this );
 	QVBoxLayout *layout = new QVBoxLayout( );
 	layout->setContentsMargins( 5, 0, 5, 0 );
 	layout->addWidget( m_UpperHalfColormapLabel );
@@ -115,7 +115,8 @@ void VoxelInformationWidget::connectSignals()
 	connect( m_Interface.timestepSpinBox, SIGNAL( valueChanged( int ) ), this, SLOT( timeStepChanged(int) ) );
 	connect( m_Interface.timestepSlider, SIGNAL( sliderMoved( int ) ), this, SLOT( timeStepChanged(int) ) );
 	connect( m_Interface.timestepSpinBox, SIGNAL( valueChanged( int ) ), this, SLOT( timeStepChanged(int) ) );
-	connect( m_tThread, SIGNAL( finished() ), this, SLOT( timePlayFinished() ) );
+	connect( m_TimePlayer, SIGNAL( emitTimestepChanged( int ) ), this, SLOT( timePlayStepped( int ) ) );
+	connect( m_TimePlayer, SIGNAL( emitStopped() ), this, SLOT( timePlayFinished() ) );
 	connect( m_Interface.playButton, SIGNAL( clicked() ), this, SLOT( playTimecourse() ) );
 	connect( m_Interface.colormapButton, SIGNAL( clicked() ), this, SLOT( onLUTMenuClicked() ) );
 	isConnected = true;
@@ -149,18 +150,17 @@ void VoxelInformationWidget::updateLowerUpperThreshold()
 void VoxelInformationWidget::playTimecourse()
 {
 	if( m_ViewerCore->hasImage() ) {
-		if( m_tThread->isRunning() ) {
-			m_tThread->terminate();
-			m_Interface.playButton->setIcon( QIcon( ":/common/play.png" ) );
+		if( m_TimePlayer->isPlaying() ) {
+			m_TimePlayer->stop();
 		} else {
+			m_TimePlayer->setTargetFPS( m_ViewerCore->getSettings()->getPropertyAs<uint16_t>( "timeseriesPlayFPS" ) );
+			m_Interface.playButton->setIcon( QIcon( ":/common/pause.png" ) );
+
 			if ( QApplication::keyboardModifiers() == Qt::ControlModifier ) {
-				m_tThread->setStartStop( 0, m_ViewerCore->getCurrentImage()->getImageSize()[3] );
+				m_TimePlayer->play( 0, m_ViewerCore->getCurrentImage()->getImageSize()[3] );
 			} else {
-				m_tThread->setStartStop( m_Interface.timestepSlider->value(), m_ViewerCore->getCurrentImage()->getImageSize()[3] );
+				m_TimePlayer->play( m_Interface.timestepSlider->value(), m_ViewerCore->getCurrentImage()->getImageSize()[3] );
 			}
-
-			m_Interface.playButton->setIcon( QIcon( ":/common/pause.png" ) );
-			m_tThread->start();
 		}
 	}
 }
@@ -168,6 +168,19 @@ void VoxelInformationWidget::playTimecourse()
 void VoxelInformationWidget::timePlayFinished()
 {
 	m_Interface.playButton->setIcon( QIcon( ":/common/play.png" ) );
+	std::stringstream tooltip;
+	tooltip << "Last playback: " << roundNumber<float>( m_TimePlayer->getAchievedFPS(), 1 ) << " of "
+			<< m_TimePlayer->getTargetFPS() << " fps, " << m_TimePlayer->getDroppedFrames() << " dropped frames";
+	m_Interface.playButton->setToolTip( tooltip.str().c_str() );
+}
+
+void VoxelInformationWidget::timePlayStepped ( int timestep )
+{
+	if( m_ViewerCore->hasImage() ) {
+		timeStepChanged( timestep );
+	} else {
+		m_TimePlayer->stop();
+	}
 }
 
 void VoxelInformationWidget::physPosChanged()
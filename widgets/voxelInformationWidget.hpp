@@ -31,7 +31,7 @@
 #include "ui_voxelInformationWidget.h"
 #include "common.hpp"
 #include "qviewercore.hpp"
-#include <QThread>
+#include "timeplayer.hpp"
 
 namespace isis
 {
@@ -44,32 +44,6 @@ namespace ui
 class VoxelInformationWidget : public QWidget
 {
 	Q_OBJECT
-	class TimePlayThread : public QThread
-	{
-		QViewerCore *m_core;
-		int m_start;
-		int m_end;
-		Ui::voxelInformationWidget *m_interface;
-
-	public:
-		TimePlayThread( QObject *parent, QViewerCore *core, Ui::voxelInformationWidget *interface )
-			: QThread( parent ), m_core( core ), m_start( 0 ), m_end( 0 ), m_interface( interface ) {} ;
-		void setStartStop( int start, int stop ) { m_start = start; m_end = stop; }
-		void run() {
-			uint16_t deleyTime = m_core->getSettings()->getPropertyAs<uint16_t>( "timeseriesPlayDelayTime" );
-			uint16_t t = m_start;
-
-			while( true ) {
-				t = t == m_end ? 0 : t;
-				m_interface->timestepSpinBox->setValue( t );
-				msleep( deleyTime );
-				QApplication::processEvents(QEventLoop::AllEvents);
-				t++;
-
-			}
-		}
-	};
-
 public:
 	VoxelInformationWidget( QWidget *parent, QViewerCore *core );
 
@@ -84,6 +58,7 @@ public Q_SLOTS:
 	void updateLowerUpperThreshold(  );
 	void playTimecourse();
 	void timePlayFinished();
+	void timePlayStepped( int );
 	void onLUTMenuClicked();
 	void timeStepChanged(int);
 
@@ -94,7 +69,7 @@ private:
 	void connectSignals();
 	void disconnectSignals();
 	void reconnectSignals();
-	TimePlayThread *m_tThread;
+	TimePlayer *m_TimePlayer;
 	QLabel *m_UpperHalfColormapLabel;
 	QWidget *m_sepWidget;
 	QLabel *m_LowerHalfColormapLabel;